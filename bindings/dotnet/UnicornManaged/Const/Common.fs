@@ -80,6 +80,7 @@ module Common =
     let UC_ERR_HOOK_EXIST = 19
     let UC_ERR_RESOURCE = 20
     let UC_ERR_EXCEPTION = 21
+    let UC_ERR_BREAKPOINT = 22
     let UC_MEM_READ = 16
     let UC_MEM_WRITE = 17
     let UC_MEM_FETCH = 18
@@ -94,6 +95,9 @@ module Common =
     let UC_TCG_OP_SUB = 0
     let UC_TCG_OP_FLAG_CMP = 1
     let UC_TCG_OP_FLAG_DIRECT = 2
+
+    let UC_CMPLOG_SUB = 0
+    let UC_CMPLOG_AND = 1
     let UC_HOOK_INTR = 1
     let UC_HOOK_INSN = 2
     let UC_HOOK_CODE = 4
@@ -122,11 +126,22 @@ module Common =
     let UC_QUERY_PAGE_SIZE = 2
     let UC_QUERY_ARCH = 3
     let UC_QUERY_TIMEOUT = 4
+    let UC_QUERY_INSN_COUNT = 5
 
     let UC_CTL_IO_NONE = 0
     let UC_CTL_IO_WRITE = 1
     let UC_CTL_IO_READ = 2
     let UC_CTL_IO_READ_WRITE = 3
+    let UC_CTL_CONTEXT_CPU = 1
+    let UC_CTL_CONTEXT_MEMORY = 2
+    let UC_CTL_CONTEXT_REGS_GPR = 1
+    let UC_CTL_CONTEXT_REGS_FP = 2
+    let UC_CTL_CONTEXT_REGS_VECTOR = 4
+    let UC_CTL_CONTEXT_REGS_SYSTEM = 8
+    let UC_CTL_CONTEXT_REGS_ALL = 15
+
+    let UC_TIMEOUT_CLOCK_HOST = 0
+    let UC_TIMEOUT_CLOCK_VIRTUAL = 1
 
     let UC_CTL_UC_MODE = 0
     let UC_CTL_UC_PAGE_SIZE = 1
@@ -139,6 +154,14 @@ module Common =
     let UC_CTL_TB_REQUEST_CACHE = 8
     let UC_CTL_TB_REMOVE_CACHE = 9
     let UC_CTL_TB_FLUSH = 10
+    let UC_CTL_UC_TIMEOUT_CLOCK = 11
+    let UC_CTL_UC_BREAKPOINT_ADD = 12
+    let UC_CTL_UC_BREAKPOINT_DEL = 13
+    let UC_CTL_UC_BREAKPOINT_HIT = 14
+    let UC_CTL_UC_COVERAGE_MAP = 15
+    let UC_CTL_UC_CMPLOG = 16
+    let UC_CTL_CONTEXT_MODE = 17
+    let UC_CTL_CONTEXT_REGS = 18
 
     let UC_PROT_NONE = 0
     let UC_PROT_READ = 1
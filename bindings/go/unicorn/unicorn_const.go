@@ -75,6 +75,7 @@ const (
 	ERR_HOOK_EXIST = 19
 	ERR_RESOURCE = 20
 	ERR_EXCEPTION = 21
+	ERR_BREAKPOINT = 22
 	MEM_READ = 16
 	MEM_WRITE = 17
 	MEM_FETCH = 18
@@ -89,6 +90,9 @@ const (
 	TCG_OP_SUB = 0
 	TCG_OP_FLAG_CMP = 1
 	TCG_OP_FLAG_DIRECT = 2
+
+	CMPLOG_SUB = 0
+	CMPLOG_AND = 1
 	HOOK_INTR = 1
 	HOOK_INSN = 2
 	HOOK_CODE = 4
@@ -117,11 +121,22 @@ const (
 	QUERY_PAGE_SIZE = 2
 	QUERY_ARCH = 3
 	QUERY_TIMEOUT = 4
+	QUERY_INSN_COUNT = 5
 
 	CTL_IO_NONE = 0
 	CTL_IO_WRITE = 1
 	CTL_IO_READ = 2
 	CTL_IO_READ_WRITE = 3
+	CTL_CONTEXT_CPU = 1
+	CTL_CONTEXT_MEMORY = 2
+	CTL_CONTEXT_REGS_GPR = 1
+	CTL_CONTEXT_REGS_FP = 2
+	CTL_CONTEXT_REGS_VECTOR = 4
+	CTL_CONTEXT_REGS_SYSTEM = 8
+	CTL_CONTEXT_REGS_ALL = 15
+
+	TIMEOUT_CLOCK_HOST = 0
+	TIMEOUT_CLOCK_VIRTUAL = 1
 
 	CTL_UC_MODE = 0
 	CTL_UC_PAGE_SIZE = 1
@@ -134,6 +149,14 @@ const (
 	CTL_TB_REQUEST_CACHE = 8
 	CTL_TB_REMOVE_CACHE = 9
 	CTL_TB_FLUSH = 10
+	CTL_UC_TIMEOUT_CLOCK = 11
+	CTL_UC_BREAKPOINT_ADD = 12
+	CTL_UC_BREAKPOINT_DEL = 13
+	CTL_UC_BREAKPOINT_HIT = 14
+	CTL_UC_COVERAGE_MAP = 15
+	CTL_UC_CMPLOG = 16
+	CTL_CONTEXT_MODE = 17
+	CTL_CONTEXT_REGS = 18
 
 	PROT_NONE = 0
 	PROT_READ = 1
@@ -77,6 +77,7 @@ public interface UnicornConst {
    public static final int UC_ERR_HOOK_EXIST = 19;
    public static final int UC_ERR_RESOURCE = 20;
    public static final int UC_ERR_EXCEPTION = 21;
+   public static final int UC_ERR_BREAKPOINT = 22;
    public static final int UC_MEM_READ = 16;
    public static final int UC_MEM_WRITE = 17;
    public static final int UC_MEM_FETCH = 18;
@@ -91,6 +92,9 @@ public interface UnicornConst {
    public static final int UC_TCG_OP_SUB = 0;
    public static final int UC_TCG_OP_FLAG_CMP = 1;
    public static final int UC_TCG_OP_FLAG_DIRECT = 2;
+
+   public static final int UC_CMPLOG_SUB = 0;
+   public static final int UC_CMPLOG_AND = 1;
    public static final int UC_HOOK_INTR = 1;
    public static final int UC_HOOK_INSN = 2;
    public static final int UC_HOOK_CODE = 4;
@@ -119,11 +123,22 @@ public interface UnicornConst {
    public static final int UC_QUERY_PAGE_SIZE = 2;
    public static final int UC_QUERY_ARCH = 3;
    public static final int UC_QUERY_TIMEOUT = 4;
+   public static final int UC_QUERY_INSN_COUNT = 5;
 
    public static final int UC_CTL_IO_NONE = 0;
    public static final int UC_CTL_IO_WRITE = 1;
    public static final int UC_CTL_IO_READ = 2;
    public static final int UC_CTL_IO_READ_WRITE = 3;
+   public static final int UC_CTL_CONTEXT_CPU = 1;
+   public static final int UC_CTL_CONTEXT_MEMORY = 2;
+   public static final int UC_CTL_CONTEXT_REGS_GPR = 1;
+   public static final int UC_CTL_CONTEXT_REGS_FP = 2;
+   public static final int UC_CTL_CONTEXT_REGS_VECTOR = 4;
+   public static final int UC_CTL_CONTEXT_REGS_SYSTEM = 8;
+   public static final int UC_CTL_CONTEXT_REGS_ALL = 15;
+
+   public static final int UC_TIMEOUT_CLOCK_HOST = 0;
+   public static final int UC_TIMEOUT_CLOCK_VIRTUAL = 1;
 
    public static final int UC_CTL_UC_MODE = 0;
    public static final int UC_CTL_UC_PAGE_SIZE = 1;
@@ -136,6 +151,14 @@ public interface UnicornConst {
    public static final int UC_CTL_TB_REQUEST_CACHE = 8;
    public static final int UC_CTL_TB_REMOVE_CACHE = 9;
    public static final int UC_CTL_TB_FLUSH = 10;
+   public static final int UC_CTL_UC_TIMEOUT_CLOCK = 11;
+   public static final int UC_CTL_UC_BREAKPOINT_ADD = 12;
+   public static final int UC_CTL_UC_BREAKPOINT_DEL = 13;
+   public static final int UC_CTL_UC_BREAKPOINT_HIT = 14;
+   public static final int UC_CTL_UC_COVERAGE_MAP = 15;
+   public static final int UC_CTL_UC_CMPLOG = 16;
+   public static final int UC_CTL_CONTEXT_MODE = 17;
+   public static final int UC_CTL_CONTEXT_REGS = 18;
 
    public static final int UC_PROT_NONE = 0;
    public static final int UC_PROT_READ = 1;
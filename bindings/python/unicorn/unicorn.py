@@ -137,6 +137,13 @@ class _uc_mem_region(ctypes.Structure):
         ("perms", ctypes.c_uint32),
     ]
 
+class _uc_mem_span(ctypes.Structure):
+    _fields_ = [
+        ("address", ctypes.c_uint64),
+        ("ptr",     ctypes.c_void_p),
+        ("size",    ctypes.c_size_t),
+    ]
+
 class uc_tb(ctypes.Structure):
     """"TranslationBlock"""
     _fields_ = [
@@ -149,18 +156,29 @@ _setup_prototype(_uc, "uc_version", ctypes.c_uint, ctypes.POINTER(ctypes.c_int),
 _setup_prototype(_uc, "uc_arch_supported", ctypes.c_bool, ctypes.c_int)
 _setup_prototype(_uc, "uc_open", ucerr, ctypes.c_uint, ctypes.c_uint, ctypes.POINTER(uc_engine))
 _setup_prototype(_uc, "uc_close", ucerr, uc_engine)
+_setup_prototype(_uc, "uc_reset", ucerr, uc_engine, ctypes.c_bool)
+_setup_prototype(_uc, "uc_snapshot_save", ucerr, uc_engine, ctypes.c_char_p)
+_setup_prototype(_uc, "uc_snapshot_load", ucerr, uc_engine, ctypes.c_char_p)
 _setup_prototype(_uc, "uc_strerror", ctypes.c_char_p, ucerr)
 _setup_prototype(_uc, "uc_errno", ucerr, uc_engine)
 _setup_prototype(_uc, "uc_reg_read", ucerr, uc_engine, ctypes.c_int, ctypes.c_void_p)
 _setup_prototype(_uc, "uc_reg_write", ucerr, uc_engine, ctypes.c_int, ctypes.c_void_p)
 _setup_prototype(_uc, "uc_mem_read", ucerr, uc_engine, ctypes.c_uint64, ctypes.POINTER(ctypes.c_char), ctypes.c_size_t)
 _setup_prototype(_uc, "uc_mem_write", ucerr, uc_engine, ctypes.c_uint64, ctypes.POINTER(ctypes.c_char), ctypes.c_size_t)
+_setup_prototype(_uc, "uc_mem_read_batch", ucerr, uc_engine, ctypes.POINTER(ctypes.c_uint64), ctypes.POINTER(ctypes.c_void_p), ctypes.POINTER(ctypes.c_size_t), ctypes.POINTER(ucerr), ctypes.c_int)
+_setup_prototype(_uc, "uc_mem_write_batch", ucerr, uc_engine, ctypes.POINTER(ctypes.c_uint64), ctypes.POINTER(ctypes.c_void_p), ctypes.POINTER(ctypes.c_size_t), ctypes.POINTER(ucerr), ctypes.c_int)
+_setup_prototype(_uc, "uc_vmem_translate", ucerr, uc_engine, ctypes.c_uint64, ctypes.POINTER(ctypes.c_uint64))
+_setup_prototype(_uc, "uc_vmem_read", ucerr, uc_engine, ctypes.c_uint64, ctypes.POINTER(ctypes.c_char), ctypes.c_size_t)
+_setup_prototype(_uc, "uc_vmem_write", ucerr, uc_engine, ctypes.c_uint64, ctypes.POINTER(ctypes.c_char), ctypes.c_size_t)
 _setup_prototype(_uc, "uc_emu_start", ucerr, uc_engine, ctypes.c_uint64, ctypes.c_uint64, ctypes.c_uint64, ctypes.c_size_t)
 _setup_prototype(_uc, "uc_emu_stop", ucerr, uc_engine)
 _setup_prototype(_uc, "uc_hook_del", ucerr, uc_engine, uc_hook_h)
 _setup_prototype(_uc, "uc_mmio_map", ucerr, uc_engine, ctypes.c_uint64, ctypes.c_size_t, ctypes.c_void_p, ctypes.c_void_p, ctypes.c_void_p, ctypes.c_void_p)
 _setup_prototype(_uc, "uc_mem_map", ucerr, uc_engine, ctypes.c_uint64, ctypes.c_size_t, ctypes.c_uint32)
 _setup_prototype(_uc, "uc_mem_map_ptr", ucerr, uc_engine, ctypes.c_uint64, ctypes.c_size_t, ctypes.c_uint32, ctypes.c_void_p)
+_setup_prototype(_uc, "uc_mem_map_file", ucerr, uc_engine, ctypes.c_uint64, ctypes.c_size_t, ctypes.c_uint32, ctypes.c_int, ctypes.c_uint64, ctypes.c_bool)
+_setup_prototype(_uc, "uc_mem_map_begin", ucerr, uc_engine)
+_setup_prototype(_uc, "uc_mem_map_commit", ucerr, uc_engine)
 _setup_prototype(_uc, "uc_mem_unmap", ucerr, uc_engine, ctypes.c_uint64, ctypes.c_size_t)
 _setup_prototype(_uc, "uc_mem_protect", ucerr, uc_engine, ctypes.c_uint64, ctypes.c_size_t, ctypes.c_uint32)
 _setup_prototype(_uc, "uc_query", ucerr, uc_engine, ctypes.c_uint32, ctypes.POINTER(ctypes.c_size_t))
@@ -173,6 +191,9 @@ _setup_prototype(_uc, "uc_context_reg_read", ucerr, uc_context, ctypes.c_int, ct
 _setup_prototype(_uc, "uc_context_reg_write", ucerr, uc_context, ctypes.c_int, ctypes.c_void_p)
 _setup_prototype(_uc, "uc_context_free", ucerr, uc_context)
 _setup_prototype(_uc, "uc_mem_regions", ucerr, uc_engine, ctypes.POINTER(ctypes.POINTER(_uc_mem_region)), ctypes.POINTER(ctypes.c_uint32))
+_setup_prototype(_uc, "uc_mem_dirty_pages", ucerr, uc_engine, ctypes.c_uint64, ctypes.c_size_t, ctypes.POINTER(ctypes.c_uint8), ctypes.c_bool)
+_setup_prototype(_uc, "uc_mem_get_ptr", ucerr, uc_engine, ctypes.c_uint64, ctypes.c_size_t, ctypes.POINTER(_uc_mem_span), ctypes.POINTER(ctypes.c_uint32))
+_setup_prototype(_uc, "uc_mem_ptr_written", ucerr, uc_engine, ctypes.c_uint64, ctypes.c_size_t)
 # https://bugs.python.org/issue42880
 _setup_prototype(_uc, "uc_hook_add", ucerr, uc_engine, ctypes.POINTER(uc_hook_h), ctypes.c_int, ctypes.c_void_p, ctypes.c_void_p, ctypes.c_uint64, ctypes.c_uint64)
 _setup_prototype(_uc, "uc_ctl", ucerr, uc_engine, ctypes.c_int)
@@ -528,6 +549,7 @@ class Uc(object):
         self._callback_count = 0
         self._cleanup.register(self)
         self._hook_exception = None  # The exception raised in a hook
+        self._coverage_map = None  # Keeps the coverage map buffer alive
 
     @staticmethod
     def release_handle(uch: ctypes.CDLL):
@@ -539,6 +561,25 @@ class Uc(object):
             except:  # _uc might be pulled from under our feet
                 pass
 
+    # unmap all memory, remove all hooks and reset registers and settings
+    def reset(self, keep_cache: bool=False) -> None:
+        status = _uc.uc_reset(self._uch, keep_cache)
+        if status != uc.UC_ERR_OK:
+            raise UcError(status)
+        self._callbacks = {}
+        self._ctype_cbs = []
+        self._coverage_map = None
+
+    def snapshot_save(self, path: str) -> None:
+        status = _uc.uc_snapshot_save(self._uch, path.encode())
+        if status != uc.UC_ERR_OK:
+            raise UcError(status)
+
+    def snapshot_load(self, path: str) -> None:
+        status = _uc.uc_snapshot_load(self._uch, path.encode())
+        if status != uc.UC_ERR_OK:
+            raise UcError(status)
+
     # emulate from @begin, and stop when reaching address @until
     def emu_start(self, begin: int, until: int, timeout: int=0, count: int=0) -> None:
         self._hook_exception = None
@@ -585,6 +626,52 @@ class Uc(object):
         if status != uc.UC_ERR_OK:
             raise UcError(status)
 
+    # translate a guest virtual address to a physical address with the current guest MMU mode
+    def vmem_translate(self, address: int):
+        paddress = ctypes.c_uint64()
+        status = _uc.uc_vmem_translate(self._uch, address, ctypes.byref(paddress))
+        if status != uc.UC_ERR_OK:
+            raise UcError(status)
+        return paddress.value
+
+    # read data from memory at a guest virtual address
+    def vmem_read(self, address: int, size: int):
+        data = ctypes.create_string_buffer(size)
+        status = _uc.uc_vmem_read(self._uch, address, data, size)
+        if status != uc.UC_ERR_OK:
+            raise UcError(status)
+        return bytearray(data)
+
+    # write to memory at a guest virtual address
+    def vmem_write(self, address: int, data: bytes):
+        status = _uc.uc_vmem_write(self._uch, address, data, len(data))
+        if status != uc.UC_ERR_OK:
+            raise UcError(status)
+
+    # read several ranges of memory given as (address, size) in one call.
+    # this returns a list with the data of each range, None for the ranges which could not be read
+    def mem_read_batch(self, ranges):
+        count = len(ranges)
+        addresses = (ctypes.c_uint64 * count)(*[address for address, _ in ranges])
+        sizes = (ctypes.c_size_t * count)(*[size for _, size in ranges])
+        buffers = [ctypes.create_string_buffer(size) for _, size in ranges]
+        bufs = (ctypes.c_void_p * count)(*[ctypes.addressof(b) for b in buffers])
+        results = (ucerr * count)()
+        _uc.uc_mem_read_batch(self._uch, addresses, bufs, sizes, results, count)
+        return [bytearray(buffers[i].raw) if results[i] == uc.UC_ERR_OK else None for i in range(count)]
+
+    # write several ranges of memory given as (address, data) in one call.
+    # this returns a list with the status of each write
+    def mem_write_batch(self, writes):
+        count = len(writes)
+        addresses = (ctypes.c_uint64 * count)(*[address for address, _ in writes])
+        sizes = (ctypes.c_size_t * count)(*[len(data) for _, data in writes])
+        buffers = [ctypes.create_string_buffer(bytes(data), len(data)) for _, data in writes]
+        bufs = (ctypes.c_void_p * count)(*[ctypes.addressof(b) for b in buffers])
+        results = (ucerr * count)()
+        _uc.uc_mem_write_batch(self._uch, addresses, bufs, sizes, results, count)
+        return list(results)
+
     def _mmio_map_read_cb(self, handle, offset, size, user_data):
         (cb, data) = self._callbacks[user_data]
         return cb(self, offset, size, data)
@@ -626,6 +713,24 @@ class Uc(object):
         if status != uc.UC_ERR_OK:
             raise UcError(status)
 
+    # map a range of a file, read lazily
+    def mem_map_file(self, address: int, size: int, fd: int, offset: int=0, perms: int=uc.UC_PROT_ALL, shared: bool=False):
+        status = _uc.uc_mem_map_file(self._uch, address, size, perms, fd, offset, shared)
+        if status != uc.UC_ERR_OK:
+            raise UcError(status)
+
+    # start a memory map transaction
+    def mem_map_begin(self):
+        status = _uc.uc_mem_map_begin(self._uch)
+        if status != uc.UC_ERR_OK:
+            raise UcError(status)
+
+    # commit the memory map transaction
+    def mem_map_commit(self):
+        status = _uc.uc_mem_map_commit(self._uch)
+        if status != uc.UC_ERR_OK:
+            raise UcError(status)
+
     # unmap a range of memory
     def mem_unmap(self, address: int, size: int):
         status = _uc.uc_mem_unmap(self._uch, address, size)
@@ -772,6 +877,39 @@ class Uc(object):
 
     def ctl_get_timeout(self):
         return self.__ctl_r_1_arg(uc.UC_CTL_UC_TIMEOUT, ctypes.c_uint64)
+
+    def ctl_get_timeout_clock(self):
+        return self.__ctl_r_1_arg(uc.UC_CTL_UC_TIMEOUT_CLOCK, ctypes.c_int)
+
+    def ctl_set_timeout_clock(self, val: int):
+        self.__ctl_w_1_arg(uc.UC_CTL_UC_TIMEOUT_CLOCK, val, ctypes.c_int)
+
+    def ctl_get_context_regs(self):
+        return self.__ctl_r_1_arg(uc.UC_CTL_CONTEXT_REGS, ctypes.c_int)
+
+    def ctl_set_context_regs(self, val: int):
+        self.__ctl_w_1_arg(uc.UC_CTL_CONTEXT_REGS, val, ctypes.c_int)
+
+    def ctl_add_breakpoints(self, addrs: List[int]):
+        arr = (ctypes.c_uint64 * len(addrs))(*addrs)
+        self.ctl(self.__ctl_w(uc.UC_CTL_UC_BREAKPOINT_ADD, 2), ctypes.cast(arr, ctypes.c_void_p), ctypes.c_size_t(len(addrs)))
+
+    def ctl_remove_breakpoints(self, addrs: List[int]):
+        arr = (ctypes.c_uint64 * len(addrs))(*addrs)
+        self.ctl(self.__ctl_w(uc.UC_CTL_UC_BREAKPOINT_DEL, 2), ctypes.cast(arr, ctypes.c_void_p), ctypes.c_size_t(len(addrs)))
+
+    def ctl_get_breakpoint_hit(self):
+        return self.__ctl_r_1_arg(uc.UC_CTL_UC_BREAKPOINT_HIT, ctypes.c_uint64)
+
+    # buf is a writable buffer such as a bytearray or an mmap of an AFL shared
+    # map, it's referenced until another map is set. None disables coverage.
+    def ctl_set_coverage_map(self, buf):
+        if buf is None:
+            self.ctl(self.__ctl_w(uc.UC_CTL_UC_COVERAGE_MAP, 2), None, ctypes.c_size_t(0))
+        else:
+            arr = (ctypes.c_ubyte * len(buf)).from_buffer(buf)
+            self.ctl(self.__ctl_w(uc.UC_CTL_UC_COVERAGE_MAP, 2), ctypes.cast(arr, ctypes.c_void_p), ctypes.c_size_t(len(buf)))
+        self._coverage_map = buf
     
     def ctl_exits_enabled(self, val: bool):
         self.__ctl_w_1_arg(uc.UC_CTL_UC_USE_EXITS, val, ctypes.c_int)
@@ -940,6 +1078,35 @@ class Uc(object):
         finally:
             _uc.uc_free(regions)
 
+    # this returns the addresses of the pages written since the log was cleared
+    def mem_dirty_pages(self, address, size, clear=False):
+        page_size = self.ctl_get_page_size()
+        count = size // page_size
+        bitmap = (ctypes.c_uint8 * ((count + 7) // 8))()
+        status = _uc.uc_mem_dirty_pages(self._uch, address, size, bitmap, clear)
+        if status != uc.UC_ERR_OK:
+            raise UcError(status)
+        return [address + i * page_size for i in range(count) if bitmap[i // 8] & (1 << (i % 8))]
+
+    # this returns the host memory of a RAM range as a list of (address, memoryview),
+    # valid until the memory map changes. Call mem_ptr_written() after writing to it.
+    def mem_get_ptr(self, address, size):
+        spans = (_uc_mem_span * 4)()
+        count = ctypes.c_uint32(len(spans))
+        status = _uc.uc_mem_get_ptr(self._uch, address, size, spans, ctypes.byref(count))
+        if status == uc.UC_ERR_ARG and count.value > len(spans):
+            spans = (_uc_mem_span * count.value)()
+            status = _uc.uc_mem_get_ptr(self._uch, address, size, spans, ctypes.byref(count))
+        if status != uc.UC_ERR_OK:
+            raise UcError(status)
+        return [(s.address, memoryview((ctypes.c_ubyte * s.size).from_address(s.ptr)).cast('B'))
+                for s in spans[:count.value]]
+
+    def mem_ptr_written(self, address, size):
+        status = _uc.uc_mem_ptr_written(self._uch, address, size)
+        if status != uc.UC_ERR_OK:
+            raise UcError(status)
+
 
 class UcContext:
     def __init__(self, h, arch, mode):
@@ -75,6 +75,7 @@ module UnicornEngine
 	UC_ERR_HOOK_EXIST = 19
 	UC_ERR_RESOURCE = 20
 	UC_ERR_EXCEPTION = 21
+	UC_ERR_BREAKPOINT = 22
 	UC_MEM_READ = 16
 	UC_MEM_WRITE = 17
 	UC_MEM_FETCH = 18
@@ -89,6 +90,9 @@ module UnicornEngine
 	UC_TCG_OP_SUB = 0
 	UC_TCG_OP_FLAG_CMP = 1
 	UC_TCG_OP_FLAG_DIRECT = 2
+
+	UC_CMPLOG_SUB = 0
+	UC_CMPLOG_AND = 1
 	UC_HOOK_INTR = 1
 	UC_HOOK_INSN = 2
 	UC_HOOK_CODE = 4
@@ -117,11 +121,22 @@ module UnicornEngine
 	UC_QUERY_PAGE_SIZE = 2
 	UC_QUERY_ARCH = 3
 	UC_QUERY_TIMEOUT = 4
+	UC_QUERY_INSN_COUNT = 5
 
 	UC_CTL_IO_NONE = 0
 	UC_CTL_IO_WRITE = 1
 	UC_CTL_IO_READ = 2
 	UC_CTL_IO_READ_WRITE = 3
+	UC_CTL_CONTEXT_CPU = 1
+	UC_CTL_CONTEXT_MEMORY = 2
+	UC_CTL_CONTEXT_REGS_GPR = 1
+	UC_CTL_CONTEXT_REGS_FP = 2
+	UC_CTL_CONTEXT_REGS_VECTOR = 4
+	UC_CTL_CONTEXT_REGS_SYSTEM = 8
+	UC_CTL_CONTEXT_REGS_ALL = 15
+
+	UC_TIMEOUT_CLOCK_HOST = 0
+	UC_TIMEOUT_CLOCK_VIRTUAL = 1
 
 	UC_CTL_UC_MODE = 0
 	UC_CTL_UC_PAGE_SIZE = 1
@@ -134,6 +149,14 @@ module UnicornEngine
 	UC_CTL_TB_REQUEST_CACHE = 8
 	UC_CTL_TB_REMOVE_CACHE = 9
 	UC_CTL_TB_FLUSH = 10
+	UC_CTL_UC_TIMEOUT_CLOCK = 11
+	UC_CTL_UC_BREAKPOINT_ADD = 12
+	UC_CTL_UC_BREAKPOINT_DEL = 13
+	UC_CTL_UC_BREAKPOINT_HIT = 14
+	UC_CTL_UC_COVERAGE_MAP = 15
+	UC_CTL_UC_CMPLOG = 16
+	UC_CTL_CONTEXT_MODE = 17
+	UC_CTL_CONTEXT_REGS = 18
 
 	UC_PROT_NONE = 0
 	UC_PROT_READ = 1
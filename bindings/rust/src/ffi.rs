@@ -3,7 +3,7 @@
 
 use crate::Unicorn;
 
-use super::unicorn_const::{uc_error, Arch, HookType, MemRegion, MemType, Mode, Query};
+use super::unicorn_const::{uc_error, Arch, HookType, MemRegion, MemSpan, MemType, Mode, Query};
 use core::ffi::c_void;
 use libc::{c_char, c_int};
 
@@ -27,6 +27,22 @@ extern "C" {
         bytes: *const u8,
         size: libc::size_t,
     ) -> uc_error;
+    pub fn uc_mem_write_batch(
+        engine: uc_handle,
+        addresses: *const u64,
+        bytes: *const *const u8,
+        sizes: *const libc::size_t,
+        results: *mut uc_error,
+        count: c_int,
+    ) -> uc_error;
+    pub fn uc_mem_read_batch(
+        engine: uc_handle,
+        addresses: *const u64,
+        bytes: *const *mut u8,
+        sizes: *const libc::size_t,
+        results: *mut uc_error,
+        count: c_int,
+    ) -> uc_error;
     pub fn uc_mem_read(
         engine: uc_handle,
         address: u64,
@@ -62,6 +78,14 @@ extern "C" {
         regions: *const *const MemRegion,
         count: *mut u32,
     ) -> uc_error;
+    pub fn uc_mem_get_ptr(
+        engine: uc_handle,
+        address: u64,
+        size: libc::size_t,
+        spans: *mut MemSpan,
+        count: *mut u32,
+    ) -> uc_error;
+    pub fn uc_mem_ptr_written(engine: uc_handle, address: u64, size: libc::size_t) -> uc_error;
     pub fn uc_emu_start(
         engine: uc_handle,
         begin: u64,
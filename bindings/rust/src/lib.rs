@@ -54,7 +54,9 @@ use alloc::{boxed::Box, rc::Rc, vec::Vec};
 use core::{cell::UnsafeCell, ptr};
 use ffi::uc_handle;
 use libc::c_void;
-use unicorn_const::{uc_error, Arch, HookType, MemRegion, MemType, Mode, Permission, Query};
+use unicorn_const::{
+    uc_error, Arch, HookType, MemRegion, MemSpan, MemType, Mode, Permission, Query,
+};
 
 #[derive(Debug)]
 pub struct Context {
@@ -273,6 +275,51 @@ impl<'a, D> Unicorn<'a, D> {
         }
     }
 
+    /// Returns the host memory backing a RAM range, one span per contiguous piece.
+    /// The pointers are valid until the memory map changes. Call `mem_ptr_written`
+    /// after writing through them.
+    pub fn mem_get_ptr(&self, address: u64, size: usize) -> Result<Vec<MemSpan>, uc_error> {
+        let mut spans: Vec<MemSpan> = Vec::with_capacity(4);
+        let mut count = spans.capacity() as u32;
+        let mut err = unsafe {
+            ffi::uc_mem_get_ptr(
+                self.get_handle(),
+                address,
+                size,
+                spans.as_mut_ptr(),
+                &mut count,
+            )
+        };
+        if err == uc_error::ARG && count as usize > spans.capacity() {
+            spans.reserve_exact(count as usize);
+            err = unsafe {
+                ffi::uc_mem_get_ptr(
+                    self.get_handle(),
+                    address,
+                    size,
+                    spans.as_mut_ptr(),
+                    &mut count,
+                )
+            };
+        }
+        if err == uc_error::OK {
+            unsafe { spans.set_len(count as usize) };
+            Ok(spans)
+        } else {
+            Err(err)
+        }
+    }
+
+    /// Tell the emulator that a range was written through the pointers of `mem_get_ptr`.
+    pub fn mem_ptr_written(&mut self, address: u64, size: usize) -> Result<(), uc_error> {
+        let err = unsafe { ffi::uc_mem_ptr_written(self.get_handle(), address, size) };
+        if err == uc_error::OK {
+            Ok(())
+        } else {
+            Err(err)
+        }
+    }
+
     /// Read a range of bytes from memory at the specified address.
     pub fn mem_read(&self, address: u64, buf: &mut [u8]) -> Result<(), uc_error> {
         let err =
@@ -305,6 +352,63 @@ impl<'a, D> Unicorn<'a, D> {
         }
     }
 
+    /// Read several ranges of memory, each into its buffer, in one call.
+    /// Returns the result of each read.
+    pub fn mem_read_batch(&self, reads: &mut [(u64, &mut [u8])]) -> Vec<Result<(), uc_error>> {
+        let addresses: Vec<u64> = reads.iter().map(|(address, _)| *address).collect();
+        let sizes: Vec<usize> = reads.iter().map(|(_, buf)| buf.len()).collect();
+        let bufs: Vec<*mut u8> = reads.iter_mut().map(|(_, buf)| buf.as_mut_ptr()).collect();
+        let mut results = vec![uc_error::OK; reads.len()];
+        unsafe {
+            ffi::uc_mem_read_batch(
+                self.get_handle(),
+                addresses.as_ptr(),
+                bufs.as_ptr(),
+                sizes.as_ptr(),
+                results.as_mut_ptr(),
+                reads.len() as i32,
+            )
+        };
+        results
+            .into_iter()
+            .map(|err| {
+                if err == uc_error::OK {
+                    Ok(())
+                } else {
+                    Err(err)
+                }
+            })
+            .collect()
+    }
+
+    /// Write several ranges of memory in one call. Returns the result of each write.
+    pub fn mem_write_batch(&mut self, writes: &[(u64, &[u8])]) -> Vec<Result<(), uc_error>> {
+        let addresses: Vec<u64> = writes.iter().map(|(address, _)| *address).collect();
+        let sizes: Vec<usize> = writes.iter().map(|(_, bytes)| bytes.len()).collect();
+        let bufs: Vec<*const u8> = writes.iter().map(|(_, bytes)| bytes.as_ptr()).collect();
+        let mut results = vec![uc_error::OK; writes.len()];
+        unsafe {
+            ffi::uc_mem_write_batch(
+                self.get_handle(),
+                addresses.as_ptr(),
+                bufs.as_ptr(),
+                sizes.as_ptr(),
+                results.as_mut_ptr(),
+                writes.len() as i32,
+            )
+        };
+        results
+            .into_iter()
+            .map(|err| {
+                if err == uc_error::OK {
+                    Ok(())
+                } else {
+                    Err(err)
+                }
+            })
+            .collect()
+    }
+
     /// Map an existing memory region in the emulator at the specified address.
     ///
     /// # Safety
@@ -36,6 +36,7 @@ pub enum uc_error {
     HOOK_EXIST = 19,
     RESOURCE = 20,
     EXCEPTION = 21,
+    BREAKPOINT = 22,
 }
 
 #[repr(C)]
@@ -97,6 +98,7 @@ pub enum Query {
     PAGE_SIZE = 2,
     ARCH = 3,
     TIMEOUT = 4,
+    INSN_COUNT = 5,
 }
 
 bitflags! {
@@ -118,6 +120,14 @@ pub struct MemRegion {
     pub perms: Permission,
 }
 
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct MemSpan {
+    pub address: u64,
+    pub ptr: *mut u8,
+    pub size: usize,
+}
+
 #[repr(C)]
 #[derive(PartialEq, Debug, Clone, Copy)]
 pub enum Arch {
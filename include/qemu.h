@@ -29,7 +29,30 @@ struct RAMBlock {
     uint32_t flags;
     /* RCU-enabled, writes protected by the ramlist lock */
     QLIST_ENTRY(RAMBlock) next;
+    /* Unicorn: in ram_list.blocks_by_offset */
+    QLIST_ENTRY(RAMBlock) next_offset;
     size_t page_size;
+    /* Unicorn: pages written since the last memory snapshot */
+    unsigned long *dirty;
+    /* Unicorn: pages written since the last uc_mem_dirty_pages() clear */
+    unsigned long *dirty_log;
+    /* Unicorn: pages written since the block was allocated, the others are
+     * still zero or hold the content of the file mapped */
+    unsigned long *written;
+    /* Unicorn: the file mapped by uc_mem_map_file() or the memfd shared
+     * with clones, -1 if none */
+    int fd;
+    uint64_t fd_offset;
+    bool fd_shared;
+    /* Unicorn: the RAM moved to a memfd shared with uc_clone() copies, the
+     * pages written since differ from it. NULL if not shared */
+    unsigned long *cow_written;
+    /* Unicorn: the block owning the host memory of this slice of a split
+     * block, NULL if the block owns its memory */
+    struct RAMBlock *host_owner;
+    /* Unicorn: the blocks using the host memory of this block, the memory
+     * is freed with the last one */
+    int host_refs;
 };
 
 typedef struct {
@@ -43,6 +66,8 @@ typedef struct {
 typedef struct RAMList {
     RAMBlock *mru_block;
     QLIST_HEAD(, RAMBlock) blocks;
+    /* Unicorn: the blocks sorted by offset, see find_ram_offset() */
+    QLIST_HEAD(, RAMBlock) blocks_by_offset;
 } RAMList;
 
 #endif
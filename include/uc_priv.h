@@ -105,6 +105,10 @@ typedef MemoryRegion *(*uc_args_uc_ram_size_ptr_t)(struct uc_struct *,
 
 typedef void (*uc_mem_unmap_t)(struct uc_struct *, MemoryRegion *mr);
 
+typedef bool (*uc_mem_split_t)(struct uc_struct *, MemoryRegion *mr,
+                               hwaddr addr, MemoryRegion **lo,
+                               MemoryRegion **hi);
+
 typedef void (*uc_readonly_mem_t)(MemoryRegion *mr, bool readonly);
 
 typedef int (*uc_cpus_init)(struct uc_struct *, const char *);
@@ -136,10 +140,18 @@ typedef void (*uc_softfloat_initialize)(void);
 // tcg flush softmmu tlb
 typedef void (*uc_tcg_flush_tlb)(struct uc_struct *uc);
 
+// Translate a guest virtual address with the current MMU mode
+typedef bool (*uc_vmem_translate_t)(struct uc_struct *uc, uint64_t addr,
+                                    uint64_t *paddr);
+
 // Invalidate the TB at given address
 typedef void (*uc_invalidate_tb_t)(struct uc_struct *uc, uint64_t start,
                                    size_t len);
 
+// Invalidate the TBs on the RAM range [start, end), given as ram_addr_t
+typedef void (*uc_invalidate_tb_ram_t)(struct uc_struct *uc, uint64_t start,
+                                       uint64_t end);
+
 // Request generating TB at given address
 typedef uc_err (*uc_gen_tb_t)(struct uc_struct *uc, uint64_t pc, uc_tb *out_tb);
 
@@ -152,6 +164,7 @@ struct hook {
     int refs;       // reference count to free hook stored in multiple lists
     int op;         // opcode for HOOK_TCG_OPCODE
     int op_flags;   // opcode flags for HOOK_TCG_OPCODE
+    int64_t seq;    // order of the hook in its lists
     bool to_delete; // set to true when the hook is deleted by the user. The
                     // destruction of the hook is delayed.
     uint64_t begin, end; // only trigger if PC or memory access is in this
@@ -178,6 +191,14 @@ typedef uc_err (*uc_context_save_t)(struct uc_struct *uc, uc_context *context);
 typedef uc_err (*uc_context_restore_t)(struct uc_struct *uc,
                                        uc_context *context);
 
+// A part of the CPU state covered by a register class, see
+// UC_CTL_CONTEXT_REGS
+struct uc_context_range {
+    int regs; // uc_context_regs
+    size_t offset;
+    size_t size;
+};
+
 // hook list offsets
 //
 // The lowest 6 bits are used for hook type index while the others
@@ -224,6 +245,10 @@ typedef enum uc_hook_idx {
 // The rest of bits are reserved for hook flags.
 #define UC_HOOK_FLAG_MASK (~(UC_HOOK_IDX_MASK))
 
+// The maximum number of code/block hooks called directly from the translated
+// code of a single instruction or block, see gen_uc_tracecode.
+#define UC_HOOK_INLINE_MAX 8
+
 #define HOOK_FOREACH_VAR_DECLARE struct list_item *cur
 
 // for loop macro to loop over hook lists
@@ -239,17 +264,35 @@ typedef enum uc_hook_idx {
 
 #define HOOK_EXISTS(uc, idx) ((uc)->hook[idx##_IDX].head != NULL)
 #define HOOK_EXISTS_BOUNDED(uc, idx, addr)                                     \
-    _hook_exists_bounded((uc)->hook[idx##_IDX].head, addr)
+    HOOK_EXISTS_RANGE(uc, idx, addr, addr)
+
+// Does any hook of the type cover part of [begin, end]?
+#define HOOK_EXISTS_RANGE(uc, idx, begin, end)                                 \
+    ((uc)->hook[idx##_IDX].head != NULL &&                                     \
+     hook_index_exists(uc, idx##_IDX, begin, end))
+
+// Index of a hook list by address, so that the hooks covering an address are
+// found in O(log n + k) rather than by walking the list. It is rebuilt from
+// the list by the first query after the list changed.
+struct hook_index {
+    struct hook **bounded; // hooks with begin <= end, sorted by begin
+    size_t bounded_len;
+    uint64_t *max_end;  // segment tree of the greatest end among bounded
+    size_t tree_size;   // number of leaves of max_end, a power of 2
+    struct hook **unbounded; // hooks covering every address, in list order
+    size_t unbounded_len;
+    struct hook **found; // results of hook_index_find
+    bool dirty;
+};
 
-static inline bool _hook_exists_bounded(struct list_item *cur, uint64_t addr)
-{
-    while (cur != NULL) {
-        if (HOOK_BOUND_CHECK((struct hook *)cur->data, addr))
-            return true;
-        cur = cur->next;
-    }
-    return false;
-}
+// Does any live hook of the list idx cover part of [begin, end]?
+bool hook_index_exists(struct uc_struct *uc, int idx, uint64_t begin,
+                       uint64_t end);
+
+// Find the live hooks of the list idx covering part of [begin, end]. They are
+// stored in *found in list order, which stays valid until the hooks change.
+size_t hook_index_find(struct uc_struct *uc, int idx, uint64_t begin,
+                       uint64_t end, struct hook ***found);
 
 // relloc increment, KEEP THIS A POWER OF 2!
 #define MEM_BLOCK_INCR 32
@@ -283,13 +326,19 @@ struct uc_struct {
     uc_args_uc_ram_size_t memory_map;
     uc_args_uc_ram_size_ptr_t memory_map_ptr;
     uc_mem_unmap_t memory_unmap;
+    uc_mem_split_t memory_split;
+    uc_args_uc_t memory_unmap_all; // no TLB flush, see uc_reset()
+    uc_args_uc_t memory_begin;     // see uc_mem_map_begin()
+    uc_args_uc_t memory_commit;
     uc_readonly_mem_t readonly_mem;
     uc_mem_redirect_t mem_redirect;
     uc_cpus_init cpus_init;
     uc_target_page_init target_page;
     uc_softfloat_initialize softfloat_initialize;
     uc_tcg_flush_tlb tcg_flush_tlb;
+    uc_vmem_translate_t vmem_translate;
     uc_invalidate_tb_t uc_invalidate_tb;
+    uc_invalidate_tb_ram_t uc_invalidate_tb_ram;
     uc_gen_tb_t uc_gen_tb;
     uc_tb_flush_t tb_flush;
     uc_add_inline_hook_t add_inline_hook;
@@ -316,6 +365,7 @@ struct uc_struct {
     TargetPageBits *init_target_page;
     int target_bits; // User defined page bits by uc_ctl
     int cpu_model;
+    int cpu_model_ctl; // cpu_model before the arch resolves it, see uc_clone()
     BounceBuffer bounce;                // qemu/cpu-exec.c
     volatile sig_atomic_t exit_request; // qemu/cpu-exec.c
     /* qemu/accel/tcg/cpu-exec-common.c */
@@ -336,17 +386,24 @@ struct uc_struct {
     QTAILQ_HEAD(, AddressSpace) address_spaces;
     GHashTable *flat_views;
     bool memory_region_update_pending;
+    int memory_region_transaction_depth;
+    GSList *memory_unmapped; // regions unmapped in the open transaction
+    // guest and host ranges changed since the last commit, whose TLB entries
+    // the commit flushes
+    uint64_t memory_flush_first, memory_flush_last;
+    uintptr_t memory_flush_host_first, memory_flush_host_last;
 
     // linked lists containing hooks per type
     struct list hook[UC_HOOK_MAX];
+    struct hook_index hook_index[UC_HOOK_MAX];
+    int64_t hook_seq;
     struct list hooks_to_del;
     int hooks_count[UC_HOOK_MAX];
 
-    // hook to count number of instructions for uc_emu_start()
-    uc_hook count_hook;
-
-    size_t emu_counter; // current counter of uc_emu_start()
-    size_t emu_count;   // save counter of uc_emu_start()
+    size_t emu_counter; // instructions retired by the last counted
+                        // uc_emu_start(), see UC_QUERY_INSN_COUNT
+    size_t emu_count;   // instruction budget of uc_emu_start(), consumed
+                        // inline by the translated code (gen_tb_start)
 
     int size_recur_mem; // size for mem access when in a recursive call
 
@@ -358,22 +415,52 @@ struct uc_struct {
     bool emulation_done; // emulation is done by uc_emu_start()
     bool timed_out;      // emulation timed out, that can retrieve via
                          // uc_query(UC_QUERY_TIMEOUT)
-    QemuThread timer;    // timer for emulation timeout
     uint64_t timeout;    // timeout for uc_emu_start()
+    int timeout_clock;   // uc_timeout_clock the timeout is measured with
+    // Protected by the lock of the timer service in uc.c
+    bool timer_armed;               // queued in the timer service
+    int64_t timer_deadline;         // get_clock() when the timeout expires
+    struct uc_struct *timer_next;   // next engine to time out
 
     uint64_t invalid_addr; // invalid address to be accessed
     int invalid_error;     // invalid memory code: 1 = READ, 2 = WRITE, 3 = CODE
 
     int use_exits;
     uint64_t exits[UC_MAX_NESTED_LEVEL]; // When multiple exits is not enabled.
+    // The TBs at the exits of the last outermost run are kept until the exits
+    // change, see uc_drop_exit_tbs()
+    bool exit_tbs_cached;
+    bool exit_tbs_use_exits; // use_exits of that run
+    uint64_t exit_tbs_exit;  // exits[0] of that run
     GTree *ctl_exits; // addresses where emulation stops (@until param of
                       // uc_emu_start()) Also see UC_CTL_USE_EXITS for more
                       // details.
 
+    GHashTable *breakpoints;  // see UC_CTL_UC_BREAKPOINT_ADD
+    bool breakpoint_resume;   // uc_emu_start() begins at a breakpoint
+    bool breakpoint_skip;     // translating a TB resumed from a breakpoint
+    uint64_t breakpoint_skip_pc;
+    bool breakpoint_hit;      // the last uc_emu_start() stopped at a breakpoint
+    uint64_t breakpoint_hit_pc;
+    uint64_t breakpoint_stop_pc; // where that breakpoint left the pc
+    bool breakpoint_in_slot;  // set by the code stopping in a delay slot
+    uint64_t breakpoint_slot_pc;
+    uint8_t *coverage_map;  // see UC_CTL_UC_COVERAGE_MAP
+    uint32_t coverage_mask; // map size - 1
+    uint32_t coverage_prev; // previous block location, updated by the TBs
+    uc_cmplog_entry *cmplog_buf; // see UC_CTL_UC_CMPLOG
+    uint32_t cmplog_size;        // capacity of cmplog_buf
+    uint32_t cmplog_count;       // pending entries, updated by the TBs
+    uint32_t cmplog_sites;       // comparisons logged by the TB translated
+    uc_cb_cmplog_t cmplog_cb;
+    void *cmplog_data;
+
     int thumb; // thumb mode for ARM
     MemoryRegion **mapped_blocks;
     uint32_t mapped_block_count;
-    uint32_t mapped_block_cache_index;
+    void **mapped_table; // page table of the blocks, see memory_mapping()
+    int mapped_table_shift;
+    int mapped_table_levels;
     void *qemu_thread_data; // to support cross compile to Windows
                             // (qemu-thread-win32.c)
     uint32_t target_page_size;
@@ -383,6 +470,10 @@ struct uc_struct {
     int qemu_icache_linesize;
     /* ARCH_REGS_STORAGE_SIZE */
     int cpu_context_size;
+    // The CPU state split in register classes, NULL if the arch can only
+    // save all of it
+    const struct uc_context_range *context_ranges;
+    int context_range_count;
     uint64_t next_pc; // save next PC for some special cases
     bool hook_insert; // insert new hook at begin of the hook list (append by
                       // default)
@@ -398,6 +489,24 @@ struct uc_struct {
     struct TranslationBlock *last_tb; // The real last tb we executed.
 
     FlatView *empty_view; // Static function variable moved from flatviews_init
+
+    int context_content; // see UC_CTL_CONTEXT_MODE
+    int context_regs;    // see UC_CTL_CONTEXT_REGS
+    uint64_t mem_epoch;  // the snapshot the RAM dirty bitmaps are relative to,
+                         // 0 once the memory map changed. Epochs are unique
+                         // among all the engines of the process.
+
+    void *init_cpu_state; // CPU state right after uc_open(), see uc_reset()
+};
+
+// A RAM region saved in a uc_context, see UC_CTL_CONTEXT_MEMORY
+struct uc_context_region {
+    uint64_t begin;
+    uint64_t end;
+    uint32_t perms;
+    void *host;      // the user memory of uc_mem_map_ptr(), NULL otherwise
+    RAMBlock *block; // the block, only valid while the epoch is current
+    uint8_t *data;
 };
 
 // Metadata stub for the variable-size cpu context used with uc_context_*()
@@ -405,12 +514,71 @@ struct uc_context {
     size_t context_size; // size of the real internal context structure
     uc_mode mode;        // the mode of this context
     uc_arch arch;        // the arch of this context
-    char data[0];        // context
+    int regs;            // the register classes saved, see uc_context_regs
+    // RAM saved with UC_CTL_CONTEXT_MEMORY, NULL if not saved
+    struct uc_context_region *regions;
+    size_t region_count;
+    uint64_t mem_epoch; // see uc_struct.mem_epoch
+    char data[0];       // context
+};
+
+// Snapshot file written by uc_snapshot_save(), all integers in host byte
+// order:
+//   struct uc_snapshot_header
+//   struct uc_snapshot_region, region_count times
+//   the CPU state as saved by uc_context_save(), cpu_size bytes at cpu_offset.
+//   It is raw host data, hence byte_order, pointer_size and uc_version.
+//   cpu_size is 0 on arches whose contexts hold no CPU state, e.g. SPARC64.
+//   for each region, a bitmap of the pages stored in the file at
+//   bitmap_offset, one bit per target page, least significant bit first
+//   for each region, its content at data_offset, UC_SNAPSHOT_ALIGN aligned
+//   and padded. Pages not stored are zero and left as holes in the file.
+#define UC_SNAPSHOT_MAGIC "UCSNAP\0"
+#define UC_SNAPSHOT_VERSION 2
+#define UC_SNAPSHOT_ALIGN 0x10000
+// reads back as 0x04030201 on a host of the other byte order
+#define UC_SNAPSHOT_BYTE_ORDER 0x01020304
+
+struct uc_snapshot_header {
+    char magic[8];        // UC_SNAPSHOT_MAGIC
+    uint32_t version;     // UC_SNAPSHOT_VERSION
+    uint32_t header_size; // sizeof(struct uc_snapshot_header)
+    uint32_t arch;        // uc_arch
+    uint32_t mode;        // uc_mode
+    int32_t cpu_model;    // see UC_CTL_CPU_MODEL
+    uint32_t page_size;   // target page size
+    uint32_t region_count;
+    uint32_t cpu_size;
+    uint32_t byte_order;   // UC_SNAPSHOT_BYTE_ORDER
+    uint32_t pointer_size; // sizeof(void *)
+    uint32_t uc_version;   // uc_version() of the library which wrote it
+    uint32_t reserved;
+    uint64_t cpu_offset;
+};
+
+struct uc_snapshot_region {
+    uint64_t begin;
+    uint64_t end;
+    uint32_t perms;
+    uint32_t reserved;
+    uint64_t bitmap_offset;
+    uint64_t data_offset;
 };
 
 // check if this address is mapped in (via uc_mem_map())
 MemoryRegion *memory_mapping(struct uc_struct *uc, uint64_t address);
 
+// point the pages of [begin, end) to mr in the memory_mapping() table, or to
+// nothing if mr is NULL
+void memory_mapping_set(struct uc_struct *uc, uint64_t begin, uint64_t end,
+                        MemoryRegion *mr);
+
+// empty the memory_mapping() table
+void memory_mapping_clear(struct uc_struct *uc);
+
+// Drop the TB which stops at the exit *key of uc data, for g_tree_foreach
+gboolean uc_exit_invalidate_iter(gpointer key, gpointer val, gpointer data);
+
 // We have to support 32bit system so we can't hold uint64_t on void*
 static inline void uc_add_exit(uc_engine *uc, uint64_t addr)
 {
@@ -421,7 +589,7 @@ static inline void uc_add_exit(uc_engine *uc, uint64_t addr)
 
 // This function has to exist since we would like to accept uint32_t or
 // it's complex to achieve so.
-static inline int uc_addr_is_exit(uc_engine *uc, uint64_t addr)
+static inline int uc_addr_is_until(uc_engine *uc, uint64_t addr)
 {
     if (uc->use_exits) {
         return g_tree_lookup(uc->ctl_exits, (gpointer)(&addr)) == (gpointer)1;
@@ -430,6 +598,72 @@ static inline int uc_addr_is_exit(uc_engine *uc, uint64_t addr)
     }
 }
 
+static inline bool uc_addr_is_breakpoint(uc_engine *uc, uint64_t addr)
+{
+    return g_hash_table_size(uc->breakpoints) != 0 &&
+           g_hash_table_lookup(uc->breakpoints, (gpointer)(&addr)) != NULL;
+}
+
+// Should the translated code stop emulation before the instruction at addr?
+static inline int uc_addr_is_exit(uc_engine *uc, uint64_t addr)
+{
+    if (uc_addr_is_breakpoint(uc, addr) &&
+        !(uc->breakpoint_skip && uc->breakpoint_skip_pc == addr)) {
+        return 1;
+    }
+    return uc_addr_is_until(uc, addr);
+}
+
+// Is this the user memory of uc_mem_map_ptr()?
+static inline bool uc_ram_block_is_prealloc(RAMBlock *block)
+{
+    return block->flags & RAM_PREALLOC;
+}
+
+// Record guest writes to RAM for memory snapshots (UC_CTL_CONTEXT_MEMORY),
+// for uc_mem_dirty_pages() and for uc_clone().
+static inline void uc_ram_block_set_dirty(uc_engine *uc, RAMBlock *block,
+                                          ram_addr_t offset, ram_addr_t length)
+{
+    uint64_t page, last;
+
+    if (block == NULL || block->dirty == NULL || length == 0) {
+        return;
+    }
+
+    last = (offset + length - 1) / uc->target_page_size;
+    for (page = offset / uc->target_page_size; page <= last; page++) {
+        set_bit(page, block->dirty);
+        set_bit(page, block->dirty_log);
+        set_bit(page, block->written);
+        if (block->cow_written) {
+            set_bit(page, block->cow_written);
+        }
+    }
+}
+
+// Same as uc_ram_block_set_dirty() but with a ram_addr_t.
+static inline void uc_ram_set_dirty(uc_engine *uc, ram_addr_t addr,
+                                    ram_addr_t length)
+{
+    RAMBlock *block = uc->ram_list.mru_block;
+
+    if (block == NULL || addr - block->offset >= block->max_length) {
+        QLIST_FOREACH(block, &uc->ram_list.blocks, next)
+        {
+            if (addr - block->offset < block->max_length) {
+                break;
+            }
+        }
+        if (block == NULL) {
+            return;
+        }
+        uc->ram_list.mru_block = block;
+    }
+
+    uc_ram_block_set_dirty(uc, block, addr - block->offset, length);
+}
+
 typedef struct HookedRegion {
     uint64_t start;
     uint64_t length;
@@ -466,14 +700,20 @@ static inline void hooked_regions_add(struct hook *h, uint64_t start,
     }
 }
 
-static inline void hooked_regions_check_single(struct list_item *cur,
+static inline void hooked_regions_check_single(uc_engine *uc, int idx,
                                                uint64_t start, uint64_t length)
 {
-    while (cur != NULL) {
-        if (HOOK_BOUND_CHECK((struct hook *)cur->data, start)) {
-            hooked_regions_add((struct hook *)cur->data, start, length);
-        }
-        cur = cur->next;
+    struct hook **found;
+    size_t i, n;
+
+    if (uc->hook[idx].head == NULL) {
+        return;
+    }
+
+    n = hook_index_find(uc, idx, start, start + (length ? length - 1 : 0),
+                        &found);
+    for (i = 0; i < n; i++) {
+        hooked_regions_add(found[i], start, length);
     }
 }
 
@@ -481,9 +721,8 @@ static inline void hooked_regions_check(uc_engine *uc, uint64_t start,
                                         uint64_t length)
 {
     // Only UC_HOOK_BLOCK and UC_HOOK_CODE might be wrongle cached!
-    hooked_regions_check_single(uc->hook[UC_HOOK_CODE_IDX].head, start, length);
-    hooked_regions_check_single(uc->hook[UC_HOOK_BLOCK_IDX].head, start,
-                                length);
+    hooked_regions_check_single(uc, UC_HOOK_CODE_IDX, start, length);
+    hooked_regions_check_single(uc, UC_HOOK_BLOCK_IDX, start, length);
 }
 
 #ifdef UNICORN_TRACER
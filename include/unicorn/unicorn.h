@@ -192,6 +192,8 @@ typedef enum uc_err {
     UC_ERR_HOOK_EXIST,      // hook for this event already existed
     UC_ERR_RESOURCE,        // Insufficient resource: uc_emu_start()
     UC_ERR_EXCEPTION,       // Unhandled CPU exception
+    UC_ERR_BREAKPOINT, // Quit emulation due to a breakpoint: uc_emu_start()
+                       // See UC_CTL_UC_BREAKPOINT_HIT
 } uc_err;
 
 /*
@@ -326,6 +328,33 @@ typedef enum uc_tcg_op_flag {
     UC_TCG_OP_FLAG_DIRECT = 1 << 1
 } uc_tcg_op_flag;
 
+// The kind of comparison recorded in a uc_cmplog_entry.
+typedef enum uc_cmplog_type {
+    // Subtraction, i.e. x86 sub and cmp, arm cmp and subs.
+    UC_CMPLOG_SUB = 0,
+    // Bitwise and, i.e. x86 test.
+    UC_CMPLOG_AND,
+} uc_cmplog_type;
+
+// An entry of the comparison log, see UC_CTL_UC_CMPLOG.
+typedef struct uc_cmplog_entry {
+    uint64_t address; // address of the instruction
+    uint64_t arg1;    // operands, truncated to @size bits
+    uint64_t arg2;
+    uint32_t size;    // operand size in bits
+    uint32_t type;    // uc_cmplog_type
+} uc_cmplog_entry;
+
+/*
+  Callback function draining the comparison log, see UC_CTL_UC_CMPLOG.
+
+  @entries: the logged comparisons, in execution order
+  @count: number of entries
+  @user_data: user data passed to UC_CTL_UC_CMPLOG
+*/
+typedef void (*uc_cb_cmplog_t)(uc_engine *uc, const uc_cmplog_entry *entries,
+                               size_t count, void *user_data);
+
 // All type of hooks for uc_hook_add() API.
 typedef enum uc_hook_type {
     // Hook all interrupt/syscall events
@@ -448,6 +477,16 @@ typedef struct uc_mem_region {
     uint32_t perms; // memory permissions of the region
 } uc_mem_region;
 
+/*
+  Host memory backing a piece of guest RAM
+  Retrieve the spans of a guest range with uc_mem_get_ptr()
+*/
+typedef struct uc_mem_span {
+    uint64_t address; // guest address of the span
+    void *ptr;        // host address of the span
+    size_t size;      // size of the span
+} uc_mem_span;
+
 // All type of queries for uc_query() API.
 typedef enum uc_query_type {
     // Dynamically query current hardware mode.
@@ -456,6 +495,10 @@ typedef enum uc_query_type {
     UC_QUERY_ARCH, // query architecture of engine (for ARM to query Thumb mode)
     UC_QUERY_TIMEOUT, // query if emulation stops due to timeout (indicated if
                       // result = True)
+    UC_QUERY_INSN_COUNT, // query the number of instructions retired by the
+                         // last uc_emu_start() with a non-zero @count. An
+                         // instruction stopped by uc_emu_stop() in a hook or
+                         // by an invalid memory access doesn't count.
 } uc_query_type;
 
 // The implementation of uc_ctl is like what Linux ioctl does but slightly
@@ -490,6 +533,42 @@ typedef enum uc_query_type {
 #define UC_CTL_WRITE(type, nr) UC_CTL(type, nr, UC_CTL_IO_WRITE)
 #define UC_CTL_READ_WRITE(type, nr) UC_CTL(type, nr, UC_CTL_IO_READ_WRITE)
 
+// What uc_context_save() and uc_context_restore() cover, see
+// UC_CTL_CONTEXT_MODE.
+typedef enum uc_context_content {
+    // The CPU context, this is the default.
+    UC_CTL_CONTEXT_CPU = 1,
+    // The content of all the RAM regions and the memory map. A restore only
+    // copies back the pages written since the context was saved or last
+    // restored and only drops the translated code of these pages, MMIO
+    // regions are left untouched.
+    UC_CTL_CONTEXT_MEMORY = 2,
+} uc_context_content;
+
+// Register classes the contexts cover, see UC_CTL_CONTEXT_REGS.
+typedef enum uc_context_regs {
+    // General purpose registers, program counter and flags.
+    UC_CTL_CONTEXT_REGS_GPR = 1,
+    // Floating point registers and their control state.
+    UC_CTL_CONTEXT_REGS_FP = 2,
+    // Vector registers and their control state.
+    UC_CTL_CONTEXT_REGS_VECTOR = 4,
+    // Everything else: segments, control and model specific registers...
+    UC_CTL_CONTEXT_REGS_SYSTEM = 8,
+    // The whole CPU state, this is the default.
+    UC_CTL_CONTEXT_REGS_ALL = 0xf,
+} uc_context_regs;
+
+// Clocks the @timeout of uc_emu_start() can be measured with.
+// See UC_CTL_UC_TIMEOUT_CLOCK.
+typedef enum uc_timeout_clock {
+    // Microseconds of host time, this is the default.
+    UC_TIMEOUT_CLOCK_HOST = 0,
+    // Retired guest instructions. The timeout is checked at TB boundaries
+    // without any host thread, so runs stop at reproducible points.
+    UC_TIMEOUT_CLOCK_VIRTUAL,
+} uc_timeout_clock;
+
 // All type of controls for uc_ctl API.
 // The controls are organized in a tree level.
 // If a control don't have `Set` or `Get` for @args, it means it's r/o or w/o.
@@ -536,7 +615,60 @@ typedef enum uc_control_type {
     UC_CTL_TB_REMOVE_CACHE,
     // Invalidate all translation blocks.
     // No arguments.
-    UC_CTL_TB_FLUSH
+    UC_CTL_TB_FLUSH,
+    // The clock the timeout of uc_emu_start() is measured with.
+    // See uc_timeout_clock.
+    // Write: @args = (int)
+    // Read: @args = (int*)
+    UC_CTL_UC_TIMEOUT_CLOCK,
+    // Add breakpoints. The emulation stops before executing the instruction at
+    // a breakpoint and uc_emu_start() returns UC_ERR_BREAKPOINT. Starting the
+    // emulation at a breakpoint executes it.
+    // On MIPS, a breakpoint in a delay slot stops before the branch: the PC
+    // is left at the branch and the breakpoint hit is the delay slot.
+    // Starting the emulation at that branch executes both.
+    // Write: @args = (uint64_t* addresses, size_t len)
+    UC_CTL_UC_BREAKPOINT_ADD,
+    // Remove breakpoints, addresses which are not breakpoints are ignored.
+    // Write: @args = (uint64_t* addresses, size_t len)
+    UC_CTL_UC_BREAKPOINT_DEL,
+    // The breakpoint the last uc_emu_start() stopped at. Reading it returns
+    // UC_ERR_ARG if that run didn't stop at a breakpoint.
+    // Read: @args = (uint64_t*)
+    UC_CTL_UC_BREAKPOINT_HIT,
+    // Set the AFL-style edge coverage map, NULL disables coverage. Every
+    // translated block increments map[(cur ^ prev) & (size - 1)] inline, with
+    // no callback, where cur is a hash of the block address and prev is the
+    // previous block's cur >> 1. prev is reset to 0 by uc_emu_start(). @size
+    // must be a power of two and the map must stay valid while it is set.
+    // Read: @args = (uint8_t **map, size_t *size)
+    // Write: @args = (uint8_t *map, size_t size)
+    UC_CTL_UC_COVERAGE_MAP,
+    // Set the comparison log, a NULL buffer disables it. Comparisons (see
+    // uc_cmplog_type) are appended to the buffer by the translated code, with
+    // no callback per comparison. The callback drains the buffer before a
+    // block whose comparisons it can't hold and when uc_emu_start() returns.
+    // A block never logs more comparisons than @count, the ones of an
+    // instruction which don't fit in the buffer any more are dropped.
+    // Changing the log drains the pending entries and flushes the TB cache.
+    // Write: @args = (uc_cmplog_entry *buffer, size_t count,
+    //                 uc_cb_cmplog_t callback, void *user_data)
+    UC_CTL_UC_CMPLOG,
+    // What the contexts save and restore, a combination of
+    // uc_context_content.
+    // Read: @args = (int*)
+    // Write: @args = (int)
+    UC_CTL_CONTEXT_MODE,
+    // The register classes of the contexts allocated from now on, a
+    // combination of uc_context_regs. uc_context_save() and
+    // uc_context_restore() only copy these, the other registers of the context
+    // are undefined. The contexts keep the size of the whole CPU state. Only
+    // x86, ARM and ARM64 support a subset of UC_CTL_CONTEXT_REGS_ALL, the other
+    // arches reject it with UC_ERR_ARG. On ARM, the MPU and SAU regions are
+    // only covered by UC_CTL_CONTEXT_REGS_ALL, as are the x86 debug registers.
+    // Read: @args = (int*)
+    // Write: @args = (int)
+    UC_CTL_CONTEXT_REGS
 
 } uc_control_type;
 
@@ -612,6 +744,31 @@ See sample_ctl.c for a detailed example.
 #define uc_ctl_request_cache(uc, address, tb)                                  \
     uc_ctl(uc, UC_CTL_READ_WRITE(UC_CTL_TB_REQUEST_CACHE, 2), (address), (tb))
 #define uc_ctl_flush_tlb(uc) uc_ctl(uc, UC_CTL_WRITE(UC_CTL_TB_FLUSH, 0))
+#define uc_ctl_get_timeout_clock(uc, ptr)                                      \
+    uc_ctl(uc, UC_CTL_READ(UC_CTL_UC_TIMEOUT_CLOCK, 1), (ptr))
+#define uc_ctl_set_timeout_clock(uc, clock)                                    \
+    uc_ctl(uc, UC_CTL_WRITE(UC_CTL_UC_TIMEOUT_CLOCK, 1), (clock))
+#define uc_ctl_add_breakpoints(uc, buffer, len)                                \
+    uc_ctl(uc, UC_CTL_WRITE(UC_CTL_UC_BREAKPOINT_ADD, 2), (buffer), (len))
+#define uc_ctl_remove_breakpoints(uc, buffer, len)                             \
+    uc_ctl(uc, UC_CTL_WRITE(UC_CTL_UC_BREAKPOINT_DEL, 2), (buffer), (len))
+#define uc_ctl_get_breakpoint_hit(uc, ptr)                                     \
+    uc_ctl(uc, UC_CTL_READ(UC_CTL_UC_BREAKPOINT_HIT, 1), (ptr))
+#define uc_ctl_get_coverage_map(uc, map, size)                                 \
+    uc_ctl(uc, UC_CTL_READ(UC_CTL_UC_COVERAGE_MAP, 2), (map), (size))
+#define uc_ctl_set_coverage_map(uc, map, size)                                 \
+    uc_ctl(uc, UC_CTL_WRITE(UC_CTL_UC_COVERAGE_MAP, 2), (map), (size))
+#define uc_ctl_context_mode(uc, mode)                                          \
+    uc_ctl(uc, UC_CTL_WRITE(UC_CTL_CONTEXT_MODE, 1), (mode))
+#define uc_ctl_get_context_mode(uc, ptr)                                       \
+    uc_ctl(uc, UC_CTL_READ(UC_CTL_CONTEXT_MODE, 1), (ptr))
+#define uc_ctl_context_regs(uc, regs)                                          \
+    uc_ctl(uc, UC_CTL_WRITE(UC_CTL_CONTEXT_REGS, 1), (regs))
+#define uc_ctl_get_context_regs(uc, ptr)                                       \
+    uc_ctl(uc, UC_CTL_READ(UC_CTL_CONTEXT_REGS, 1), (ptr))
+#define uc_ctl_set_cmplog(uc, buffer, count, callback, user_data)              \
+    uc_ctl(uc, UC_CTL_WRITE(UC_CTL_UC_CMPLOG, 4), (buffer), (count),           \
+           (callback), (user_data))
 // Opaque storage for CPU context, used with uc_context_*()
 struct uc_context;
 typedef struct uc_context uc_context;
@@ -675,6 +832,82 @@ uc_err uc_open(uc_arch arch, uc_mode mode, uc_engine **uc);
 UNICORN_EXPORT
 uc_err uc_close(uc_engine *uc);
 
+/*
+ Bring a Unicorn engine instance back to the state uc_open() left it in,
+ without the cost of a uc_close()/uc_open() pair: all memory is unmapped, all
+ hooks are removed, the CPU registers get their initial values back and the
+ uc_ctl() settings are restored to their defaults. The CPU model and page size
+ are kept. Contexts remain valid.
+
+ @uc: handle returned by uc_open()
+ @keep_cache: keep the translated blocks. Only useful if the same code is
+   mapped again at the same addresses. The cache is flushed anyway if exits,
+   breakpoints, a coverage map, a comparison log or the virtual timeout clock
+   were set.
+
+ @return UC_ERR_OK on success, or other value on failure (refer to uc_err enum
+   for detailed error). This must not be called from a hook.
+*/
+UNICORN_EXPORT
+uc_err uc_reset(uc_engine *uc, bool keep_cache);
+
+/*
+ Create a new Unicorn engine instance from an existing one, with the same arch,
+ mode, CPU model, CPU state, memory map, memory content, hooks, exits and
+ breakpoints. The new instance is independent of @uc and can be used from
+ another thread, but the hook callbacks and user data, the MMIO callbacks and
+ the memory given to uc_mem_map_ptr() are shared with @uc.
+ On Linux, the RAM of uc_mem_map() is shared copy-on-write between @uc and
+ its clones: the first clone moves the pages written so far to a memfd, which
+ @uc and every clone then map privately. Later clones only copy the pages @uc
+ wrote since. Elsewhere, the pages written so far are copied.
+ NOTE: the hook handles of @uc are not valid for the clone, the translation
+ cache starts empty and the coverage map and comparison log are not inherited.
+
+ @uc: handle returned by uc_open()
+ @result: pointer to uc_engine, which will be updated at return time
+
+ @return UC_ERR_OK on success, or other value on failure (refer to uc_err enum
+   for detailed error). This must not be called from a hook.
+*/
+UNICORN_EXPORT
+uc_err uc_clone(uc_engine *uc, uc_engine **result);
+
+/*
+ Save the CPU state and the memory content of the engine to a snapshot file.
+ Only RAM regions are saved: MMIO regions and hooks are not. Pages never
+ written by the guest nor by uc_mem_write() are left as holes in the file.
+ NOTE: the file is in host byte order and holds the CPU state as laid out by
+ this build of Unicorn. uc_snapshot_load() rejects a file written on a host of
+ another byte order or pointer size, or by another version of Unicorn.
+ As with contexts, no CPU state is saved on SPARC64.
+
+ @uc: handle returned by uc_open()
+ @path: path of the file to create
+
+ @return UC_ERR_OK on success, or other value on failure (refer to uc_err enum
+   for detailed error).
+*/
+UNICORN_EXPORT
+uc_err uc_snapshot_save(uc_engine *uc, const char *path);
+
+/*
+ Load a snapshot file created by uc_snapshot_save(). All RAM regions of the
+ engine are replaced by the ones of the snapshot and the CPU state is restored;
+ MMIO regions and hooks are kept. Where possible the memory is mapped privately
+ from the file: pages are read when first touched and writes never reach the
+ file, which can be loaded again to go back to the snapshot.
+
+ @uc: handle returned by uc_open(), with the same arch, mode and CPU model as
+   the engine which saved the snapshot.
+ @path: path of the snapshot file
+
+ @return UC_ERR_OK on success, or other value on failure (refer to uc_err enum
+   for detailed error). This must not be called from a hook.
+*/
+UNICORN_EXPORT
+uc_err uc_snapshot_load(uc_engine *uc, const char *path);
+
 /*
  Query internal status of engine.
 
@@ -812,6 +1045,102 @@ uc_err uc_mem_write(uc_engine *uc, uint64_t address, const void *bytes,
 UNICORN_EXPORT
 uc_err uc_mem_read(uc_engine *uc, uint64_t address, void *bytes, size_t size);
 
+/*
+ Write to several ranges of bytes in memory, in order, with a single call.
+ A failing entry does not stop the others.
+
+ @uc: handle returned by uc_open()
+ @addresses: array of starting memory addresses to set.
+ @bytes: array of pointers to the data to be written to each range.
+ @sizes: array of sizes of the ranges.
+ @results: array receiving the status of each write, as uc_mem_write() would
+   return it. May be NULL.
+ @count: length of @addresses, @bytes, @sizes and @results.
+
+ @return UC_ERR_OK if every write succeeded, else the status of the first
+   failing entry (refer to uc_err enum for detailed error).
+*/
+UNICORN_EXPORT
+uc_err uc_mem_write_batch(uc_engine *uc, const uint64_t *addresses,
+                          const void *const *bytes, const size_t *sizes,
+                          uc_err *results, int count);
+
+/*
+ Read several ranges of bytes in memory with a single call.
+ A failing entry does not stop the others.
+
+ @uc: handle returned by uc_open()
+ @addresses: array of starting memory addresses to get.
+ @bytes: array of pointers to the buffers receiving each range.
+ @sizes: array of sizes of the ranges.
+ @results: array receiving the status of each read, as uc_mem_read() would
+   return it. May be NULL.
+ @count: length of @addresses, @bytes, @sizes and @results.
+
+ @return UC_ERR_OK if every read succeeded, else the status of the first
+   failing entry (refer to uc_err enum for detailed error).
+*/
+UNICORN_EXPORT
+uc_err uc_mem_read_batch(uc_engine *uc, const uint64_t *addresses,
+                         void *const *bytes, const size_t *sizes,
+                         uc_err *results, int count);
+
+/*
+ Translate a guest virtual address to a guest physical address, with the
+ current mode of the guest MMU (e.g. x86 paging, ARM stage 1 tables).
+ Translations cached in the TLB by the emulated code are reused, other pages
+ are looked up in the guest page tables without raising any exception. No
+ permission check is done.
+
+ NOTE: x86 guests see present pages at the same physical address, so on x86
+ the page tables only decide whether @address is mapped.
+
+ @uc: handle returned by uc_open()
+ @address: virtual address to translate.
+ @paddress: pointer receiving the physical address.
+
+ @return UC_ERR_OK on success, UC_ERR_READ_UNMAPPED if the page is not mapped
+   by the guest, or other value on failure (refer to uc_err enum for detailed
+   error).
+*/
+UNICORN_EXPORT
+uc_err uc_vmem_translate(uc_engine *uc, uint64_t address, uint64_t *paddress);
+
+/*
+ Read a range of bytes at a guest virtual address, translated as with
+ uc_vmem_translate(). The range may span several pages.
+
+ @uc: handle returned by uc_open()
+ @address: starting virtual address of bytes to get.
+ @bytes:   pointer to a variable containing data copied from memory.
+ @size:   size of memory to read.
+
+ @return UC_ERR_OK on success, UC_ERR_READ_UNMAPPED if a page is not mapped by
+   the guest or its physical memory is not mapped, or other value on failure
+   (refer to uc_err enum for detailed error).
+*/
+UNICORN_EXPORT
+uc_err uc_vmem_read(uc_engine *uc, uint64_t address, void *bytes, size_t size);
+
+/*
+ Write a range of bytes at a guest virtual address, translated as with
+ uc_vmem_translate(). The range may span several pages.
+
+ @uc: handle returned by uc_open()
+ @address: starting virtual address of bytes to set.
+ @bytes:   pointer to a variable containing data to be written to memory.
+ @size:   size of memory to write to.
+
+ NOTE: on failure, the pages before the failing one may already be written.
+
+ @return UC_ERR_OK on success, UC_ERR_WRITE_UNMAPPED if a page is not mapped by
+   the guest or its physical memory is not mapped, or other value on failure
+   (refer to uc_err enum for detailed error).
+*/
+UNICORN_EXPORT
+uc_err uc_vmem_write(uc_engine *uc, uint64_t address, const void *bytes,
+                     size_t size);
+
 /*
  Emulate machine code in a specific duration of time.
 
@@ -919,6 +1248,31 @@ typedef enum uc_prot {
 UNICORN_EXPORT
 uc_err uc_mem_map(uc_engine *uc, uint64_t address, size_t size, uint32_t perms);
 
+/*
+ Start a memory map transaction. Until uc_mem_map_commit(), the changes made
+ by uc_mem_map(), uc_mem_map_ptr(), uc_mem_map_file(), uc_mmio_map(),
+ uc_mem_unmap() and uc_mem_protect() are batched: the memory view of the guest
+ is rebuilt and the TLB flushed once at the commit, instead of once per call.
+ Reading or writing memory and starting the emulation apply the changes made
+ so far, so better keep them for after the commit.
+
+ @uc: handle returned by uc_open()
+
+ @return UC_ERR_OK on success, UC_ERR_ARG if a transaction is already open.
+*/
+UNICORN_EXPORT
+uc_err uc_mem_map_begin(uc_engine *uc);
+
+/*
+ Commit the memory map transaction started by uc_mem_map_begin().
+
+ @uc: handle returned by uc_open()
+
+ @return UC_ERR_OK on success, UC_ERR_ARG if no transaction is open.
+*/
+UNICORN_EXPORT
+uc_err uc_mem_map_commit(uc_engine *uc);
+
 /*
  Map existing host memory in for emulation.
  This API adds a memory region that can be used by emulation.
@@ -945,6 +1299,37 @@ UNICORN_EXPORT
 uc_err uc_mem_map_ptr(uc_engine *uc, uint64_t address, size_t size,
                       uint32_t perms, void *ptr);
 
+/*
+ Map a file in for emulation, without reading it.
+ The pages are read from the file when first accessed, so the cost of the
+ mapping does not depend on its size and engines mapping the same file share
+ the page cache. The engine keeps its own duplicate of @fd, which the caller
+ can close. Not available on Windows.
+
+ @uc: handle returned by uc_open()
+ @address: starting address of the new memory region to be mapped in.
+    This address must be aligned to 4KB, or this will return with UC_ERR_ARG
+ error.
+ @size: size of the new memory region to be mapped in.
+    This size must be a multiple of 4KB, or this will return with UC_ERR_ARG
+ error.
+ @perms: Permissions for the newly mapped region.
+    This must be some combination of UC_PROT_READ | UC_PROT_WRITE |
+ UC_PROT_EXEC, or this will return with UC_ERR_ARG error.
+ @fd: file descriptor of a file opened for reading, and for writing as well if
+   @shared is true. Memory file descriptors (memfd) work too.
+ @offset: offset of the region in the file, aligned to the host page size. The
+   file must hold @size bytes from there.
+ @shared: true to write guest changes back to the file, where other mappings
+   see them. Otherwise they are private to this region, copied on write.
+
+ @return UC_ERR_OK on success, or other value on failure (refer to uc_err enum
+   for detailed error).
+*/
+UNICORN_EXPORT
+uc_err uc_mem_map_file(uc_engine *uc, uint64_t address, size_t size,
+                       uint32_t perms, int fd, uint64_t offset, bool shared);
+
 /*
  Map MMIO in for emulation.
  This API adds a MMIO region that can be used by emulation.
@@ -1026,12 +1411,79 @@ uc_err uc_mem_protect(uc_engine *uc, uint64_t address, size_t size,
 UNICORN_EXPORT
 uc_err uc_mem_regions(uc_engine *uc, uc_mem_region **regions, uint32_t *count);
 
+/*
+ Retrieve which pages of a RAM range were written since the log was last
+ cleared. Both emulated stores and uc_mem_write() are logged, writes through
+ the host pointer given to uc_mem_map_ptr() are not. Pass @clear to reset the
+ log after each uc_emu_start() to only see the pages written by that run.
+
+ @uc: handle returned by uc_open()
+ @address: starting address of the range. This must be aligned to the page
+   size, see uc_ctl_get_page_size().
+ @size: size of the range. This must be a multiple of the page size.
+ @bitmap: buffer of at least (size / page_size + 7) / 8 bytes receiving one
+   bit per page, least significant bit first. A set bit means the page was
+   written.
+ @clear: true to also reset the log of the range.
+
+ @return UC_ERR_OK on success, UC_ERR_NOMEM if part of the range is not
+   mapped, or other value on failure (refer to uc_err enum for detailed error).
+   MMIO ranges are rejected with UC_ERR_ARG.
+*/
+UNICORN_EXPORT
+uc_err uc_mem_dirty_pages(uc_engine *uc, uint64_t address, size_t size,
+                          uint8_t *bitmap, bool clear);
+
+/*
+ Retrieve the host memory backing a RAM range, to access guest memory in place
+ instead of copying it with uc_mem_read() and uc_mem_write(). The range may
+ cross several regions, each contiguous piece of host memory is returned as one
+ span. The pointers stay valid until the next change of the memory map.
+
+ Writes through the pointers are not seen by the engine. Call
+ uc_mem_ptr_written() after them so that code translated from the range is
+ discarded and the pages are logged as dirty.
+
+ @uc: handle returned by uc_open()
+ @address: starting address of the range.
+ @size: size of the range.
+ @spans: array receiving the spans, in address order.
+ @count: on input, the number of entries of @spans. On output, the number of
+   spans of the range.
+
+ @return UC_ERR_OK on success, UC_ERR_NOMEM if part of the range is not
+   mapped, or other value on failure (refer to uc_err enum for detailed error).
+   MMIO ranges are rejected with UC_ERR_ARG, as are ranges needing more than
+   @count spans, in which case @count is set to the number needed.
+*/
+UNICORN_EXPORT
+uc_err uc_mem_get_ptr(uc_engine *uc, uint64_t address, size_t size,
+                      uc_mem_span *spans, uint32_t *count);
+
+/*
+ Tell the engine that a RAM range was written through the pointers given by
+ uc_mem_get_ptr(). The translated code of the range is invalidated and its
+ pages are logged as written, like after uc_mem_write().
+
+ @uc: handle returned by uc_open()
+ @address: starting address of the range written.
+ @size: size of the range written.
+
+ @return UC_ERR_OK on success, UC_ERR_NOMEM if part of the range is not
+   mapped, or other value on failure (refer to uc_err enum for detailed error).
+*/
+UNICORN_EXPORT
+uc_err uc_mem_ptr_written(uc_engine *uc, uint64_t address, size_t size);
+
 /*
  Allocate a region that can be used with uc_context_{save,restore} to perform
  quick save/rollback of the CPU context, which includes registers and some
  internal metadata. Contexts may not be shared across engine instances with
  differing arches or modes.
 
+ The context covers the register classes set with UC_CTL_CONTEXT_REGS at the
+ time of the allocation.
+
  @uc: handle returned by uc_open()
  @context: pointer to a uc_context*. This will be updated with the pointer to
    the new context on successful return of this function.
@@ -1061,6 +1513,9 @@ uc_err uc_free(void *mem);
  Save a copy of the internal CPU context.
  This API should be used to efficiently make or update a saved copy of the
  internal CPU state.
+ With UC_CTL_CONTEXT_MEMORY, the RAM regions are saved as well. Guest writes
+ and uc_mem_write() are tracked from then on, writes of the host to the memory
+ given to uc_mem_map_ptr() are not.
 
  @uc: handle returned by uc_open()
  @context: handle returned by uc_context_alloc()
@@ -1131,6 +1586,9 @@ uc_err uc_context_reg_read_batch(uc_context *ctx, int *regs, void **vals,
  Restore the current CPU context from a saved copy.
  This API should be used to roll the CPU context back to a previous
  state saved by uc_context_save().
+ With UC_CTL_CONTEXT_MEMORY, the RAM regions and the memory map are restored
+ as well. If no other context was saved or restored and the memory map didn't
+ change in the meantime, only the pages written since are copied back.
 
  @uc: handle returned by uc_open()
  @context: handle returned by uc_context_alloc that has been used with
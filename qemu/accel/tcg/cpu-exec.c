@@ -72,7 +72,10 @@ static inline tcg_target_ulong cpu_tb_exec(CPUState *cpu, TranslationBlock *itb)
          * of the start of the TB.
          */
         CPUClass *cc = CPU_GET_CLASS(cpu);
-        if (!HOOK_EXISTS(env->uc, UC_HOOK_CODE)) {
+        // Unicorn: when the instruction budget ran out, nothing of this TB
+        // was executed and the PC must always be synced, even with code hooks.
+        bool icount_expired = (int32_t)cpu_neg(cpu)->icount_decr.u32 >= 0;
+        if (!HOOK_EXISTS(env->uc, UC_HOOK_CODE) || icount_expired) {
             // We should sync pc for R/W error.
             switch (env->uc->invalid_error) {
                 case UC_ERR_WRITE_PROT:
@@ -109,7 +112,7 @@ static void cpu_exec_nocache(CPUState *cpu, int max_cycles,
                              TranslationBlock *orig_tb, bool ignore_icount)
 {
     TranslationBlock *tb;
-    uint32_t cflags = curr_cflags() | CF_NOCACHE;
+    uint32_t cflags = curr_cflags(cpu->uc) | CF_NOCACHE;
 
     if (ignore_icount) {
         cflags &= ~CF_USE_ICOUNT;
@@ -480,6 +483,13 @@ static inline bool cpu_handle_interrupt(CPUState *cpu,
         }
     }
 
+    /* Unicorn: the instruction budget of uc_emu_start() is exhausted. */
+    if (cpu->uc->emu_count &&
+        cpu_neg(cpu)->icount_decr.u16.low + cpu->icount_extra == 0) {
+        cpu->uc->stop_request = true;
+        cpu->exit_request = 1;
+    }
+
     /* Finally, check if we need to exit to the main loop.  */
     if (unlikely(cpu->exit_request)) {
         cpu->exit_request = 0;
@@ -522,6 +532,8 @@ static inline void cpu_loop_exec_tb(CPUState *cpu, TranslationBlock *tb,
     }
 
     /* Instruction counter expired.  */
+    /* Unicorn: the budget left is whatever the decrementer didn't consume. */
+    cpu->icount_budget = cpu_neg(cpu)->icount_decr.u16.low + cpu->icount_extra;
     /* Refill decrementer and continue execution.  */
     insns_left = MIN(0xffff, cpu->icount_budget);
     cpu_neg(cpu)->icount_decr.u16.low = insns_left;
@@ -592,7 +604,7 @@ int cpu_exec(struct uc_struct *uc, CPUState *cpu)
                have CF_INVALID set, -1 is a convenient invalid value that
                does not require tcg headers for cpu_common_reset.  */
             if (cflags == -1) {
-                cflags = curr_cflags();
+                cflags = curr_cflags(cpu->uc);
             } else {
                 cpu->cflags_next_tb = -1;
             }
@@ -326,6 +326,85 @@ void tlb_flush(CPUState *cpu)
     tlb_flush_by_mmuidx(cpu, ALL_MMUIDX_BITS);
 }
 
+static bool tlb_entry_in_range(CPUArchState *env, CPUTLBEntry *te,
+                               uint64_t first, uint64_t last,
+                               uintptr_t host_first, uintptr_t host_last)
+{
+#ifdef TARGET_ARM
+    struct uc_struct *uc = env->uc;
+#endif
+    target_ulong addrs[3] = {te->addr_read, te->addr_write, te->addr_code};
+    target_ulong page;
+    uintptr_t host;
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        if (addrs[i] == -1) {
+            continue;
+        }
+        if (addrs[i] & TLB_MMIO) {
+            return true;
+        }
+        page = addrs[i] & TARGET_PAGE_MASK;
+        if (page >= first && page <= last) {
+            return true;
+        }
+        host = (uintptr_t)page + te->addend;
+        if (host >= host_first && host <= host_last) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void tlb_flush_range(CPUState *cpu, uint64_t first, uint64_t last,
+                     uintptr_t host_first, uintptr_t host_last)
+{
+    CPUArchState *env = cpu->env_ptr;
+#ifdef TARGET_ARM
+    struct uc_struct *uc = cpu->uc;
+#endif
+    uint16_t dirty = env_tlb(env)->c.dirty;
+    CPUTLBDesc *desc;
+    CPUTLBDescFast *fast;
+    size_t i, n;
+    int mmu_idx;
+
+    for (mmu_idx = 0; mmu_idx < NB_MMU_MODES; mmu_idx++) {
+        if (!((dirty >> mmu_idx) & 1)) {
+            continue;
+        }
+        desc = &env_tlb(env)->d[mmu_idx];
+        fast = &env_tlb(env)->f[mmu_idx];
+        n = tlb_n_entries(fast);
+
+        if (first <= last && (last - first) >> TARGET_PAGE_BITS >= n) {
+            tlb_flush_one_mmuidx_locked(env, mmu_idx, get_clock_realtime());
+            continue;
+        }
+
+        for (i = 0; i < n; i++) {
+            if (tlb_entry_in_range(env, &fast->table[i], first, last,
+                                   host_first, host_last)) {
+                memset(&fast->table[i], -1, sizeof(fast->table[i]));
+                tlb_n_used_entries_dec(env, mmu_idx);
+            }
+        }
+        for (i = 0; i < CPU_VTLB_SIZE; i++) {
+            if (tlb_entry_in_range(env, &desc->vtable[i], first, last,
+                                   host_first, host_last)) {
+                memset(&desc->vtable[i], -1, sizeof(desc->vtable[i]));
+                tlb_n_used_entries_dec(env, mmu_idx);
+            }
+        }
+    }
+
+    // The jump cache is indexed by virtual address, it can't be flushed by
+    // host address.
+    cpu_tb_jmp_cache_clear(cpu);
+}
+
 void tlb_flush_by_mmuidx_all_cpus(CPUState *src_cpu, uint16_t idxmap)
 {
     const run_on_cpu_func fn = tlb_flush_by_mmuidx_async_work;
@@ -412,6 +491,75 @@ static void tlb_flush_page_locked(CPUArchState *env, int midx,
     }
 }
 
+static bool tlb_entry_is_ram(CPUTLBEntry *te)
+{
+    target_ulong addrs[3] = {te->addr_read, te->addr_write, te->addr_code};
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        if (addrs[i] != -1 && (addrs[i] & TLB_MMIO)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool tlb_vaddr_to_paddr(struct uc_struct *uc, uint64_t addr, uint64_t *paddr)
+{
+    CPUState *cpu = uc->cpu;
+    CPUArchState *env = cpu->env_ptr;
+    int mmu_idx = cpu_mmu_index(env, false);
+    CPUTLBDesc *desc = &env_tlb(env)->d[mmu_idx];
+    target_ulong page = addr & TARGET_PAGE_MASK;
+    CPUTLBEntry *entry = tlb_entry(env, mmu_idx, page);
+    CPUIOTLBEntry *iotlbentry = NULL;
+    ram_addr_t ram_addr;
+    RAMBlock *block;
+    MemTxAttrs attrs;
+    hwaddr phys;
+    size_t vidx;
+
+    if (tlb_hit_page_anyprot(uc, entry, page)) {
+        iotlbentry = &desc->iotlb[tlb_index(env, mmu_idx, page)];
+    } else {
+        for (vidx = 0; vidx < CPU_VTLB_SIZE; vidx++) {
+            entry = &desc->vtable[vidx];
+            if (tlb_hit_page_anyprot(uc, entry, page)) {
+                iotlbentry = &desc->viotlb[vidx];
+                break;
+            }
+        }
+    }
+
+    // The RAM entries hold the ram_addr_t of the page, see
+    // tlb_set_page_with_attrs().
+    if (iotlbentry && tlb_entry_is_ram(entry)) {
+        ram_addr = iotlbentry->addr + page;
+        block = uc->ram_list.mru_block;
+        if (block == NULL || ram_addr - block->offset >= block->used_length) {
+            RAMBLOCK_FOREACH(block) {
+                if (ram_addr - block->offset < block->used_length) {
+                    break;
+                }
+            }
+        }
+        if (block) {
+            *paddr = block->mr->addr + (ram_addr - block->offset) +
+                     (addr & ~TARGET_PAGE_MASK);
+            return true;
+        }
+    }
+
+    phys = cpu_get_phys_page_attrs_debug(cpu, page, &attrs);
+    if (phys == -1) {
+        return false;
+    }
+    *paddr = phys + (addr & ~TARGET_PAGE_MASK);
+
+    return true;
+}
+
 /**
  * tlb_flush_page_by_mmuidx_async_0:
  * @cpu: cpu on which to flush
@@ -852,6 +1000,22 @@ void tlb_set_page_with_attrs(CPUState *cpu, target_ulong vaddr,
     wp_flags = cpu_watchpoint_address_matches(cpu, vaddr_page,
                                               TARGET_PAGE_SIZE);
 
+    /*
+     * Unicorn: QEMU watchpoints are not supported, TLB_WATCHPOINT instead
+     * diverts the accesses to pages covered by a memory hook to the slow
+     * path where the hooks are called. Other pages keep the inline fast path.
+     */
+    if (HOOK_EXISTS_RANGE(env->uc, UC_HOOK_MEM_READ, vaddr_page,
+                          vaddr_page + TARGET_PAGE_SIZE - 1) ||
+        HOOK_EXISTS_RANGE(env->uc, UC_HOOK_MEM_READ_AFTER, vaddr_page,
+                          vaddr_page + TARGET_PAGE_SIZE - 1)) {
+        wp_flags |= BP_MEM_READ;
+    }
+    if (HOOK_EXISTS_RANGE(env->uc, UC_HOOK_MEM_WRITE, vaddr_page,
+                          vaddr_page + TARGET_PAGE_SIZE - 1)) {
+        wp_flags |= BP_MEM_WRITE;
+    }
+
     index = tlb_index(env, mmu_idx, vaddr_page);
     te = tlb_entry(env, mmu_idx, vaddr_page);
 
@@ -1161,6 +1325,7 @@ static void notdirty_write(CPUState *cpu, vaddr mem_vaddr, unsigned size,
      * the notdirty callback faster.
      */
     cpu_physical_memory_set_dirty_range(ram_addr, size, DIRTY_CLIENTS_NOCODE);
+    uc_ram_set_dirty(cpu->uc, ram_addr, size);
 
     /* We remove the notdirty callback only if the code has been flushed. */
     if (!cpu_physical_memory_is_clean(ram_addr)) {
@@ -1356,7 +1521,9 @@ static void *atomic_mmu_lookup(CPUArchState *env, target_ulong addr,
     }
 
     /* Let the guest notice RMW on a write-only page.  */
-    if (unlikely(tlbe->addr_read != (tlb_addr & ~TLB_NOTDIRTY))) {
+    /* Unicorn: a memory hook may cover the page for reads or writes only. */
+    if (unlikely((tlbe->addr_read & ~TLB_WATCHPOINT) !=
+                 (tlb_addr & ~(TLB_NOTDIRTY | TLB_WATCHPOINT)))) {
         tlb_fill(env_cpu(env), addr, 1 << s_bits, MMU_DATA_LOAD,
                  mmu_idx, retaddr);
         /* Since we don't support reads and writes to different addresses,
@@ -1414,6 +1581,60 @@ load_memop(const void *haddr, MemOp op)
     }
 }
 
+/*
+ * Unicorn: call the memory hooks of the list idx covering addr, in list order,
+ * until one handles the access (for the event hooks) or the emulation is asked
+ * to stop. They are found through the hook index rather than by walking the
+ * list, and copied out of it first since the callbacks may change the hooks.
+ */
+static bool uc_mem_hooks_call(struct uc_struct *uc, int idx, uc_mem_type type,
+                              target_ulong addr, int size, uint64_t value)
+{
+    struct hook *local[UC_HOOK_INLINE_MAX];
+    struct hook **found, **hooks;
+    struct hook *hook;
+    bool handled = false;
+    bool event = type != UC_MEM_READ && type != UC_MEM_WRITE &&
+                 type != UC_MEM_READ_AFTER;
+    size_t i, n;
+
+    if (uc->hook[idx].head == NULL) {
+        return false;
+    }
+
+    n = hook_index_find(uc, idx, addr, addr, &found);
+    hooks = n <= ARRAY_SIZE(local) ? local : g_new(struct hook *, n);
+    memcpy(hooks, found, n * sizeof(struct hook *));
+
+    for (i = 0; i < n; i++) {
+        hook = hooks[i];
+        // an earlier callback may have deleted it
+        if (hook->to_delete) {
+            continue;
+        }
+        if (event) {
+            handled = ((uc_cb_eventmem_t)hook->callback)(
+                uc, type, addr, size, value, hook->user_data);
+            if (handled) {
+                break;
+            }
+        } else {
+            ((uc_cb_hookmem_t)hook->callback)(uc, type, addr, size, value,
+                                              hook->user_data);
+        }
+
+        // the last callback may already asked to stop emulation
+        if (uc->stop_request) {
+            break;
+        }
+    }
+
+    if (hooks != local) {
+        g_free(hooks);
+    }
+    return handled;
+}
+
 static uint64_t inline
 load_helper(CPUArchState *env, target_ulong addr, TCGMemOpIdx oi,
             uintptr_t retaddr, MemOp op, bool code_read,
@@ -1432,9 +1653,7 @@ load_helper(CPUArchState *env, target_ulong addr, TCGMemOpIdx oi,
     uint64_t res;
     size_t size = memop_size(op);
     int error_code;
-    struct hook *hook;
     bool handled;
-    HOOK_FOREACH_VAR_DECLARE;
     struct uc_struct *uc = env->uc;
     MemoryRegion *mr = memory_mapping(uc, addr);
 
@@ -1446,33 +1665,13 @@ load_helper(CPUArchState *env, target_ulong addr, TCGMemOpIdx oi,
             if (code_read) {
                 // code fetching
                 error_code = UC_ERR_FETCH_UNMAPPED;
-                HOOK_FOREACH(uc, hook, UC_HOOK_MEM_FETCH_UNMAPPED) {
-                    if (hook->to_delete)
-                        continue;
-                    if (!HOOK_BOUND_CHECK(hook, addr))
-                        continue;
-                    if ((handled = ((uc_cb_eventmem_t)hook->callback)(uc, UC_MEM_FETCH_UNMAPPED, addr, size, 0, hook->user_data)))
-                        break;
-
-                    // the last callback may already asked to stop emulation
-                    if (uc->stop_request)
-                        break;
-                }
+                handled = uc_mem_hooks_call(uc, UC_HOOK_MEM_FETCH_UNMAPPED_IDX,
+                                            UC_MEM_FETCH_UNMAPPED, addr, size, 0);
             } else {
                 // data reading
                 error_code = UC_ERR_READ_UNMAPPED;
-                HOOK_FOREACH(uc, hook, UC_HOOK_MEM_READ_UNMAPPED) {
-                    if (hook->to_delete)
-                        continue;
-                    if (!HOOK_BOUND_CHECK(hook, addr))
-                        continue;
-                    if ((handled = ((uc_cb_eventmem_t)hook->callback)(uc, UC_MEM_READ_UNMAPPED, addr, size, 0, hook->user_data)))
-                        break;
-
-                    // the last callback may already asked to stop emulation
-                    if (uc->stop_request)
-                        break;
-                }
+                handled = uc_mem_hooks_call(uc, UC_HOOK_MEM_READ_UNMAPPED_IDX,
+                                            UC_MEM_READ_UNMAPPED, addr, size, 0);
             }
         } else {
             error_code = uc->invalid_error;
@@ -1488,6 +1687,9 @@ load_helper(CPUArchState *env, target_ulong addr, TCGMemOpIdx oi,
                 //                because qemu might generate tcg code like:
                 //                       qemu_ld_i64 x0,x1,leq,8  sync: 0  dead: 0 1
                 //                where we don't have a change to recover x0 value
+                // The instruction doesn't retire, don't count it and the
+                // rest of the TB.
+                cpu_restore_icount(uc->cpu, retaddr);
                 cpu_loop_exit(uc->cpu);
                 return 0;
             }
@@ -1497,6 +1699,7 @@ load_helper(CPUArchState *env, target_ulong addr, TCGMemOpIdx oi,
             // printf("***** Invalid fetch (unmapped memory) at " TARGET_FMT_lx "\n", addr);
             cpu_exit(uc->cpu);
             // See comments above
+            cpu_restore_icount(uc->cpu, retaddr);
             cpu_loop_exit(uc->cpu);
             return 0;
         }
@@ -1505,33 +1708,12 @@ load_helper(CPUArchState *env, target_ulong addr, TCGMemOpIdx oi,
     // now it is read on mapped memory
     if (!code_read) {
         // this is date reading
-        HOOK_FOREACH(uc, hook, UC_HOOK_MEM_READ) {
-            if (hook->to_delete)
-                continue;
-            if (!HOOK_BOUND_CHECK(hook, addr))
-                continue;
-            ((uc_cb_hookmem_t)hook->callback)(env->uc, UC_MEM_READ, addr, size, 0, hook->user_data);
-
-            // the last callback may already asked to stop emulation
-            if (uc->stop_request)
-                break;
-        }
+        uc_mem_hooks_call(uc, UC_HOOK_MEM_READ_IDX, UC_MEM_READ, addr, size, 0);
 
         // callback on non-readable memory
         if (mr != NULL && !(mr->perms & UC_PROT_READ)) {  //non-readable
-            handled = false;
-            HOOK_FOREACH(uc, hook, UC_HOOK_MEM_READ_PROT) {
-                if (hook->to_delete)
-                    continue;
-                if (!HOOK_BOUND_CHECK(hook, addr))
-                    continue;
-                if ((handled = ((uc_cb_eventmem_t)hook->callback)(uc, UC_MEM_READ_PROT, addr, size, 0, hook->user_data)))
-                    break;
-
-                // the last callback may already asked to stop emulation
-                if (uc->stop_request)
-                    break;
-            }
+            handled = uc_mem_hooks_call(uc, UC_HOOK_MEM_READ_PROT_IDX,
+                                        UC_MEM_READ_PROT, addr, size, 0);
 
             if (handled) {
                 uc->invalid_error = UC_ERR_OK;
@@ -1541,6 +1723,7 @@ load_helper(CPUArchState *env, target_ulong addr, TCGMemOpIdx oi,
                 // printf("***** Invalid memory read (non-readable) at " TARGET_FMT_lx "\n", addr);
                 cpu_exit(uc->cpu);
                 // See comments above
+                cpu_restore_icount(uc->cpu, retaddr);
                 cpu_loop_exit(uc->cpu);
                 return 0;
             }
@@ -1549,19 +1732,8 @@ load_helper(CPUArchState *env, target_ulong addr, TCGMemOpIdx oi,
         // code fetching
         // Unicorn: callback on fetch from NX
         if (mr != NULL && !(mr->perms & UC_PROT_EXEC)) {  // non-executable
-            handled = false;
-            HOOK_FOREACH(uc, hook, UC_HOOK_MEM_FETCH_PROT) {
-                if (hook->to_delete)
-                    continue;
-                if (!HOOK_BOUND_CHECK(hook, addr))
-                    continue;
-                if ((handled = ((uc_cb_eventmem_t)hook->callback)(uc, UC_MEM_FETCH_PROT, addr, size, 0, hook->user_data)))
-                    break;
-
-                // the last callback may already asked to stop emulation
-                if (uc->stop_request)
-                    break;
-            }
+            handled = uc_mem_hooks_call(uc, UC_HOOK_MEM_FETCH_PROT_IDX,
+                                        UC_MEM_FETCH_PROT, addr, size, 0);
 
             if (handled) {
                 uc->invalid_error = UC_ERR_OK;
@@ -1571,12 +1743,19 @@ load_helper(CPUArchState *env, target_ulong addr, TCGMemOpIdx oi,
                 // printf("***** Invalid fetch (non-executable) at " TARGET_FMT_lx "\n", addr);
                 cpu_exit(uc->cpu);
                 // See comments above
+                cpu_restore_icount(uc->cpu, retaddr);
                 cpu_loop_exit(uc->cpu);
                 return 0;
             }
         }
     }
 
+    // Unicorn: the callbacks may have flushed the TLB, e.g. by adding a
+    // memory hook, reload the entry.
+    index = tlb_index(env, mmu_idx, addr);
+    entry = tlb_entry(env, mmu_idx, addr);
+    tlb_addr = code_read ? entry->addr_code : entry->addr_read;
+
     /* Handle CPU specific unaligned behaviour */
     if (addr & ((1 << a_bits) - 1)) {
         cpu_unaligned_access(env_cpu(env), addr, access_type,
@@ -1596,8 +1775,12 @@ load_helper(CPUArchState *env, target_ulong addr, TCGMemOpIdx oi,
         tlb_addr &= ~TLB_INVALID_MASK;
     }
 
-    /* Handle anything that isn't just a straight memory access.  */
-    if (unlikely(tlb_addr & ~TARGET_PAGE_MASK)) {
+    /*
+     * Handle anything that isn't just a straight memory access.
+     * Unicorn: TLB_WATCHPOINT only brought us here for the memory hooks,
+     * which were called above already.
+     */
+    if (unlikely(tlb_addr & ~(TARGET_PAGE_MASK | TLB_WATCHPOINT))) {
         CPUIOTLBEntry *iotlbentry;
         bool need_swap;
 
@@ -1675,17 +1858,8 @@ _out:
     // Unicorn: callback on successful data read
     if (!code_read) {
         if (!uc->size_recur_mem) { // disabling read callback if in recursive call
-            HOOK_FOREACH(uc, hook, UC_HOOK_MEM_READ_AFTER) {
-                if (hook->to_delete)
-                    continue;
-                if (!HOOK_BOUND_CHECK(hook, addr))
-                    continue;
-                ((uc_cb_hookmem_t)hook->callback)(env->uc, UC_MEM_READ_AFTER, addr, size, res, hook->user_data);
-
-                // the last callback may already asked to stop emulation
-                if (uc->stop_request)
-                    break;
-            }
+            uc_mem_hooks_call(uc, UC_HOOK_MEM_READ_AFTER_IDX,
+                              UC_MEM_READ_AFTER, addr, size, res);
         }
     }
 
@@ -1981,7 +2155,6 @@ store_helper(CPUArchState *env, target_ulong addr, uint64_t val,
              TCGMemOpIdx oi, uintptr_t retaddr, MemOp op)
 {
     struct uc_struct *uc = env->uc;
-    HOOK_FOREACH_VAR_DECLARE;
     uintptr_t mmu_idx = get_mmuidx(oi);
     uintptr_t index = tlb_index(env, mmu_idx, addr);
     CPUTLBEntry *entry = tlb_entry(env, mmu_idx, addr);
@@ -1990,23 +2163,13 @@ store_helper(CPUArchState *env, target_ulong addr, uint64_t val,
     unsigned a_bits = get_alignment_bits(get_memop(oi));
     void *haddr;
     size_t size = memop_size(op);
-    struct hook *hook;
     bool handled;
     MemoryRegion *mr;
 
     if (!uc->size_recur_mem) { // disabling write callback if in recursive call
         // Unicorn: callback on memory write
-        HOOK_FOREACH(uc, hook, UC_HOOK_MEM_WRITE) {
-            if (hook->to_delete)
-                continue;
-            if (!HOOK_BOUND_CHECK(hook, addr))
-                continue;
-            ((uc_cb_hookmem_t)hook->callback)(uc, UC_MEM_WRITE, addr, size, val, hook->user_data);
-
-            // the last callback may already asked to stop emulation
-            if (uc->stop_request)
-                break;
-        }
+        uc_mem_hooks_call(uc, UC_HOOK_MEM_WRITE_IDX,
+                          UC_MEM_WRITE, addr, size, val);
     }
 
     // Load the latest memory mapping.
@@ -2014,19 +2177,8 @@ store_helper(CPUArchState *env, target_ulong addr, uint64_t val,
 
     // Unicorn: callback on invalid memory
     if (mr == NULL) {
-        handled = false;
-        HOOK_FOREACH(uc, hook, UC_HOOK_MEM_WRITE_UNMAPPED) {
-            if (hook->to_delete)
-                continue;
-            if (!HOOK_BOUND_CHECK(hook, addr))
-                continue;
-            if ((handled = ((uc_cb_eventmem_t)hook->callback)(uc, UC_MEM_WRITE_UNMAPPED, addr, size, val, hook->user_data)))
-                break;
-
-            // the last callback may already asked to stop emulation
-            if (uc->stop_request)
-                break;
-        }
+        handled = uc_mem_hooks_call(uc, UC_HOOK_MEM_WRITE_UNMAPPED_IDX,
+                                    UC_MEM_WRITE_UNMAPPED, addr, size, val);
 
         if (!handled) {
             // save error & quit
@@ -2049,19 +2201,8 @@ store_helper(CPUArchState *env, target_ulong addr, uint64_t val,
     // Unicorn: callback on non-writable memory
     if (mr != NULL && !(mr->perms & UC_PROT_WRITE)) {  //non-writable
         // printf("not writable memory???\n");
-        handled = false;
-        HOOK_FOREACH(uc, hook, UC_HOOK_MEM_WRITE_PROT) {
-            if (hook->to_delete)
-                continue;
-            if (!HOOK_BOUND_CHECK(hook, addr))
-                continue;
-            if ((handled = ((uc_cb_eventmem_t)hook->callback)(uc, UC_MEM_WRITE_PROT, addr, size, val, hook->user_data)))
-                break;
-
-            // the last callback may already asked to stop emulation
-            if (uc->stop_request)
-                break;
-        }
+        handled = uc_mem_hooks_call(uc, UC_HOOK_MEM_WRITE_PROT_IDX,
+                                    UC_MEM_WRITE_PROT, addr, size, val);
 
         if (handled) {
             uc->invalid_error = UC_ERR_OK;
@@ -2074,6 +2215,12 @@ store_helper(CPUArchState *env, target_ulong addr, uint64_t val,
         }
     }
 
+    // Unicorn: the callbacks may have flushed the TLB, e.g. by adding a
+    // memory hook, reload the entry.
+    index = tlb_index(env, mmu_idx, addr);
+    entry = tlb_entry(env, mmu_idx, addr);
+    tlb_addr = tlb_addr_write(entry);
+
     /* Handle CPU specific unaligned behaviour */
     if (addr & ((1 << a_bits) - 1)) {
         cpu_unaligned_access(env_cpu(env), addr, MMU_DATA_STORE,
@@ -2092,8 +2239,12 @@ store_helper(CPUArchState *env, target_ulong addr, uint64_t val,
         tlb_addr = tlb_addr_write(entry) & ~TLB_INVALID_MASK;
     }
 
-    /* Handle anything that isn't just a straight memory access.  */
-    if (unlikely(tlb_addr & ~TARGET_PAGE_MASK)) {
+    /*
+     * Handle anything that isn't just a straight memory access.
+     * Unicorn: TLB_WATCHPOINT only brought us here for the memory hooks,
+     * which were called above already.
+     */
+    if (unlikely(tlb_addr & ~(TARGET_PAGE_MASK | TLB_WATCHPOINT))) {
         CPUIOTLBEntry *iotlbentry;
         bool need_swap;
 
@@ -274,16 +274,12 @@ static int encode_search(struct uc_struct *uc, TranslationBlock *tb, uint8_t *bl
     return p - block;
 }
 
-/* The cpu state corresponding to 'searched_pc' is restored.
- * When reset_icount is true, current TB will be interrupted and
- * icount should be recalculated.
- */
-static int cpu_restore_state_from_tb(CPUState *cpu, TranslationBlock *tb,
-                                     uintptr_t searched_pc, bool reset_icount)
+/* Reconstruct the stored insn data of @tb up to the instruction which
+   contains @searched_pc, and return its index or -1 if there is none.  */
+static int tb_find_insn(TranslationBlock *tb, uintptr_t searched_pc,
+                        target_ulong *data)
 {
-    target_ulong data[TARGET_INSN_START_WORDS] = { tb->pc };
     uintptr_t host_pc = (uintptr_t)tb->tc.ptr;
-    CPUArchState *env = cpu->env_ptr;
     uint8_t *p = (uint8_t *)tb->tc.ptr + tb->tc.size;
     int i, j, num_insns = tb->icount;
 
@@ -301,16 +297,41 @@ static int cpu_restore_state_from_tb(CPUState *cpu, TranslationBlock *tb,
         }
         host_pc += decode_sleb128(&p);
         if (host_pc > searched_pc) {
-            goto found;
+            return i;
         }
     }
     return -1;
+}
+
+/* Unicorn: the instructions of @tb from @insn on didn't retire, give back
+   what they were charged to the uc_emu_start() budget.  */
+static void tb_restore_icount(CPUState *cpu, TranslationBlock *tb, int insn)
+{
+    if ((tb_cflags(tb) & CF_UC_ICOUNT) && insn < tb->icount_charged) {
+        cpu_neg(cpu)->icount_decr.u16.low += tb->icount_charged - insn;
+    }
+}
+
+/* The cpu state corresponding to 'searched_pc' is restored.
+ * When reset_icount is true, current TB will be interrupted and
+ * icount should be recalculated.
+ */
+static int cpu_restore_state_from_tb(CPUState *cpu, TranslationBlock *tb,
+                                     uintptr_t searched_pc, bool reset_icount)
+{
+    target_ulong data[TARGET_INSN_START_WORDS] = { tb->pc };
+    CPUArchState *env = cpu->env_ptr;
+    int i;
+
+    i = tb_find_insn(tb, searched_pc, data);
+    if (i < 0) {
+        return -1;
+    }
 
- found:
-    if (reset_icount && (tb_cflags(tb) & CF_USE_ICOUNT)) {
+    if (reset_icount) {
         /* Reset the cycle counter to the start of the block
            and shift if to the number of actually executed instructions */
-        cpu_neg(cpu)->icount_decr.u16.low += num_insns - i;
+        tb_restore_icount(cpu, tb, i);
     }
     restore_state_to_opc(env, tb, data);
 
@@ -356,6 +377,28 @@ bool cpu_restore_state(CPUState *cpu, uintptr_t host_pc, bool will_exit)
     return r;
 }
 
+void cpu_restore_icount(CPUState *cpu, uintptr_t host_pc)
+{
+    struct uc_struct *uc = cpu->uc;
+    target_ulong data[TARGET_INSN_START_WORDS] = { 0 };
+    TranslationBlock *tb;
+    int i;
+
+    /* See cpu_restore_state() */
+    if (host_pc - (uintptr_t)uc->tcg_ctx->code_gen_buffer >=
+        uc->tcg_ctx->code_gen_buffer_size) {
+        return;
+    }
+
+    tb = tcg_tb_lookup(uc->tcg_ctx, host_pc);
+    if (tb) {
+        i = tb_find_insn(tb, host_pc, data);
+        if (i >= 0) {
+            tb_restore_icount(cpu, tb, i);
+        }
+    }
+}
+
 static void page_init(struct uc_struct *uc)
 {
     page_size_init(uc);
@@ -989,6 +1032,12 @@ static void uc_tb_flush(struct uc_struct *uc) {
     tb_flush(uc->cpu);
 }
 
+static void uc_invalidate_tb_ram(struct uc_struct *uc, uint64_t start,
+                                 uint64_t end)
+{
+    tb_invalidate_phys_range(uc, start, end);
+}
+
 static void uc_invalidate_tb(struct uc_struct *uc, uint64_t start_addr, size_t len) 
 {
     tb_page_addr_t start, end;
@@ -1031,7 +1080,7 @@ static uc_err uc_gen_tb(struct uc_struct *uc, uint64_t addr, uc_tb *out_tb)
     uint32_t cflags = cpu->cflags_next_tb;
 
     if (cflags == -1) {
-        cflags = curr_cflags();
+        cflags = curr_cflags(uc);
     }
 
     cpu_get_tb_cpu_state(env, &pc, &cs_base, &flags);
@@ -1098,6 +1147,7 @@ void tcg_exec_init(struct uc_struct *uc, unsigned long tb_size)
     uc->l1_map = g_malloc0(sizeof(void *) * V_L1_MAX_SIZE);
     /* Invalidate / Cache TBs */
     uc->uc_invalidate_tb = uc_invalidate_tb;
+    uc->uc_invalidate_tb_ram = uc_invalidate_tb_ram;
     uc->uc_gen_tb = uc_gen_tb;
     uc->tb_flush = uc_tb_flush;
 
@@ -1811,7 +1861,7 @@ tb_invalidate_phys_page_range__locked(struct uc_struct *uc, struct page_collecti
     if (current_tb_modified) {
         page_collection_unlock(pages);
         /* Force execution of one insn next time.  */
-        cpu->cflags_next_tb = 1 | curr_cflags();
+        cpu->cflags_next_tb = 1 | curr_cflags(cpu->uc);
         mmap_unlock();
         cpu_loop_exit_noexc(cpu);
     }
@@ -1989,7 +2039,7 @@ void cpu_io_recompile(CPUState *cpu, uintptr_t retaddr)
 #endif
 
     /* Generate a new TB executing the I/O insn.  */
-    cpu->cflags_next_tb = curr_cflags() | CF_LAST_IO | n;
+    cpu->cflags_next_tb = curr_cflags(cpu->uc) | CF_LAST_IO | n;
 
     if (tb_cflags(tb) & CF_NOCACHE) {
         if (tb->orig_tb) {
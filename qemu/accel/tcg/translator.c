@@ -32,6 +32,64 @@ void translator_loop_temp_check(DisasContextBase *db)
 #endif
 }
 
+/* Unicorn: AFL-style edge coverage, see UC_CTL_UC_COVERAGE_MAP.
+   Emits map[cur ^ prev]++; prev = cur >> 1; where cur is known at
+   translation time.  The update is part of the TB body, so it also runs
+   when the TB is entered through a chained jump.  */
+static void gen_uc_coverage(TCGContext *tcg_ctx, struct uc_struct *uc,
+                            uint64_t pc)
+{
+    uint32_t cur = (uint32_t)((pc >> 4) ^ (pc << 8)) & uc->coverage_mask;
+    TCGv_ptr tuc = tcg_const_ptr(tcg_ctx, uc);
+    TCGv_ptr tmap = tcg_const_ptr(tcg_ctx, uc->coverage_map);
+    TCGv_ptr toff = tcg_temp_new_ptr(tcg_ctx);
+    TCGv_i32 tloc = tcg_temp_new_i32(tcg_ctx);
+
+    tcg_gen_ld_i32(tcg_ctx, tloc, tuc,
+                   offsetof(struct uc_struct, coverage_prev));
+    tcg_gen_xori_i32(tcg_ctx, tloc, tloc, cur);
+    tcg_gen_ext_i32_ptr(tcg_ctx, toff, tloc);
+    tcg_gen_add_ptr(tcg_ctx, tmap, tmap, toff);
+    tcg_gen_ld8u_i32(tcg_ctx, tloc, tmap, 0);
+    tcg_gen_addi_i32(tcg_ctx, tloc, tloc, 1);
+    tcg_gen_st8_i32(tcg_ctx, tloc, tmap, 0);
+    tcg_gen_movi_i32(tcg_ctx, tloc, cur >> 1);
+    tcg_gen_st_i32(tcg_ctx, tloc, tuc,
+                   offsetof(struct uc_struct, coverage_prev));
+
+    tcg_temp_free_i32(tcg_ctx, tloc);
+    tcg_temp_free_ptr(tcg_ctx, toff);
+    tcg_temp_free_ptr(tcg_ctx, tmap);
+    tcg_temp_free_ptr(tcg_ctx, tuc);
+}
+
+/* Unicorn: drain the comparison log, see UC_CTL_UC_CMPLOG, unless it has
+   room for all the comparisons of this TB.  Their number is only known at
+   the end of the translation, the returned op is patched with the limit.  */
+static TCGOp *gen_uc_cmplog_check(TCGContext *tcg_ctx, struct uc_struct *uc)
+{
+    TCGv_ptr tuc = tcg_const_ptr(tcg_ctx, uc);
+    TCGv_i32 tlimit = tcg_const_i32(tcg_ctx, 0xf2f2f2f2);
+    TCGOp *limit_op = tcg_last_op(tcg_ctx);
+    TCGv_i32 tcount = tcg_temp_new_i32(tcg_ctx);
+    TCGLabel *skip = gen_new_label(tcg_ctx);
+
+    tcg_gen_ld_i32(tcg_ctx, tcount, tuc,
+                   offsetof(struct uc_struct, cmplog_count));
+    tcg_gen_brcond_i32(tcg_ctx, TCG_COND_LEU, tcount, tlimit, skip);
+    tcg_temp_free_ptr(tcg_ctx, tuc);
+    /* Temps don't survive the branch, materialize the constant again. */
+    tuc = tcg_const_ptr(tcg_ctx, uc);
+    gen_helper_uc_cmplog_drain(tcg_ctx, tuc);
+    gen_set_label(tcg_ctx, skip);
+
+    tcg_temp_free_i32(tcg_ctx, tcount);
+    tcg_temp_free_i32(tcg_ctx, tlimit);
+    tcg_temp_free_ptr(tcg_ctx, tuc);
+
+    return limit_op;
+}
+
 void translator_loop(const TranslatorOps *ops, DisasContextBase *db,
                      CPUState *cpu, TranslationBlock *tb, int max_insns)
 {
@@ -39,6 +97,7 @@ void translator_loop(const TranslatorOps *ops, DisasContextBase *db,
     struct uc_struct *uc = (struct uc_struct *)cpu->uc;
     TCGContext *tcg_ctx = uc->tcg_ctx;
     TCGOp *prev_op = NULL;
+    TCGOp *cmplog_op = NULL;
     bool block_hook = false;
 
     /* Initialize DisasContext */
@@ -56,6 +115,11 @@ void translator_loop(const TranslatorOps *ops, DisasContextBase *db,
     /* Reset the temp count so that we can identify leaks */
     tcg_clear_temp_count();
 
+    /* Unicorn: don't stop at the breakpoint this TB resumes from */
+    uc->breakpoint_skip = (tb_cflags(tb) & CF_UC_BP_SKIP) != 0;
+    uc->breakpoint_skip_pc = tb->pc;
+    uc->cmplog_sites = 0;
+
     /* Unicorn: early check to see if the address of this block is
      * the "run until" address. */
     if (uc_addr_is_exit(uc, tb->pc)) {
@@ -64,27 +128,47 @@ void translator_loop(const TranslatorOps *ops, DisasContextBase *db,
         gen_tb_start(tcg_ctx, db->tb);
         ops->tb_start(db, cpu);
         db->num_insns++;
+        // The exit is not retired, don't charge it to the instruction budget.
+        bp_insn = 1;
         ops->insn_start(db, cpu);
+        tcg_ctx->pc_start = db->pc_next;
+        tcg_ctx->icount_insn = db->num_insns - 1;
         ops->translate_insn(db, cpu);
         goto _end_loop;
     }
 
+    // tcg_dump_ops(tcg_ctx, false, "translator loop");
+
+    /* Start translating.  */
+    gen_tb_start(tcg_ctx, db->tb);
+    // tcg_dump_ops(tcg_ctx, false, "tb start");
+
+    /* Unicorn: like the block hook below, count the block only once it is
+     * entered. */
+    if (uc->coverage_map) {
+        gen_uc_coverage(tcg_ctx, uc, tb->pc);
+    }
+
+    if (uc->cmplog_buf) {
+        cmplog_op = gen_uc_cmplog_check(tcg_ctx, uc);
+    }
+
     /* Unicorn: trace this block on request
      * Only hook this block if it is not broken from previous translation due to
      * full translation cache
+     *
+     * This is emitted after gen_tb_start() so that a block which is not
+     * entered, e.g. because the instruction budget runs out, doesn't trigger
+     * the hook twice.
      */
     if (HOOK_EXISTS_BOUNDED(uc, UC_HOOK_BLOCK, tb->pc)) {
         prev_op = tcg_last_op(tcg_ctx);
         block_hook = true;
         gen_uc_tracecode(tcg_ctx, 0xf8f8f8f8, UC_HOOK_BLOCK_IDX, uc, db->pc_first);
+        // The callback may want to stop emulation before the first instruction.
+        check_exit_request(tcg_ctx);
     }
 
-    // tcg_dump_ops(tcg_ctx, false, "translator loop");
-
-    /* Start translating.  */
-    gen_tb_start(tcg_ctx, db->tb);
-    // tcg_dump_ops(tcg_ctx, false, "tb start");
-
     ops->tb_start(db, cpu);
     // tcg_dump_ops(tcg_ctx, false, "tb start 2");
 
@@ -121,6 +205,11 @@ void translator_loop(const TranslatorOps *ops, DisasContextBase *db,
            update db->pc_next and db->is_jmp to indicate what should be
            done next -- either exiting this loop or locate the start of
            the next instruction.  */
+        /* Unicorn: the instruction address for the opcode hooks and the
+           comparison log emitted by the generic code, and its index for
+           the early exits of check_exit_request(). */
+        tcg_ctx->pc_start = db->pc_next;
+        tcg_ctx->icount_insn = db->num_insns - 1;
         ops->translate_insn(db, cpu);
         // tcg_dump_ops(tcg_ctx, false, "insn translate");
 
@@ -130,14 +219,18 @@ void translator_loop(const TranslatorOps *ops, DisasContextBase *db,
         }
 
         /* Stop translation if the output buffer is full,
-           or we have executed all of the allowed instructions.  */
-        if (tcg_op_buf_full(tcg_ctx) || db->num_insns >= db->max_insns) {
+           or we have executed all of the allowed instructions.
+           Unicorn: or the comparison log can't hold one more entry.  */
+        if (tcg_op_buf_full(tcg_ctx) || db->num_insns >= db->max_insns ||
+            (cmplog_op && uc->cmplog_sites >= uc->cmplog_size)) {
             db->is_jmp = DISAS_TOO_MANY;
             break;
         }
     }
 
 _end_loop:
+    uc->breakpoint_skip = false;
+
     /* Emit code to exit the TB, as indicated by db->is_jmp.  */
     ops->tb_stop(db, cpu);
     gen_tb_end(tcg_ctx, db->tb, db->num_insns - bp_insn);
@@ -149,6 +242,11 @@ _end_loop:
 
     hooked_regions_check(uc, db->tb->pc, db->tb->size);
 
+    if (cmplog_op) {
+        // Unicorn: leave room for the comparisons logged by this TB.
+        cmplog_op->args[1] = uc->cmplog_size - uc->cmplog_sites;
+    }
+
     if (block_hook) {
         TCGOp *tcg_op;
 
@@ -76,6 +76,7 @@
 #define qemu_ram_is_shared qemu_ram_is_shared_arm
 #define qemu_ram_pagesize qemu_ram_pagesize_arm
 #define qemu_ram_alloc_from_ptr qemu_ram_alloc_from_ptr_arm
+#define qemu_ram_alloc_slice qemu_ram_alloc_slice_arm
 #define qemu_ram_alloc qemu_ram_alloc_arm
 #define qemu_ram_free qemu_ram_free_arm
 #define qemu_map_ram_ptr qemu_map_ram_ptr_arm
@@ -120,6 +121,7 @@
 #define memory_map_io memory_map_io_arm
 #define memory_map_ptr memory_map_ptr_arm
 #define memory_unmap memory_unmap_arm
+#define memory_split memory_split_arm
 #define memory_free memory_free_arm
 #define flatview_unref flatview_unref_arm
 #define address_space_get_flatview address_space_get_flatview_arm
@@ -764,6 +766,8 @@
 #define tlb_init tlb_init_arm
 #define tlb_flush_by_mmuidx tlb_flush_by_mmuidx_arm
 #define tlb_flush tlb_flush_arm
+#define tlb_flush_range tlb_flush_range_arm
+#define tlb_vaddr_to_paddr tlb_vaddr_to_paddr_arm
 #define tlb_flush_by_mmuidx_all_cpus tlb_flush_by_mmuidx_all_cpus_arm
 #define tlb_flush_all_cpus tlb_flush_all_cpus_arm
 #define tlb_flush_by_mmuidx_all_cpus_synced tlb_flush_by_mmuidx_all_cpus_synced_arm
@@ -1243,6 +1247,7 @@
 #define helper_gvec_umax64 helper_gvec_umax64_arm
 #define helper_gvec_bitsel helper_gvec_bitsel_arm
 #define cpu_restore_state cpu_restore_state_arm
+#define cpu_restore_icount cpu_restore_icount_arm
 #define page_collection_lock page_collection_lock_arm
 #define page_collection_unlock page_collection_unlock_arm
 #define free_code_gen_buffer free_code_gen_buffer_arm
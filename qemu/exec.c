@@ -970,7 +970,10 @@ static ram_addr_t find_ram_offset(struct uc_struct *uc, ram_addr_t size)
         return 0;
     }
 
-    RAMBLOCK_FOREACH(block) {
+    /* Unicorn: walk the blocks by offset, so that the closest following
+     * block is found right away instead of with a walk of all the blocks.
+     */
+    QLIST_FOREACH(block, &uc->ram_list.blocks_by_offset, next_offset) {
         ram_addr_t candidate, next = RAM_ADDR_MAX;
 
         /* Align blocks to start on a 'long' in the bitmap
@@ -979,13 +982,16 @@ static ram_addr_t find_ram_offset(struct uc_struct *uc, ram_addr_t size)
         candidate = block->offset + block->max_length;
         candidate = ROUND_UP(candidate, BITS_PER_LONG << TARGET_PAGE_BITS);
 
-        /* Search for the closest following block
-         * and find the gap.
+        /* The blocks don't overlap, so the closest following block
+         * is the next one. The slices of a split block are not aligned,
+         * their gap may be swallowed by the alignment.
          */
-        RAMBLOCK_FOREACH(next_block) {
-            if (next_block->offset >= candidate) {
-                next = MIN(next, next_block->offset);
-            }
+        next_block = QLIST_NEXT(block, next_offset);
+        if (next_block) {
+            next = next_block->offset;
+        }
+        if (next < candidate) {
+            continue;
         }
 
         /* If it fits remember our place and remember the size
@@ -1032,27 +1038,11 @@ size_t qemu_ram_pagesize(RAMBlock *rb)
     return rb->page_size;
 }
 
-static void ram_block_add(struct uc_struct *uc, RAMBlock *new_block)
+static void ram_block_link(struct uc_struct *uc, RAMBlock *new_block)
 {
     RAMBlock *block;
     RAMBlock *last_block = NULL;
 
-    new_block->offset = find_ram_offset(uc, new_block->max_length);
-
-    if (!new_block->host) {
-        new_block->host = phys_mem_alloc(uc, new_block->max_length,
-                &new_block->mr->align);
-        if (!new_block->host) {
-            // mmap fails.
-            uc->invalid_error = UC_ERR_NOMEM;
-            // error_setg_errno(errp, errno,
-            //         "cannot set up guest memory '%s'",
-            //         memory_region_name(new_block->mr));
-            return;
-        }
-        // memory_try_enable_merging(new_block->host, new_block->max_length);
-    }
-
     /* Keep the list sorted from biggest to smallest block.  Unlike QTAILQ,
      * QLIST (which has an RCU-friendly variant) does not have insertion at
      * tail, so save the last element in last_block.
@@ -1070,7 +1060,42 @@ static void ram_block_add(struct uc_struct *uc, RAMBlock *new_block)
     } else { /* list is empty */
         QLIST_INSERT_HEAD_RCU(&uc->ram_list.blocks, new_block, next);
     }
+
+    last_block = NULL;
+    QLIST_FOREACH(block, &uc->ram_list.blocks_by_offset, next_offset) {
+        if (block->offset > new_block->offset) {
+            break;
+        }
+        last_block = block;
+    }
+    if (last_block) {
+        QLIST_INSERT_AFTER(last_block, new_block, next_offset);
+    } else {
+        QLIST_INSERT_HEAD(&uc->ram_list.blocks_by_offset, new_block,
+                          next_offset);
+    }
     uc->ram_list.mru_block = NULL;
+}
+
+static void ram_block_add(struct uc_struct *uc, RAMBlock *new_block)
+{
+    new_block->offset = find_ram_offset(uc, new_block->max_length);
+
+    if (!new_block->host) {
+        new_block->host = phys_mem_alloc(uc, new_block->max_length,
+                &new_block->mr->align);
+        if (!new_block->host) {
+            // mmap fails.
+            uc->invalid_error = UC_ERR_NOMEM;
+            // error_setg_errno(errp, errno,
+            //         "cannot set up guest memory '%s'",
+            //         memory_region_name(new_block->mr));
+            return;
+        }
+        // memory_try_enable_merging(new_block->host, new_block->max_length);
+    }
+
+    ram_block_link(uc, new_block);
 
     /* Write list before version */
     //smp_wmb();
@@ -1079,6 +1104,12 @@ static void ram_block_add(struct uc_struct *uc, RAMBlock *new_block)
                                         new_block->used_length,
                                         DIRTY_CLIENTS_ALL);
 
+    new_block->dirty = bitmap_new(new_block->max_length >> TARGET_PAGE_BITS);
+    new_block->dirty_log =
+        bitmap_new(new_block->max_length >> TARGET_PAGE_BITS);
+    new_block->written = bitmap_new(new_block->max_length >> TARGET_PAGE_BITS);
+    new_block->fd = -1;
+    new_block->host_refs = 1;
 }
 
 RAMBlock *qemu_ram_alloc_from_ptr(struct uc_struct *uc, ram_addr_t size, void *host,
@@ -1122,8 +1153,67 @@ RAMBlock *qemu_ram_alloc(struct uc_struct *uc, ram_addr_t size, MemoryRegion *mr
     return qemu_ram_alloc_from_ptr(uc, size, NULL, mr);
 }
 
-static void reclaim_ramblock(struct uc_struct *uc, RAMBlock *block)
+/* Unicorn: a block for the size bytes of block at offset, sharing its host
+ * memory, its ram addresses and its page state. This splits a region without
+ * copying it, and the code translated from it stays valid. The block must be
+ * freed right after, the new block takes its place.
+ */
+RAMBlock *qemu_ram_alloc_slice(struct uc_struct *uc, RAMBlock *block,
+                               ram_addr_t offset, ram_addr_t size,
+                               MemoryRegion *mr)
 {
+    RAMBlock *new_block;
+    unsigned long first = offset >> TARGET_PAGE_BITS;
+    unsigned long pages = size >> TARGET_PAGE_BITS;
+
+    new_block = g_malloc0(sizeof(*new_block));
+    new_block->mr = mr;
+    new_block->host = block->host + offset;
+    new_block->offset = block->offset + offset;
+    new_block->used_length = size;
+    new_block->max_length = size;
+    new_block->flags = block->flags & RAM_PREALLOC;
+    new_block->page_size = block->page_size;
+    new_block->fd = -1;
+
+#ifndef _WIN32
+    if (block->fd >= 0) {
+        new_block->fd = fcntl(block->fd, F_DUPFD_CLOEXEC, 0);
+        if (new_block->fd < 0) {
+            g_free(new_block);
+            return NULL;
+        }
+        new_block->fd_offset = block->fd_offset + offset;
+        new_block->fd_shared = block->fd_shared;
+    }
+#endif
+
+    new_block->dirty = bitmap_new(pages);
+    bitmap_copy_with_src_offset(new_block->dirty, block->dirty, first, pages);
+    new_block->dirty_log = bitmap_new(pages);
+    bitmap_copy_with_src_offset(new_block->dirty_log, block->dirty_log, first,
+                                pages);
+    new_block->written = bitmap_new(pages);
+    bitmap_copy_with_src_offset(new_block->written, block->written, first,
+                                pages);
+    if (block->cow_written) {
+        new_block->cow_written = bitmap_new(pages);
+        bitmap_copy_with_src_offset(new_block->cow_written,
+                                    block->cow_written, first, pages);
+    }
+
+    new_block->host_owner = block->host_owner ? block->host_owner : block;
+    new_block->host_owner->host_refs++;
+
+    ram_block_link(uc, new_block);
+    return new_block;
+}
+
+static void ram_block_unref_host(struct uc_struct *uc, RAMBlock *block)
+{
+    if (--block->host_refs) {
+        return;
+    }
     if (block->flags & RAM_PREALLOC) {
         ;
     } else if (false) {
@@ -1133,6 +1223,58 @@ static void reclaim_ramblock(struct uc_struct *uc, RAMBlock *block)
     g_free(block);
 }
 
+/* Unicorn: give back the host memory of a block whose owner stays alive for
+ * its other slices, unless the blocks which took its place on a split cover
+ * it. Pages shared with a neighbour on a host page are kept.
+ */
+static void ram_block_release_host(struct uc_struct *uc, RAMBlock *block,
+                                   RAMBlock *owner)
+{
+    RAMBlock *other;
+    uint8_t *begin, *end;
+
+    if ((owner->flags & RAM_PREALLOC) || owner->host_refs == 1) {
+        return;
+    }
+    RAMBLOCK_FOREACH(other) {
+        if ((other == owner || other->host_owner == owner) &&
+            other->host < block->host + block->used_length &&
+            block->host < other->host + other->used_length) {
+            return;
+        }
+    }
+
+    begin = (uint8_t *)QEMU_ALIGN_UP((uintptr_t)block->host,
+                                     uc->qemu_real_host_page_size);
+    end = (uint8_t *)QEMU_ALIGN_DOWN(
+        (uintptr_t)block->host + block->used_length,
+        uc->qemu_real_host_page_size);
+    if (begin < end) {
+        qemu_madvise(begin, end - begin, QEMU_MADV_DONTNEED);
+    }
+}
+
+static void reclaim_ramblock(struct uc_struct *uc, RAMBlock *block)
+{
+    RAMBlock *owner = block->host_owner ? block->host_owner : block;
+
+    ram_block_release_host(uc, block, owner);
+    g_free(block->dirty);
+    g_free(block->dirty_log);
+    g_free(block->written);
+    g_free(block->cow_written);
+#ifndef _WIN32
+    if (block->fd >= 0) {
+        close(block->fd);
+    }
+#endif
+    if (owner != block) {
+        g_free(block);
+    }
+    // The owner outlives its own region while its slices are mapped.
+    ram_block_unref_host(uc, owner);
+}
+
 void qemu_ram_free(struct uc_struct *uc, RAMBlock *block)
 {
     if (!block) {
@@ -1144,6 +1286,7 @@ void qemu_ram_free(struct uc_struct *uc, RAMBlock *block)
     //}
 
     QLIST_REMOVE_RCU(block, next);
+    QLIST_REMOVE(block, next_offset);
     uc->ram_list.mru_block = NULL;
     /* Write list before version */
     //smp_wmb();
@@ -1449,7 +1592,8 @@ static void tcg_commit(MemoryListener *listener)
      */
     d = address_space_to_dispatch(cpuas->as);
     cpuas->memory_dispatch = d;
-    tlb_flush(cpuas->cpu);
+    /* Unicorn: memory_region_transaction_commit() flushes the TLB entries
+     * of the regions changed. */
 }
 
 static uint64_t unassigned_io_read(struct uc_struct *uc, void* opaque, hwaddr addr, unsigned size)
@@ -1486,6 +1630,12 @@ static void memory_map_init(struct uc_struct *uc)
 static void invalidate_and_set_dirty(MemoryRegion *mr, hwaddr addr,
                                      hwaddr length)
 {
+    ram_addr_t start = memory_region_get_ram_addr(mr) + addr;
+
+    /* Unicorn: the TBs on the pages written are dropped, now that runs keep
+     * the translated code warm (see resume_all_vcpus()) */
+    tb_invalidate_phys_range(mr->uc, start, start + length);
+    uc_ram_block_set_dirty(mr->uc, mr->ram_block, addr, length);
 }
 
 static int memory_access_size(MemoryRegion *mr, unsigned l, hwaddr addr)
@@ -1550,6 +1700,7 @@ static MemTxResult flatview_write_continue(struct uc_struct *uc, FlatView *fv, h
             /* RAM case */
             ram_ptr = qemu_ram_ptr_length(fv->root->uc, mr->ram_block, addr1, &l, false);
             memcpy(ram_ptr, buf, l);
+            invalidate_and_set_dirty(mr, addr1, l);
         }
 
         if (release_lock) {
@@ -11,6 +11,9 @@ void cpu_list_lock(void);
 void cpu_list_unlock(void);
 
 void tcg_flush_softmmu_tlb(struct uc_struct *uc);
+/* Unicorn: guest virtual to physical address for uc_vmem_*(), looked up in
+ * the TLB first and walked with get_phys_page_debug() on a miss. */
+bool tlb_vaddr_to_paddr(struct uc_struct *uc, uint64_t addr, uint64_t *paddr);
 
 enum device_endian {
     DEVICE_NATIVE_ENDIAN,
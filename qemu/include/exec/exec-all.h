@@ -55,6 +55,16 @@ void restore_state_to_opc(CPUArchState *env, TranslationBlock *tb,
  */
 bool cpu_restore_state(CPUState *cpu, uintptr_t searched_pc, bool will_exit);
 
+/**
+ * cpu_restore_icount:
+ * @cpu: the vCPU the fault occurred on
+ * @searched_pc: the host PC the fault occurred at
+ *
+ * Unicorn: give back the uc_emu_start() budget charged for the instructions
+ * of the TB which didn't retire, without restoring the CPU state.
+ */
+void cpu_restore_icount(CPUState *cpu, uintptr_t searched_pc);
+
 void QEMU_NORETURN cpu_loop_exit_noexc(CPUState *cpu);
 void QEMU_NORETURN cpu_io_recompile(CPUState *cpu, uintptr_t retaddr);
 TranslationBlock *tb_gen_code(CPUState *cpu,
@@ -148,6 +158,21 @@ void tlb_flush_page_all_cpus_synced(CPUState *src, target_ulong addr);
  * use one of the other functions for efficiency.
  */
 void tlb_flush(CPUState *cpu);
+/**
+ * tlb_flush_range:
+ * @cpu: CPU whose TLB should be flushed
+ * @first: first guest address changed
+ * @last: last guest address changed
+ * @host_first: first host address changed
+ * @host_last: last host address changed
+ *
+ * Unicorn: flush the entries of the guest pages and of the host memory
+ * changed by a memory map change, in a single pass over the TLB. The I/O
+ * entries are flushed too, their section numbers don't survive the change.
+ * The whole TLB is flushed when the guest range is larger than the TLB.
+ */
+void tlb_flush_range(CPUState *cpu, uint64_t first, uint64_t last,
+                     uintptr_t host_first, uintptr_t host_last);
 /**
  * tlb_flush_all_cpus:
  * @cpu: src CPU of the flush
@@ -306,6 +331,7 @@ struct TranslationBlock {
     uint16_t size;      /* size of target code for this block (1 <=
                            size <= TARGET_PAGE_SIZE) */
     uint16_t icount;
+    uint16_t icount_charged; /* Unicorn: insns taken from the budget */
     uint32_t cflags;    /* compile flags */
 #define CF_COUNT_MASK  0x00007fff
 #define CF_LAST_IO     0x00008000 /* Last insn may be an IO access.  */
@@ -313,11 +339,14 @@ struct TranslationBlock {
 #define CF_USE_ICOUNT  0x00020000
 #define CF_INVALID     0x00040000 /* TB is stale. Set with @jmp_lock held */
 #define CF_PARALLEL    0x00080000 /* Generate code for a parallel context */
+#define CF_UC_ICOUNT   0x00100000 /* Unicorn: consume the uc_emu_start() budget */
+#define CF_UC_BP_SKIP  0x00200000 /* Unicorn: execute the breakpoint at pc */
 #define CF_CLUSTER_MASK 0xff000000 /* Top 8 bits are cluster ID */
 #define CF_CLUSTER_SHIFT 24
 /* cflags' mask for hashing/comparison */
 #define CF_HASH_MASK   \
-    (CF_COUNT_MASK | CF_LAST_IO | CF_USE_ICOUNT | CF_PARALLEL | CF_CLUSTER_MASK)
+    (CF_COUNT_MASK | CF_LAST_IO | CF_USE_ICOUNT | CF_PARALLEL | CF_UC_ICOUNT | \
+     CF_UC_BP_SKIP | CF_CLUSTER_MASK)
 
     /* Per-vCPU dynamic tracing state used to generate this TB */
     uint32_t trace_vcpu_dstate;
@@ -375,9 +404,10 @@ static inline uint32_t tb_cflags(const TranslationBlock *tb)
 }
 
 /* current cflags for hashing/comparison */
-static inline uint32_t curr_cflags(void)
+static inline uint32_t curr_cflags(struct uc_struct *uc)
 {
-    return 0;
+    /* Unicorn: counted and uncounted TBs live side by side in the cache */
+    return uc->emu_count ? CF_UC_ICOUNT : 0;
 }
 
 /* TranslationBlock invalidate API */
@@ -32,9 +32,15 @@ static inline void gen_io_end(TCGContext *tcg_ctx)
 
 static inline void gen_tb_start(TCGContext *tcg_ctx, TranslationBlock *tb)
 {
-    TCGv_i32 count;
+    TCGv_i32 count, imm;
+    // Unicorn: uc_emu_start() with a @count, the budget is consumed inline
+    // here instead of a UC_HOOK_CODE callback per instruction.
+    bool use_icount = tb_cflags(tb) & CF_UC_ICOUNT;
 
     tcg_ctx->exitreq_label = gen_new_label(tcg_ctx);
+    tcg_ctx->icount_exits = use_icount;
+    tcg_ctx->icount_insn = 0;
+    tcg_ctx->nb_icount_exits = 0;
 
     count = tcg_temp_new_i32(tcg_ctx);
 
@@ -42,17 +48,75 @@ static inline void gen_tb_start(TCGContext *tcg_ctx, TranslationBlock *tb)
                    offsetof(ArchCPU, neg.icount_decr.u32) -
                    offsetof(ArchCPU, env));
 
+    if (use_icount) {
+        imm = tcg_temp_new_i32(tcg_ctx);
+        /* We emit a movi with a dummy immediate argument. Keep the insn index
+         * of the movi so that we later (when we know the actual insn count)
+         * can update the immediate argument with the actual insn count.  */
+        tcg_gen_movi_i32(tcg_ctx, imm, 0xdeadbeef);
+        tcg_ctx->icount_start_insn = tcg_last_op(tcg_ctx);
+
+        tcg_gen_sub_i32(tcg_ctx, count, count, imm);
+        tcg_temp_free_i32(tcg_ctx, imm);
+    }
+
     tcg_gen_brcondi_i32(tcg_ctx, TCG_COND_LT, count, 0, tcg_ctx->exitreq_label);
 
+    if (use_icount) {
+        tcg_gen_st16_i32(tcg_ctx, count, tcg_ctx->cpu_env,
+                         offsetof(ArchCPU, neg.icount_decr.u16.low) -
+                         offsetof(ArchCPU, env));
+    }
+
     tcg_temp_free_i32(tcg_ctx, count);
 }
 
+/* Unicorn: the exits taken by check_exit_request() in instruction i of a
+ * counted TB, e.g. after uc_emu_stop() in a hook or an invalid memory write,
+ * give back the budget charged for the instructions from i on.  */
+static inline void gen_icount_exits(TCGContext *tcg_ctx, int num_insns)
+{
+    TCGv_i32 count;
+    int i;
+
+    for (i = 0; i < tcg_ctx->nb_icount_exits; i++) {
+        int insn = tcg_ctx->icount_exit_insn[i];
+
+        gen_set_label(tcg_ctx, tcg_ctx->icount_exit_label[i]);
+        if (insn < num_insns) {
+            count = tcg_temp_new_i32(tcg_ctx);
+            tcg_gen_ld16u_i32(tcg_ctx, count, tcg_ctx->cpu_env,
+                              offsetof(ArchCPU, neg.icount_decr.u16.low) -
+                              offsetof(ArchCPU, env));
+            tcg_gen_addi_i32(tcg_ctx, count, count, num_insns - insn);
+            tcg_gen_st16_i32(tcg_ctx, count, tcg_ctx->cpu_env,
+                             offsetof(ArchCPU, neg.icount_decr.u16.low) -
+                             offsetof(ArchCPU, env));
+            tcg_temp_free_i32(tcg_ctx, count);
+        }
+        tcg_gen_br(tcg_ctx, tcg_ctx->exitreq_label);
+    }
+    tcg_ctx->icount_exits = false;
+}
+
 static inline void gen_tb_end(TCGContext *tcg_ctx, TranslationBlock *tb, int num_insns)
 {
-    if (tb_cflags(tb) & CF_USE_ICOUNT) {
+    if (tb_cflags(tb) & CF_UC_ICOUNT) {
+        int budget = tb_cflags(tb) & CF_COUNT_MASK;
+
+        /* A block cut short to the remaining budget may have been extended
+         * by the target to keep an instruction together with its delay slot,
+         * never charge it more than the budget it was generated for.  */
+        if (budget && num_insns > budget) {
+            num_insns = budget;
+        }
+
         /* Update the num_insn immediate parameter now that we know
          * the actual insn count.  */
         tcg_set_insn_param(tcg_ctx->icount_start_insn, 1, num_insns);
+        tb->icount_charged = num_insns;
+
+        gen_icount_exits(tcg_ctx, num_insns);
     }
 
     gen_set_label(tcg_ctx, tcg_ctx->exitreq_label);
@@ -1187,6 +1187,10 @@ MemoryRegion *memory_map_ptr(struct uc_struct *uc, hwaddr begin, size_t size, ui
  MemoryRegion *memory_map_io(struct uc_struct *uc, ram_addr_t begin, size_t size, uc_cb_mmio_read_t read_cb,
                              uc_cb_mmio_write_t write_cb, void *user_data_read, void *user_data_write);
 void memory_unmap(struct uc_struct *uc, MemoryRegion *mr);
+bool memory_split(struct uc_struct *uc, MemoryRegion *mr, hwaddr addr,
+                  MemoryRegion **lo, MemoryRegion **hi);
 int memory_free(struct uc_struct *uc);
+void memory_region_transaction_begin(struct uc_struct *uc);
+void memory_region_transaction_commit(MemoryRegion *mr);
 
 #endif
@@ -3,9 +3,21 @@
 
 #include <pthread.h>
 #include <semaphore.h>
+#include <time.h>
+
+struct QemuMutex {
+    pthread_mutex_t lock;
+};
+
+struct QemuCond {
+    pthread_cond_t cond;
+    clockid_t clock; /* the clock of the timed waits */
+};
 
 struct QemuThread {
     pthread_t thread;
 };
 
+#define QEMU_MUTEX_INITIALIZER { PTHREAD_MUTEX_INITIALIZER }
+
 #endif
@@ -3,6 +3,16 @@
 
 #include <windows.h>
 
+struct QemuMutex {
+    SRWLOCK lock;
+};
+
+struct QemuCond {
+    CONDITION_VARIABLE var;
+};
+
+#define QEMU_MUTEX_INITIALIZER { SRWLOCK_INIT }
+
 typedef struct QemuThreadData QemuThreadData;
 struct QemuThread {
     QemuThreadData *data;
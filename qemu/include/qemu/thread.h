@@ -5,6 +5,8 @@
 #include "qemu/processor.h"
 
 struct uc_struct;
+typedef struct QemuMutex QemuMutex;
+typedef struct QemuCond QemuCond;
 typedef struct QemuThread QemuThread;
 
 #if defined(_WIN32) && !defined(__MINGW32__)
@@ -16,6 +18,22 @@ typedef struct QemuThread QemuThread;
 #define QEMU_THREAD_JOINABLE 0
 #define QEMU_THREAD_DETACHED 1
 
+/*
+ * Mutexes are statically initialized with QEMU_MUTEX_INITIALIZER.
+ */
+void qemu_mutex_lock(QemuMutex *mutex);
+void qemu_mutex_unlock(QemuMutex *mutex);
+
+/*
+ * Condition variables are initialized with qemu_cond_init(). Their timed
+ * waits follow a monotonic clock where the host allows it, so that setting
+ * the wall clock doesn't move them.
+ */
+void qemu_cond_init(QemuCond *cond);
+void qemu_cond_signal(QemuCond *cond);
+/* Wait at most @ns nanoseconds, returns false on timeout. */
+bool qemu_cond_timedwait_ns(QemuCond *cond, QemuMutex *mutex, int64_t ns);
+
 int qemu_thread_create(struct uc_struct *uc, QemuThread *thread, const char *name,
                         void *(*start_routine)(void *),
                         void *arg, int mode);
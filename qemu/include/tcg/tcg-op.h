@@ -29,47 +29,6 @@
 #include "exec/helper-proto.h"
 #include "exec/helper-gen.h"
 
-static inline void gen_uc_tracecode(TCGContext *tcg_ctx, int32_t size, int32_t type, void *uc, uint64_t pc)
-{
-    TCGv_i32 tsize = tcg_const_i32(tcg_ctx, size);
-    TCGv_i32 ttype;
-    TCGv_ptr tuc = tcg_const_ptr(tcg_ctx, uc);
-    TCGv_i64 tpc = tcg_const_i64(tcg_ctx, pc);
-    TCGv_ptr tdata;
-    uc_engine* puc = uc;
-    struct list_item *cur;
-    struct hook* hk;
-    TCGTemp* args[] = {
-        tcgv_ptr_temp(tcg_ctx, tuc),
-        tcgv_i64_temp(tcg_ctx, tpc),
-        tcgv_i32_temp(tcg_ctx, tsize),
-        0
-    };
-
-    if (puc->hooks_count[type] == 1) {
-        cur = puc->hook[type].head;
-        
-        while (cur) {
-            hk = cur->data;
-            if (!hk->to_delete) {
-                tdata = tcg_const_ptr(tcg_ctx, hk->user_data);
-                args[3] = tcgv_ptr_temp(tcg_ctx, tdata);
-                puc->add_inline_hook(uc, hk, (void**)args, 4);
-                tcg_temp_free_ptr(tcg_ctx, tdata);
-            }
-            cur = cur->next;
-        }
-
-    } else {
-        ttype = tcg_const_i32(tcg_ctx, type);
-        gen_helper_uc_tracecode(tcg_ctx, tsize, ttype, tuc, tpc);
-        tcg_temp_free_i32(tcg_ctx, ttype);
-    }
-    tcg_temp_free_i64(tcg_ctx, tpc);
-    tcg_temp_free_ptr(tcg_ctx, tuc);
-    tcg_temp_free_i32(tcg_ctx, tsize);
-}
-
 static inline void gen_uc_traceopcode(TCGContext *tcg_ctx, void* hook, TCGv_i64 arg1, TCGv_i64 arg2, uint32_t size, void *uc, uint64_t pc)
 {
     TCGv_ptr thook = tcg_const_ptr(tcg_ctx, hook);
@@ -922,6 +881,80 @@ void tcg_gen_goto_tb(TCGContext *tcg_ctx, unsigned idx);
  */
 void tcg_gen_lookup_and_goto_ptr(TCGContext *tcg_ctx);
 
+static inline void gen_uc_tracecode(TCGContext *tcg_ctx, int32_t size, int32_t type, void *uc, uint64_t pc)
+{
+    TCGv_i32 tsize;
+    TCGv_i32 ttype;
+    TCGv_i32 tstop;
+    TCGv_ptr tuc;
+    TCGv_i64 tpc;
+    TCGv_ptr tdata;
+    TCGLabel *skip = NULL;
+    uc_engine* puc = uc;
+    struct hook **hooks;
+    int hooks_len;
+    int i;
+    TCGTemp* args[4];
+
+    // The hooks and the pc are known at translation time, so the bounds are
+    // checked here and the matching callbacks are called directly. With too
+    // many matching hooks, fall back to helper_uc_tracecode.
+    hooks_len = hook_index_find(puc, type & UC_HOOK_IDX_MASK, pc, pc, &hooks);
+    if (hooks_len > UC_HOOK_INLINE_MAX) {
+        hooks_len = -1;
+    }
+
+    // The callers patch the size once the instruction or block is translated,
+    // so tsize must be the first op generated. With several calls, the
+    // arguments live across the stop checks in between.
+    if (hooks_len > 1) {
+        tsize = tcg_const_local_i32(tcg_ctx, size);
+        tuc = tcg_const_local_ptr(tcg_ctx, uc);
+        tpc = tcg_const_local_i64(tcg_ctx, pc);
+    } else {
+        tsize = tcg_const_i32(tcg_ctx, size);
+        tuc = tcg_const_ptr(tcg_ctx, uc);
+        tpc = tcg_const_i64(tcg_ctx, pc);
+    }
+
+    if (hooks_len < 0) {
+        ttype = tcg_const_i32(tcg_ctx, type);
+        gen_helper_uc_tracecode(tcg_ctx, tsize, ttype, tuc, tpc);
+        tcg_temp_free_i32(tcg_ctx, ttype);
+    } else {
+        args[0] = tcgv_ptr_temp(tcg_ctx, tuc);
+        args[1] = tcgv_i64_temp(tcg_ctx, tpc);
+        args[2] = tcgv_i32_temp(tcg_ctx, tsize);
+
+        for (i = 0; i < hooks_len; i++) {
+            // Like helper_uc_tracecode, skip the remaining hooks once a
+            // callback asked to stop emulation.
+            if (i > 0 && !(type & UC_HOOK_FLAG_NO_STOP)) {
+                if (skip == NULL) {
+                    skip = gen_new_label(tcg_ctx);
+                }
+                tstop = tcg_temp_new_i32(tcg_ctx);
+                tcg_gen_ld8u_i32(tcg_ctx, tstop, tuc,
+                                 offsetof(struct uc_struct, stop_request));
+                tcg_gen_brcondi_i32(tcg_ctx, TCG_COND_NE, tstop, 0, skip);
+                tcg_temp_free_i32(tcg_ctx, tstop);
+            }
+
+            tdata = tcg_const_ptr(tcg_ctx, hooks[i]->user_data);
+            args[3] = tcgv_ptr_temp(tcg_ctx, tdata);
+            puc->add_inline_hook(uc, hooks[i], (void**)args, 4);
+            tcg_temp_free_ptr(tcg_ctx, tdata);
+        }
+
+        if (skip != NULL) {
+            gen_set_label(tcg_ctx, skip);
+        }
+    }
+    tcg_temp_free_i64(tcg_ctx, tpc);
+    tcg_temp_free_ptr(tcg_ctx, tuc);
+    tcg_temp_free_i32(tcg_ctx, tsize);
+}
+
 #if TARGET_LONG_BITS == 32
 #define tcg_temp_new tcg_temp_new_i32
 #define tcg_global_reg_new tcg_global_reg_new_i32
@@ -1403,4 +1436,86 @@ static inline void tcg_gen_trunc_ptr_i32(TCGContext *tcg_ctx, TCGv_i32 r, TCGv_p
 #undef PTR
 #undef NAT
 
+/* Unicorn: append a comparison to the log set with UC_CTL_UC_CMPLOG.
+   There is no capacity check here, which would need a branch in the middle
+   of the instruction, the TB makes room for all of its comparisons up
+   front instead, see gen_uc_cmplog_check().  The TB ends once the buffer
+   is full, an instruction whose comparisons go past the end of the buffer
+   doesn't log these.  */
+static inline void gen_uc_cmplog(TCGContext *tcg_ctx, uc_cmplog_type type,
+                                 TCGv_i64 arg1, TCGv_i64 arg2, uint32_t size,
+                                 uint64_t pc)
+{
+    struct uc_struct *uc = tcg_ctx->uc;
+    uint64_t mask = size < 64 ? (1ULL << size) - 1 : UINT64_MAX;
+    TCGv_ptr tuc, tbuf, toff;
+    TCGv_i32 tidx, t32;
+    TCGv_i64 t64;
+
+    if (uc->cmplog_buf == NULL || uc->cmplog_sites >= uc->cmplog_size) {
+        return;
+    }
+    uc->cmplog_sites++;
+
+    tuc = tcg_const_ptr(tcg_ctx, uc);
+    tbuf = tcg_const_ptr(tcg_ctx, uc->cmplog_buf);
+    toff = tcg_temp_new_ptr(tcg_ctx);
+    tidx = tcg_temp_new_i32(tcg_ctx);
+    t32 = tcg_temp_new_i32(tcg_ctx);
+    t64 = tcg_temp_new_i64(tcg_ctx);
+
+    tcg_gen_ld_i32(tcg_ctx, tidx, tuc,
+                   offsetof(struct uc_struct, cmplog_count));
+    tcg_gen_muli_i32(tcg_ctx, t32, tidx, sizeof(uc_cmplog_entry));
+    tcg_gen_ext_i32_ptr(tcg_ctx, toff, t32);
+    tcg_gen_add_ptr(tcg_ctx, tbuf, tbuf, toff);
+
+    tcg_gen_movi_i64(tcg_ctx, t64, pc);
+    tcg_gen_st_i64(tcg_ctx, t64, tbuf, offsetof(uc_cmplog_entry, address));
+    tcg_gen_andi_i64(tcg_ctx, t64, arg1, mask);
+    tcg_gen_st_i64(tcg_ctx, t64, tbuf, offsetof(uc_cmplog_entry, arg1));
+    tcg_gen_andi_i64(tcg_ctx, t64, arg2, mask);
+    tcg_gen_st_i64(tcg_ctx, t64, tbuf, offsetof(uc_cmplog_entry, arg2));
+    tcg_gen_movi_i32(tcg_ctx, t32, size);
+    tcg_gen_st_i32(tcg_ctx, t32, tbuf, offsetof(uc_cmplog_entry, size));
+    tcg_gen_movi_i32(tcg_ctx, t32, type);
+    tcg_gen_st_i32(tcg_ctx, t32, tbuf, offsetof(uc_cmplog_entry, type));
+
+    tcg_gen_addi_i32(tcg_ctx, tidx, tidx, 1);
+    tcg_gen_st_i32(tcg_ctx, tidx, tuc,
+                   offsetof(struct uc_struct, cmplog_count));
+
+    tcg_temp_free_i64(tcg_ctx, t64);
+    tcg_temp_free_i32(tcg_ctx, t32);
+    tcg_temp_free_i32(tcg_ctx, tidx);
+    tcg_temp_free_ptr(tcg_ctx, toff);
+    tcg_temp_free_ptr(tcg_ctx, tbuf);
+    tcg_temp_free_ptr(tcg_ctx, tuc);
+}
+
+static inline void gen_uc_cmplog_i32(TCGContext *tcg_ctx, uc_cmplog_type type,
+                                     TCGv_i32 arg1, TCGv_i32 arg2,
+                                     uint32_t size, uint64_t pc)
+{
+    TCGv_i64 t1, t2;
+
+    if (tcg_ctx->uc->cmplog_buf == NULL) {
+        return;
+    }
+
+    t1 = tcg_temp_new_i64(tcg_ctx);
+    t2 = tcg_temp_new_i64(tcg_ctx);
+    tcg_gen_extu_i32_i64(tcg_ctx, t1, arg1);
+    tcg_gen_extu_i32_i64(tcg_ctx, t2, arg2);
+    gen_uc_cmplog(tcg_ctx, type, t1, t2, size, pc);
+    tcg_temp_free_i64(tcg_ctx, t2);
+    tcg_temp_free_i64(tcg_ctx, t1);
+}
+
+#if TARGET_LONG_BITS == 64
+#define gen_uc_cmplog_tl gen_uc_cmplog
+#else
+#define gen_uc_cmplog_tl gen_uc_cmplog_i32
+#endif
+
 #endif /* TCG_TCG_OP_H */
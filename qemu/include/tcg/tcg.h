@@ -692,6 +692,14 @@ struct TCGContext {
     TBContext tb_ctx;
     /* qemu/include/exec/gen-icount.h */
     TCGOp *icount_start_insn;
+    /* Unicorn: check_exit_request() in a TB consuming the uc_emu_start()
+       budget jumps to a stub per instruction, which gives back the budget
+       of the instructions left. See gen_tb_end().  */
+    bool icount_exits;
+    int icount_insn;    /* index of the instruction being translated */
+    int nb_icount_exits;
+    TCGLabel *icount_exit_label[TCG_MAX_INSNS];
+    int icount_exit_insn[TCG_MAX_INSNS];
     /* qemu/tcg/tcg.c */
     GHashTable *helper_table;
     GHashTable *custom_helper_infos; // To support inline hooks.
@@ -76,6 +76,7 @@
 #define qemu_ram_is_shared qemu_ram_is_shared_m68k
 #define qemu_ram_pagesize qemu_ram_pagesize_m68k
 #define qemu_ram_alloc_from_ptr qemu_ram_alloc_from_ptr_m68k
+#define qemu_ram_alloc_slice qemu_ram_alloc_slice_m68k
 #define qemu_ram_alloc qemu_ram_alloc_m68k
 #define qemu_ram_free qemu_ram_free_m68k
 #define qemu_map_ram_ptr qemu_map_ram_ptr_m68k
@@ -120,6 +121,7 @@
 #define memory_map_io memory_map_io_m68k
 #define memory_map_ptr memory_map_ptr_m68k
 #define memory_unmap memory_unmap_m68k
+#define memory_split memory_split_m68k
 #define memory_free memory_free_m68k
 #define flatview_unref flatview_unref_m68k
 #define address_space_get_flatview address_space_get_flatview_m68k
@@ -764,6 +766,8 @@
 #define tlb_init tlb_init_m68k
 #define tlb_flush_by_mmuidx tlb_flush_by_mmuidx_m68k
 #define tlb_flush tlb_flush_m68k
+#define tlb_flush_range tlb_flush_range_m68k
+#define tlb_vaddr_to_paddr tlb_vaddr_to_paddr_m68k
 #define tlb_flush_by_mmuidx_all_cpus tlb_flush_by_mmuidx_all_cpus_m68k
 #define tlb_flush_all_cpus tlb_flush_all_cpus_m68k
 #define tlb_flush_by_mmuidx_all_cpus_synced tlb_flush_by_mmuidx_all_cpus_synced_m68k
@@ -1243,6 +1247,7 @@
 #define helper_gvec_umax64 helper_gvec_umax64_m68k
 #define helper_gvec_bitsel helper_gvec_bitsel_m68k
 #define cpu_restore_state cpu_restore_state_m68k
+#define cpu_restore_icount cpu_restore_icount_m68k
 #define page_collection_lock page_collection_lock_m68k
 #define page_collection_unlock page_collection_unlock_m68k
 #define free_code_gen_buffer free_code_gen_buffer_m68k
@@ -267,6 +267,7 @@ void glue(address_space_stl_notdirty, SUFFIX)(struct uc_struct *uc, ARG1_DECL,
     } else {
         ptr = qemu_map_ram_ptr(mr->uc, mr->ram_block, addr1);
         stl_p(ptr, val);
+        invalidate_and_set_dirty(mr, addr1, 4);
 
         r = MEMTX_OK;
     }
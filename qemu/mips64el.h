@@ -76,6 +76,7 @@
 #define qemu_ram_is_shared qemu_ram_is_shared_mips64el
 #define qemu_ram_pagesize qemu_ram_pagesize_mips64el
 #define qemu_ram_alloc_from_ptr qemu_ram_alloc_from_ptr_mips64el
+#define qemu_ram_alloc_slice qemu_ram_alloc_slice_mips64el
 #define qemu_ram_alloc qemu_ram_alloc_mips64el
 #define qemu_ram_free qemu_ram_free_mips64el
 #define qemu_map_ram_ptr qemu_map_ram_ptr_mips64el
@@ -120,6 +121,7 @@
 #define memory_map_io memory_map_io_mips64el
 #define memory_map_ptr memory_map_ptr_mips64el
 #define memory_unmap memory_unmap_mips64el
+#define memory_split memory_split_mips64el
 #define memory_free memory_free_mips64el
 #define flatview_unref flatview_unref_mips64el
 #define address_space_get_flatview address_space_get_flatview_mips64el
@@ -764,6 +766,8 @@
 #define tlb_init tlb_init_mips64el
 #define tlb_flush_by_mmuidx tlb_flush_by_mmuidx_mips64el
 #define tlb_flush tlb_flush_mips64el
+#define tlb_flush_range tlb_flush_range_mips64el
+#define tlb_vaddr_to_paddr tlb_vaddr_to_paddr_mips64el
 #define tlb_flush_by_mmuidx_all_cpus tlb_flush_by_mmuidx_all_cpus_mips64el
 #define tlb_flush_all_cpus tlb_flush_all_cpus_mips64el
 #define tlb_flush_by_mmuidx_all_cpus_synced tlb_flush_by_mmuidx_all_cpus_synced_mips64el
@@ -1243,6 +1247,7 @@
 #define helper_gvec_umax64 helper_gvec_umax64_mips64el
 #define helper_gvec_bitsel helper_gvec_bitsel_mips64el
 #define cpu_restore_state cpu_restore_state_mips64el
+#define cpu_restore_icount cpu_restore_icount_mips64el
 #define page_collection_lock page_collection_lock_mips64el
 #define page_collection_unlock page_collection_unlock_mips64el
 #define free_code_gen_buffer free_code_gen_buffer_mips64el
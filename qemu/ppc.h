@@ -76,6 +76,7 @@
 #define qemu_ram_is_shared qemu_ram_is_shared_ppc
 #define qemu_ram_pagesize qemu_ram_pagesize_ppc
 #define qemu_ram_alloc_from_ptr qemu_ram_alloc_from_ptr_ppc
+#define qemu_ram_alloc_slice qemu_ram_alloc_slice_ppc
 #define qemu_ram_alloc qemu_ram_alloc_ppc
 #define qemu_ram_free qemu_ram_free_ppc
 #define qemu_map_ram_ptr qemu_map_ram_ptr_ppc
@@ -120,6 +121,7 @@
 #define memory_map_io memory_map_io_ppc
 #define memory_map_ptr memory_map_ptr_ppc
 #define memory_unmap memory_unmap_ppc
+#define memory_split memory_split_ppc
 #define memory_free memory_free_ppc
 #define flatview_unref flatview_unref_ppc
 #define address_space_get_flatview address_space_get_flatview_ppc
@@ -764,6 +766,8 @@
 #define tlb_init tlb_init_ppc
 #define tlb_flush_by_mmuidx tlb_flush_by_mmuidx_ppc
 #define tlb_flush tlb_flush_ppc
+#define tlb_flush_range tlb_flush_range_ppc
+#define tlb_vaddr_to_paddr tlb_vaddr_to_paddr_ppc
 #define tlb_flush_by_mmuidx_all_cpus tlb_flush_by_mmuidx_all_cpus_ppc
 #define tlb_flush_all_cpus tlb_flush_all_cpus_ppc
 #define tlb_flush_by_mmuidx_all_cpus_synced tlb_flush_by_mmuidx_all_cpus_synced_ppc
@@ -1243,6 +1247,7 @@
 #define helper_gvec_umax64 helper_gvec_umax64_ppc
 #define helper_gvec_bitsel helper_gvec_bitsel_ppc
 #define cpu_restore_state cpu_restore_state_ppc
+#define cpu_restore_icount cpu_restore_icount_ppc
 #define page_collection_lock page_collection_lock_ppc
 #define page_collection_unlock page_collection_unlock_ppc
 #define free_code_gen_buffer free_code_gen_buffer_ppc
@@ -76,6 +76,7 @@
 #define qemu_ram_is_shared qemu_ram_is_shared_s390x
 #define qemu_ram_pagesize qemu_ram_pagesize_s390x
 #define qemu_ram_alloc_from_ptr qemu_ram_alloc_from_ptr_s390x
+#define qemu_ram_alloc_slice qemu_ram_alloc_slice_s390x
 #define qemu_ram_alloc qemu_ram_alloc_s390x
 #define qemu_ram_free qemu_ram_free_s390x
 #define qemu_map_ram_ptr qemu_map_ram_ptr_s390x
@@ -120,6 +121,7 @@
 #define memory_map_io memory_map_io_s390x
 #define memory_map_ptr memory_map_ptr_s390x
 #define memory_unmap memory_unmap_s390x
+#define memory_split memory_split_s390x
 #define memory_free memory_free_s390x
 #define flatview_unref flatview_unref_s390x
 #define address_space_get_flatview address_space_get_flatview_s390x
@@ -764,6 +766,8 @@
 #define tlb_init tlb_init_s390x
 #define tlb_flush_by_mmuidx tlb_flush_by_mmuidx_s390x
 #define tlb_flush tlb_flush_s390x
+#define tlb_flush_range tlb_flush_range_s390x
+#define tlb_vaddr_to_paddr tlb_vaddr_to_paddr_s390x
 #define tlb_flush_by_mmuidx_all_cpus tlb_flush_by_mmuidx_all_cpus_s390x
 #define tlb_flush_all_cpus tlb_flush_all_cpus_s390x
 #define tlb_flush_by_mmuidx_all_cpus_synced tlb_flush_by_mmuidx_all_cpus_synced_s390x
@@ -1243,6 +1247,7 @@
 #define helper_gvec_umax64 helper_gvec_umax64_s390x
 #define helper_gvec_bitsel helper_gvec_bitsel_s390x
 #define cpu_restore_state cpu_restore_state_s390x
+#define cpu_restore_icount cpu_restore_icount_s390x
 #define page_collection_lock page_collection_lock_s390x
 #define page_collection_unlock page_collection_unlock_s390x
 #define free_code_gen_buffer free_code_gen_buffer_s390x
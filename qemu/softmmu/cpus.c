@@ -81,6 +81,34 @@ static void cpu_handle_guest_debug(CPUState *cpu)
     cpu->stopped = true;
 }
 
+static void prepare_icount_for_run(struct uc_struct *uc)
+{
+    CPUState *cpu = uc->cpu;
+    int insns_left;
+
+    /* Unicorn: load the @count budget of uc_emu_start() into the
+     * decrementer, TBs translated in this mode consume it inline. */
+    cpu->icount_budget = uc->emu_count;
+    insns_left = MIN(0xffff, cpu->icount_budget);
+    cpu_neg(cpu)->icount_decr.u16.low = insns_left;
+    cpu->icount_extra = cpu->icount_budget - insns_left;
+}
+
+static void process_icount_data(struct uc_struct *uc)
+{
+    CPUState *cpu = uc->cpu;
+
+    if (uc->emu_count) {
+        /* Account the instructions retired during this run. */
+        uc->emu_counter = uc->emu_count - (cpu_neg(cpu)->icount_decr.u16.low +
+                                           cpu->icount_extra);
+    }
+
+    cpu_neg(cpu)->icount_decr.u16.low = 0;
+    cpu->icount_extra = 0;
+    cpu->icount_budget = 0;
+}
+
 static int tcg_cpu_exec(struct uc_struct *uc)
 {
     int r;
@@ -182,45 +210,47 @@ void cpu_stop_current(struct uc_struct *uc)
 
 
 
-static inline gboolean uc_exit_invalidate_iter(gpointer key, gpointer val, gpointer data) 
-{
-    uint64_t exit = *((uint64_t*)key);
-    uc_engine *uc = (uc_engine*)data;
-    
-    if (exit != 0) {
-        // Unicorn: Why addr - 1?
-        // 
-        // 0: INC ecx
-        // 1: DEC edx <--- We put exit here, then the range of TB is [0, 1)
-        //
-        // While tb_invalidate_phys_range invalides [start, end)
-        //
-        // This function is designed to used with g_tree_foreach
-        uc->uc_invalidate_tb(uc, exit - 1, 1);
-    }
-
-    return false;
-}
-
 void resume_all_vcpus(struct uc_struct* uc)
 {
     CPUState *cpu = uc->cpu;
+    /* Unicorn: a nested uc_emu_start() must leave the budget of the run it
+     * was started from untouched. */
+    uint16_t outer_insns_left = cpu_neg(cpu)->icount_decr.u16.low;
+    int64_t outer_extra = cpu->icount_extra;
+    int64_t outer_budget = cpu->icount_budget;
+
     cpu->halted = 0;
     cpu->exit_request = 0;
     cpu->exception_index = -1;
     cpu_resume(cpu);
     /* static void qemu_tcg_cpu_loop(struct uc_struct *uc) */
     cpu->created = true;
+    prepare_icount_for_run(uc);
+    /* Unicorn: the run starts at a breakpoint, translate the first TB without
+     * stopping there. It is cached apart from the TB which stops. */
+    if (uc->breakpoint_resume) {
+        cpu->cflags_next_tb = curr_cflags(uc) | CF_UC_BP_SKIP;
+    }
     while (true) {
         if (tcg_cpu_exec(uc)) {
             break;
         }
     }
+    process_icount_data(uc);
+    cpu_neg(cpu)->icount_decr.u16.low = outer_insns_left;
+    cpu->icount_extra = outer_extra;
+    cpu->icount_budget = outer_budget;
 
     // clear the cache of the exits address, since the generated code
     // at that address is to exit emulation, but not for the instruction there.
     // if we dont do this, next time we cannot emulate at that address
-    if (uc->use_exits) {
+    // Unicorn: the outermost run keeps it warm for the next run, which drops
+    // it if its exits differ (see uc_drop_exit_tbs()).
+    if (uc->nested_level == 1) {
+        uc->exit_tbs_cached = true;
+        uc->exit_tbs_use_exits = uc->use_exits;
+        uc->exit_tbs_exit = uc->exits[0];
+    } else if (uc->use_exits) {
         g_tree_foreach(uc->ctl_exits, uc_exit_invalidate_iter, (void*)uc);
     } else {
         uc_exit_invalidate_iter((gpointer)&uc->exits[uc->nested_level - 1], NULL, (gpointer)uc);
@@ -51,10 +51,6 @@ MemoryRegion *memory_map(struct uc_struct *uc, hwaddr begin, size_t size, uint32
 
     memory_region_add_subregion(uc->system_memory, begin, ram);
 
-    if (uc->cpu) {
-        tlb_flush(uc->cpu);
-    }
-
     return ram;
 }
 
@@ -72,13 +68,61 @@ MemoryRegion *memory_map_ptr(struct uc_struct *uc, hwaddr begin, size_t size, ui
 
     memory_region_add_subregion(uc->system_memory, begin, ram);
 
-    if (uc->cpu) {
-        tlb_flush(uc->cpu);
+    return ram;
+}
+
+static void memory_region_destructor_ram(MemoryRegion *mr);
+
+static MemoryRegion *memory_map_slice(struct uc_struct *uc, MemoryRegion *mr,
+                                      hwaddr offset, uint64_t size)
+{
+    MemoryRegion *ram = g_new(MemoryRegion, 1);
+
+    memory_region_init(uc, ram, size);
+    ram->ram = true;
+    ram->readonly = mr->readonly;
+    ram->perms = mr->perms;
+    ram->terminates = true;
+    ram->destructor = memory_region_destructor_ram;
+    ram->ram_block = qemu_ram_alloc_slice(uc, mr->ram_block, offset, size, ram);
+    if (!ram->ram_block) {
+        g_free(ram);
+        return NULL;
     }
 
+    memory_region_add_subregion(uc->system_memory, mr->addr + offset, ram);
+
     return ram;
 }
 
+// Split a RAM region in two at addr without copying it, the halves share
+// its host memory. mr is unmapped, the caller adds the halves to the mapped
+// blocks.
+bool memory_split(struct uc_struct *uc, MemoryRegion *mr, hwaddr addr,
+                  MemoryRegion **lo, MemoryRegion **hi)
+{
+    hwaddr offset = addr - mr->addr;
+
+    memory_region_transaction_begin(uc);
+    *lo = memory_map_slice(uc, mr, 0, offset);
+    *hi = NULL;
+    if (*lo) {
+        *hi = memory_map_slice(uc, mr, offset,
+                               int128_get64(mr->size) - offset);
+        if (!*hi) {
+            memory_region_del_subregion(uc->system_memory, *lo);
+            (*lo)->destructor(*lo);
+            g_free(*lo);
+        }
+    }
+    if (*hi) {
+        memory_unmap(uc, mr);
+    }
+    memory_region_transaction_commit(uc->system_memory);
+
+    return *hi != NULL;
+}
+
 static uint64_t mmio_read_wrapper(struct uc_struct *uc, void *opaque, hwaddr addr, unsigned size)
 {
     mmio_cbs* cbs = (mmio_cbs*)opaque;
@@ -142,24 +186,14 @@ MemoryRegion *memory_map_io(struct uc_struct *uc, ram_addr_t begin, size_t size,
 
     memory_region_add_subregion(uc->system_memory, begin, mmio);
 
-    if (uc->cpu)
-        tlb_flush(uc->cpu);
-
     return mmio;
 }
 
 void memory_unmap(struct uc_struct *uc, MemoryRegion *mr)
 {
     int i;
-    hwaddr addr;
 
-    // Make sure all pages associated with the MemoryRegion are flushed
-    // Only need to do this if we are in a running state
-    if (uc->cpu) {
-        for (addr = mr->addr; addr < mr->end; addr += uc->target_page_size) {
-           tlb_flush_page(uc->cpu, addr);
-        }
-    }
+    // The commit flushes the TLB entries of the region.
     memory_region_del_subregion(uc->system_memory, mr);
 
     for (i = 0; i < uc->mapped_block_count; i++) {
@@ -167,8 +201,14 @@ void memory_unmap(struct uc_struct *uc, MemoryRegion *mr)
             uc->mapped_block_count--;
             //shift remainder of array down over deleted pointer
             memmove(&uc->mapped_blocks[i], &uc->mapped_blocks[i + 1], sizeof(MemoryRegion*) * (uc->mapped_block_count - i));
-            mr->destructor(mr);
-            g_free(mr);
+            memory_mapping_set(uc, mr->addr, mr->end, NULL);
+            // The flatview still points to it until the commit.
+            if (uc->memory_region_transaction_depth) {
+                uc->memory_unmapped = g_slist_prepend(uc->memory_unmapped, mr);
+            } else {
+                mr->destructor(mr);
+                g_free(mr);
+            }
             break;
         }
     }
@@ -179,14 +219,22 @@ int memory_free(struct uc_struct *uc)
     MemoryRegion *mr;
     int i;
 
+    // Detach all the regions with a single flatview rebuild.
+    memory_region_transaction_begin(uc);
     for (i = 0; i < uc->mapped_block_count; i++) {
         mr = uc->mapped_blocks[i];
         mr->enabled = false;
         memory_region_del_subregion(uc->system_memory, mr);
+    }
+    memory_region_transaction_commit(uc->system_memory);
+
+    for (i = 0; i < uc->mapped_block_count; i++) {
+        mr = uc->mapped_blocks[i];
         mr->destructor(mr);
         /* destroy subregion */
         g_free(mr);
     }
+    memory_mapping_clear(uc);
 
     return 0;
 }
@@ -856,25 +904,63 @@ static void address_space_update_topology(AddressSpace *as)
     address_space_set_flatview(as);
 }
 
-void memory_region_transaction_begin(void)
+static void memory_region_free_unmapped(gpointer data, gpointer user_data)
 {
+    MemoryRegion *mr = data;
+
+    mr->destructor(mr);
+    g_free(mr);
+}
+
+void memory_region_transaction_begin(struct uc_struct *uc)
+{
+    ++uc->memory_region_transaction_depth;
 }
 
 void memory_region_transaction_commit(MemoryRegion *mr)
 {
+    struct uc_struct *uc = mr->uc;
     AddressSpace *as;
+    bool flush = false;
 
-    if (mr->uc->memory_region_update_pending) {
-        flatviews_reset(mr->uc);
+    assert(uc->memory_region_transaction_depth);
+    --uc->memory_region_transaction_depth;
+    if (uc->memory_region_transaction_depth) {
+        return;
+    }
 
-        MEMORY_LISTENER_CALL_GLOBAL(mr->uc, begin, Forward);
+    if (uc->memory_region_update_pending) {
+        flatviews_reset(uc);
 
-        QTAILQ_FOREACH(as, &mr->uc->address_spaces, address_spaces_link) {
+        MEMORY_LISTENER_CALL_GLOBAL(uc, begin, Forward);
+
+        QTAILQ_FOREACH(as, &uc->address_spaces, address_spaces_link) {
             address_space_set_flatview(as);
         }
-        mr->uc->memory_region_update_pending = false;
-        MEMORY_LISTENER_CALL_GLOBAL(mr->uc, commit, Forward);
+        uc->memory_region_update_pending = false;
+        MEMORY_LISTENER_CALL_GLOBAL(uc, commit, Forward);
+        flush = true;
+    }
+
+    // Unicorn: flush the TLB entries of the regions changed, instead of the
+    // whole TLB.
+    flush |= uc->memory_flush_first <= uc->memory_flush_last ||
+             uc->memory_flush_host_first <= uc->memory_flush_host_last;
+    if (flush && uc->cpu) {
+        tlb_flush_range(uc->cpu, uc->memory_flush_first,
+                        uc->memory_flush_last, uc->memory_flush_host_first,
+                        uc->memory_flush_host_last);
     }
+    uc->memory_flush_first = UINT64_MAX;
+    uc->memory_flush_last = 0;
+    uc->memory_flush_host_first = UINTPTR_MAX;
+    uc->memory_flush_host_last = 0;
+
+    // Unicorn: free the regions unmapped in the transaction, now that no
+    // flatview points to them.
+    g_slist_foreach(uc->memory_unmapped, memory_region_free_unmapped, NULL);
+    g_slist_free(uc->memory_unmapped);
+    uc->memory_unmapped = NULL;
 }
 
 static void memory_region_destructor_none(MemoryRegion *mr)
@@ -1068,14 +1154,40 @@ uint64_t memory_region_size(MemoryRegion *mr)
     return int128_get64(mr->size);
 }
 
+// Unicorn: the commit flushes the TLB entries of the region.
+static void memory_region_flush_tlb(MemoryRegion *mr)
+{
+    struct uc_struct *uc = mr->uc;
+    uintptr_t host;
+
+    if (mr->container == uc->system_memory) {
+        // end is 0 for a region at the end of the address space
+        uc->memory_flush_first = MIN(uc->memory_flush_first, mr->addr);
+        uc->memory_flush_last = MAX(uc->memory_flush_last, mr->end - 1);
+    } else {
+        uc->memory_flush_first = 0;
+        uc->memory_flush_last = UINT64_MAX;
+    }
+
+    if (mr->ram_block) {
+        host = (uintptr_t)mr->ram_block->host;
+        uc->memory_flush_host_first = MIN(uc->memory_flush_host_first, host);
+        uc->memory_flush_host_last =
+            MAX(uc->memory_flush_host_last,
+                host + mr->ram_block->used_length - 1);
+    }
+}
+
 void memory_region_set_readonly(MemoryRegion *mr, bool readonly)
 {
+    memory_region_transaction_begin(mr->uc);
     if (mr->readonly != readonly) {
-        memory_region_transaction_begin();
         mr->readonly = readonly;
         mr->uc->memory_region_update_pending |= mr->enabled;
-        memory_region_transaction_commit(mr);
     }
+    // Unicorn: uc_mem_protect() may change the other permissions too.
+    memory_region_flush_tlb(mr);
+    memory_region_transaction_commit(mr);
 }
 
 void *memory_region_get_ram_ptr(MemoryRegion *mr)
@@ -1110,7 +1222,7 @@ static void memory_region_update_container_subregions(MemoryRegion *subregion)
     MemoryRegion *mr = subregion->container;
     MemoryRegion *other;
 
-    memory_region_transaction_begin();
+    memory_region_transaction_begin(mr->uc);
 
     QTAILQ_FOREACH(other, &mr->subregions, subregions_link) {
         QTAILQ_INSERT_BEFORE(other, subregion, subregions_link);
@@ -1120,6 +1232,7 @@ static void memory_region_update_container_subregions(MemoryRegion *subregion)
 
 done:
     mr->uc->memory_region_update_pending = true;
+    memory_region_flush_tlb(subregion);
     memory_region_transaction_commit(mr);
 }
 
@@ -1144,8 +1257,9 @@ void memory_region_add_subregion(MemoryRegion *mr,
 void memory_region_del_subregion(MemoryRegion *mr,
                                  MemoryRegion *subregion)
 {
-    memory_region_transaction_begin();
+    memory_region_transaction_begin(mr->uc);
     assert(subregion->container == mr);
+    memory_region_flush_tlb(subregion);
     subregion->container = NULL;
     QTAILQ_REMOVE(&mr->subregions, subregion, subregions_link);
     mr->uc->memory_region_update_pending = true;
@@ -1317,7 +1431,7 @@ void address_space_destroy(AddressSpace *as)
     MemoryRegion *root = as->root;
 
     /* Flush out anything from MemoryListeners listening in on this */
-    memory_region_transaction_begin();
+    memory_region_transaction_begin(as->uc);
     as->root = NULL;
     memory_region_transaction_commit(root);
     QTAILQ_REMOVE(&as->uc->address_spaces, as, address_spaces_link);
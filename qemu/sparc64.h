@@ -76,6 +76,7 @@
 #define qemu_ram_is_shared qemu_ram_is_shared_sparc64
 #define qemu_ram_pagesize qemu_ram_pagesize_sparc64
 #define qemu_ram_alloc_from_ptr qemu_ram_alloc_from_ptr_sparc64
+#define qemu_ram_alloc_slice qemu_ram_alloc_slice_sparc64
 #define qemu_ram_alloc qemu_ram_alloc_sparc64
 #define qemu_ram_free qemu_ram_free_sparc64
 #define qemu_map_ram_ptr qemu_map_ram_ptr_sparc64
@@ -120,6 +121,7 @@
 #define memory_map_io memory_map_io_sparc64
 #define memory_map_ptr memory_map_ptr_sparc64
 #define memory_unmap memory_unmap_sparc64
+#define memory_split memory_split_sparc64
 #define memory_free memory_free_sparc64
 #define flatview_unref flatview_unref_sparc64
 #define address_space_get_flatview address_space_get_flatview_sparc64
@@ -764,6 +766,8 @@
 #define tlb_init tlb_init_sparc64
 #define tlb_flush_by_mmuidx tlb_flush_by_mmuidx_sparc64
 #define tlb_flush tlb_flush_sparc64
+#define tlb_flush_range tlb_flush_range_sparc64
+#define tlb_vaddr_to_paddr tlb_vaddr_to_paddr_sparc64
 #define tlb_flush_by_mmuidx_all_cpus tlb_flush_by_mmuidx_all_cpus_sparc64
 #define tlb_flush_all_cpus tlb_flush_all_cpus_sparc64
 #define tlb_flush_by_mmuidx_all_cpus_synced tlb_flush_by_mmuidx_all_cpus_synced_sparc64
@@ -1243,6 +1247,7 @@
 #define helper_gvec_umax64 helper_gvec_umax64_sparc64
 #define helper_gvec_bitsel helper_gvec_bitsel_sparc64
 #define cpu_restore_state cpu_restore_state_sparc64
+#define cpu_restore_icount cpu_restore_icount_sparc64
 #define page_collection_lock page_collection_lock_sparc64
 #define page_collection_unlock page_collection_unlock_sparc64
 #define free_code_gen_buffer free_code_gen_buffer_sparc64
@@ -738,6 +738,8 @@ static void gen_add_CC(TCGContext *tcg_ctx, int sf, TCGv_i64 dest, TCGv_i64 t0,
 /* dest = T0 - T1; compute C, N, V and Z flags */
 static void gen_sub_CC(TCGContext *tcg_ctx, int sf, TCGv_i64 dest, TCGv_i64 t0, TCGv_i64 t1)
 {
+    gen_uc_cmplog(tcg_ctx, UC_CMPLOG_SUB, t0, t1, sf ? 64 : 32,
+                  tcg_ctx->pc_start);
     if (sf) {
         /* 64 bit arithmetic */
         TCGv_i64 result, flag, tmp;
@@ -497,6 +497,7 @@ static void gen_adc_CC(TCGContext *tcg_ctx, TCGv_i32 dest, TCGv_i32 t0, TCGv_i32
 static void gen_sub_CC(TCGContext *tcg_ctx, TCGv_i32 dest, TCGv_i32 t0, TCGv_i32 t1)
 {
     TCGv_i32 tmp;
+    gen_uc_cmplog_i32(tcg_ctx, UC_CMPLOG_SUB, t0, t1, 32, tcg_ctx->pc_start);
     tcg_gen_sub_i32(tcg_ctx, tcg_ctx->cpu_NF, t0, t1);
     tcg_gen_mov_i32(tcg_ctx, tcg_ctx->cpu_ZF, tcg_ctx->cpu_NF);
     tcg_gen_setcond_i32(tcg_ctx, TCG_COND_GEU, tcg_ctx->cpu_CF, t0, t1);
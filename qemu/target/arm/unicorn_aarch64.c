@@ -7,6 +7,7 @@
 #include "sysemu/cpus.h"
 #include "cpu.h"
 #include "kvm-consts.h"
+#include "internals.h"
 #include "unicorn_common.h"
 #include "uc_priv.h"
 #include "unicorn.h"
@@ -441,6 +442,82 @@ static int arm64_cpus_init(struct uc_struct *uc, const char *cpu_model)
     return 0;
 }
 
+#define ARM_CONTEXT_FIELD(regs, field)                                         \
+    {                                                                          \
+        (regs), offsetof(CPUARMState, field),                                  \
+            sizeof(((CPUARMState *)NULL)->field)                               \
+    }
+
+// The CPU state up to cpu_watchpoint, see uc->cpu_context_size, without the
+// pointers of the engine: the MPU/SAU arrays, nvic... and cpu_breakpoint. The
+// MPU/SAU regions themselves are only saved with UC_CTL_CONTEXT_REGS_ALL.
+static const struct uc_context_range arm64_context_ranges[] = {
+    // r0-r15, x0-x30, pc, CPSR/PSTATE and their banked copies
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, regs),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, xregs),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, pc),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, pstate),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, aarch64),
+    // cached from both the CPSR and the system registers
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR | UC_CTL_CONTEXT_REGS_SYSTEM,
+                      hflags),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, uncached_cpsr),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, spsr),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, banked_spsr),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, banked_r13),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, banked_r14),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, usr_regs),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, fiq_regs),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, CF),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, VF),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, NF),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, ZF),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, QF),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, GE),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, thumb),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, condexec_bits),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, btype),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, daif),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, elr_el),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, sp_el),
+    // cp15, M profile, exception state, exclusive monitor...
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, cp15),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, v7m),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, exception),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, serror),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, irq_line_state),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, teecr),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, teehbr),
+    // the FP and the NEON/SVE registers are the same ones
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_FP | UC_CTL_CONTEXT_REGS_VECTOR,
+                      vfp),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, exclusive_addr),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, exclusive_val),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, exclusive_high),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_VECTOR, iwmmxt),
+    // pointer authentication keys
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, keys),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, features),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, pmsav7.rnr),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, pmsav8.mair0),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, pmsav8.mair1),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, sau.rnr),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, sau.ctrl),
+};
+
+// The debug break/watchpoints are pointers of the engine which saved the
+// context, insert ours again from the restored DBGBCR/DBGWCR.
+static uc_err arm64_context_restore(struct uc_struct *uc, uc_context *context)
+{
+    ARMCPU *cpu = (ARMCPU *)uc->cpu;
+
+    memcpy(&cpu->env, context->data, uc->cpu_context_size);
+    hw_breakpoint_update_all(cpu);
+    hw_watchpoint_update_all(cpu);
+
+    return UC_ERR_OK;
+}
+
 DEFAULT_VISIBILITY
 void arm64_uc_init(struct uc_struct *uc)
 {
@@ -452,5 +529,8 @@ void arm64_uc_init(struct uc_struct *uc)
     uc->release = arm64_release;
     uc->cpus_init = arm64_cpus_init;
     uc->cpu_context_size = offsetof(CPUARMState, cpu_watchpoint);
+    uc->context_ranges = arm64_context_ranges;
+    uc->context_range_count = ARRAY_SIZE(arm64_context_ranges);
+    uc->context_restore = arm64_context_restore;
     uc_common_init(uc);
 }
@@ -7,6 +7,7 @@
 #include "sysemu/cpus.h"
 #include "sysemu/tcg.h"
 #include "cpu.h"
+#include "internals.h"
 #include "uc_priv.h"
 #include "unicorn_common.h"
 #include "unicorn.h"
@@ -722,12 +723,31 @@ static uc_err uc_arm_context_save(struct uc_struct *uc, uc_context *context)
 static uc_err uc_arm_context_restore(struct uc_struct *uc, uc_context *context)
 {
     char *p = NULL;
+    char *end = context->data + context->context_size;
     ARMCPU *cpu = (ARMCPU *)uc->cpu;
     CPUARMState *env = (CPUARMState *)&cpu->env;
     uint32_t nr, ctx_nr;
+    // The context may come from another engine, e.g. with uc_clone(), keep
+    // the arrays of this one and only copy their content.
+    uint32_t **arrays[] = {
+        &env->pmsav7.drbar,         &env->pmsav7.drsr,
+        &env->pmsav7.dracr,         &env->pmsav8.rbar[M_REG_NS],
+        &env->pmsav8.rbar[M_REG_S], &env->pmsav8.rlar[M_REG_NS],
+        &env->pmsav8.rlar[M_REG_S], &env->sau.rbar,
+        &env->sau.rlar,
+    };
+    uint32_t *own[ARRAY_SIZE(arrays)];
+    int i;
 
+// The context may also be read from a snapshot file, never go past its end.
 #define ARM_ENV_RESTORE(field)                                                 \
+    if ((size_t)(end - p) < sizeof(uint32_t)) {                                \
+        return UC_ERR_ARG;                                                     \
+    }                                                                          \
     ctx_nr = *(uint32_t *)p;                                                   \
+    if (ctx_nr > (size_t)(end - p) / sizeof(uint32_t) - 1) {                   \
+        return UC_ERR_ARG;                                                     \
+    }                                                                          \
     if (ctx_nr != 0) {                                                         \
         p += sizeof(uint32_t);                                                 \
         if (field && ctx_nr == nr) {                                           \
@@ -738,9 +758,19 @@ static uc_err uc_arm_context_restore(struct uc_struct *uc, uc_context *context)
         p += sizeof(uint32_t);                                                 \
     }
 
+    for (i = 0; i < ARRAY_SIZE(arrays); i++) {
+        own[i] = *arrays[i];
+    }
     p = context->data;
     memcpy(uc->cpu->env_ptr, p, uc->cpu_context_size);
     p += uc->cpu_context_size;
+    for (i = 0; i < ARRAY_SIZE(arrays); i++) {
+        *arrays[i] = own[i];
+    }
+    // The debug break/watchpoints are pointers of that engine too, insert
+    // ours again from the restored DBGBCR/DBGWCR.
+    hw_breakpoint_update_all(cpu);
+    hw_watchpoint_update_all(cpu);
 
     nr = cpu->pmsav7_dregion;
     ARM_ENV_RESTORE(env->pmsav7.drbar)
@@ -760,6 +790,67 @@ static uc_err uc_arm_context_restore(struct uc_struct *uc, uc_context *context)
     return UC_ERR_OK;
 }
 
+#define ARM_CONTEXT_FIELD(regs, field)                                         \
+    {                                                                          \
+        (regs), offsetof(CPUARMState, field),                                  \
+            sizeof(((CPUARMState *)NULL)->field)                               \
+    }
+
+// The CPU state up to cpu_watchpoint, see uc->cpu_context_size, without the
+// pointers of the engine: the MPU/SAU arrays, nvic... and cpu_breakpoint. The
+// MPU/SAU regions themselves are only saved with UC_CTL_CONTEXT_REGS_ALL.
+static const struct uc_context_range arm_context_ranges[] = {
+    // r0-r15, x0-x30, pc, CPSR/PSTATE and their banked copies
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, regs),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, xregs),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, pc),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, pstate),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, aarch64),
+    // cached from both the CPSR and the system registers
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR | UC_CTL_CONTEXT_REGS_SYSTEM,
+                      hflags),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, uncached_cpsr),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, spsr),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, banked_spsr),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, banked_r13),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, banked_r14),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, usr_regs),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, fiq_regs),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, CF),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, VF),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, NF),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, ZF),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, QF),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, GE),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, thumb),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, condexec_bits),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, btype),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, daif),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, elr_el),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_GPR, sp_el),
+    // cp15, M profile, exception state, exclusive monitor...
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, cp15),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, v7m),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, exception),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, serror),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, irq_line_state),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, teecr),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, teehbr),
+    // the FP and the NEON/SVE registers are the same ones
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_FP | UC_CTL_CONTEXT_REGS_VECTOR,
+                      vfp),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, exclusive_addr),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, exclusive_val),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, exclusive_high),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_VECTOR, iwmmxt),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, features),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, pmsav7.rnr),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, pmsav8.mair0),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, pmsav8.mair1),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, sau.rnr),
+    ARM_CONTEXT_FIELD(UC_CTL_CONTEXT_REGS_SYSTEM, sau.ctrl),
+};
+
 void arm_uc_init(struct uc_struct *uc)
 {
     uc->reg_read = arm_reg_read;
@@ -773,6 +864,8 @@ void arm_uc_init(struct uc_struct *uc)
     uc->cpus_init = arm_cpus_init;
     uc->opcode_hook_invalidate = arm_opcode_hook_invalidate;
     uc->cpu_context_size = offsetof(CPUARMState, cpu_watchpoint);
+    uc->context_ranges = arm_context_ranges;
+    uc->context_range_count = ARRAY_SIZE(arm_context_ranges);
     uc->context_size = uc_arm_context_size;
     uc->context_save = uc_arm_context_save;
     uc->context_restore = uc_arm_context_restore;
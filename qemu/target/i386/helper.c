@@ -203,15 +203,12 @@ hwaddr x86_cpu_get_phys_page_attrs_debug(CPUState *cs, vaddr addr,
     target_ulong pde_addr, pte_addr;
     uint64_t pte;
     int32_t a20_mask;
-    uint32_t page_offset;
-    int page_size;
 
     *attrs = cpu_get_mem_attrs(env);
 
     a20_mask = x86_get_a20_mask(env);
     if (!(env->cr[0] & CR0_PG_MASK)) {
-        pte = addr & a20_mask;
-        page_size = 4096;
+        /* no paging, every address is mapped */
     } else if (env->cr[4] & CR4_PAE_MASK) {
         target_ulong pdpe_addr;
         uint64_t pde, pdpe;
@@ -253,8 +250,6 @@ hwaddr x86_cpu_get_phys_page_attrs_debug(CPUState *cs, vaddr addr,
                 return -1;
             }
             if (pdpe & PG_PSE_MASK) {
-                page_size = 1024 * 1024 * 1024;
-                pte = pdpe;
                 goto out;
             }
 
@@ -274,19 +269,14 @@ hwaddr x86_cpu_get_phys_page_attrs_debug(CPUState *cs, vaddr addr,
         if (!(pde & PG_PRESENT_MASK)) {
             return -1;
         }
-        if (pde & PG_PSE_MASK) {
-            /* 2 MB page */
-            page_size = 2048 * 1024;
-            pte = pde;
-        } else {
+        if (!(pde & PG_PSE_MASK)) {
             /* 4 KB page */
             pte_addr = ((pde & PG_ADDRESS_MASK) +
                         (((addr >> 12) & 0x1ff) << 3)) & a20_mask;
-            page_size = 4096;
             pte = x86_ldq_phys(cs, pte_addr);
-        }
-        if (!(pte & PG_PRESENT_MASK)) {
-            return -1;
+            if (!(pte & PG_PRESENT_MASK)) {
+                return -1;
+            }
         }
     } else {
         uint32_t pde;
@@ -296,27 +286,22 @@ hwaddr x86_cpu_get_phys_page_attrs_debug(CPUState *cs, vaddr addr,
         pde = x86_ldl_phys(cs, pde_addr);
         if (!(pde & PG_PRESENT_MASK))
             return -1;
-        if ((pde & PG_PSE_MASK) && (env->cr[4] & CR4_PSE_MASK)) {
-            pte = pde | ((pde & 0x1fe000LL) << (32 - 13));
-            page_size = 4096 * 1024;
-        } else {
+        if (!(pde & PG_PSE_MASK) || !(env->cr[4] & CR4_PSE_MASK)) {
             /* page directory entry */
             pte_addr = ((pde & ~0xfff) + ((addr >> 10) & 0xffc)) & a20_mask;
             pte = x86_ldl_phys(cs, pte_addr);
             if (!(pte & PG_PRESENT_MASK)) {
                 return -1;
             }
-            page_size = 4096;
         }
-        pte = pte & a20_mask;
     }
 
 #ifdef TARGET_X86_64
 out:
 #endif
-    pte &= PG_ADDRESS_MASK & ~(page_size - 1);
-    page_offset = (addr & TARGET_PAGE_MASK) & (page_size - 1);
-    return pte | page_offset;
+    // Unicorn: guest accesses are identity mapped by handle_mmu_fault(), the
+    // walk above only decides whether the page is mapped at all.
+    return addr & TARGET_PAGE_MASK;
 }
 
 int cpu_x86_get_descr_debug(CPUX86State *env, unsigned int selector,
@@ -808,9 +808,11 @@ static void gen_op_update3_cc(DisasContext *s, TCGv reg)
     tcg_gen_mov_tl(tcg_ctx, tcg_ctx->cpu_cc_dst, s->T0);
 }
 
-static inline void gen_op_testl_T0_T1_cc(DisasContext *s)
+static inline void gen_op_testl_T0_T1_cc(DisasContext *s, MemOp ot)
 {
     TCGContext *tcg_ctx = s->uc->tcg_ctx;
+    gen_uc_cmplog_tl(tcg_ctx, UC_CMPLOG_AND, s->T0, s->T1,
+                     8 << (ot & MO_SIZE), s->pc_start);
     tcg_gen_and_tl(tcg_ctx, tcg_ctx->cpu_cc_dst, s->T0, s->T1);
 }
 
@@ -1556,6 +1558,8 @@ static void gen_op(DisasContext *s1, int op, MemOp ot, int d)
                 }
             }
         }
+        gen_uc_cmplog_tl(tcg_ctx, UC_CMPLOG_SUB, s1->cc_srcT, s1->T1,
+                         8 << (ot & MO_SIZE), s1->pc_start);
 
         gen_op_update2_cc(s1);
         set_cc_op(s1, CC_OP_SUBB + ot);
@@ -1611,6 +1615,8 @@ static void gen_op(DisasContext *s1, int op, MemOp ot, int d)
                 }
             }
         }
+        gen_uc_cmplog_tl(tcg_ctx, UC_CMPLOG_SUB, s1->T0, s1->T1,
+                         8 << (ot & MO_SIZE), s1->pc_start);
 
         set_cc_op(s1, CC_OP_SUBB + ot);
         break;
@@ -5212,7 +5218,7 @@ static target_ulong disas_insn(DisasContext *s, CPUState *cpu)
         case 0: /* test */
             val = insn_get(env, s, ot);
             tcg_gen_movi_tl(tcg_ctx, s->T1, val);
-            gen_op_testl_T0_T1_cc(s);
+            gen_op_testl_T0_T1_cc(s, ot);
             set_cc_op(s, CC_OP_LOGICB + ot);
             break;
         case 2: /* not */
@@ -5535,7 +5541,7 @@ static target_ulong disas_insn(DisasContext *s, CPUState *cpu)
 
         gen_ldst_modrm(env, s, modrm, ot, OR_TMP0, 0);
         gen_op_mov_v_reg(s, ot, s->T1, reg);
-        gen_op_testl_T0_T1_cc(s);
+        gen_op_testl_T0_T1_cc(s, ot);
         set_cc_op(s, CC_OP_LOGICB + ot);
         break;
 
@@ -5546,7 +5552,7 @@ static target_ulong disas_insn(DisasContext *s, CPUState *cpu)
 
         gen_op_mov_v_reg(s, ot, s->T0, OR_EAX);
         tcg_gen_movi_tl(tcg_ctx, s->T1, val);
-        gen_op_testl_T0_T1_cc(s);
+        gen_op_testl_T0_T1_cc(s, ot);
         set_cc_op(s, CC_OP_LOGICB + ot);
         break;
 
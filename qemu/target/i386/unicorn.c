@@ -1648,6 +1648,48 @@ static int x86_cpus_init(struct uc_struct *uc, const char *cpu_model)
     return 0;
 }
 
+#define X86_CONTEXT_RANGE(regs, begin, end)                                    \
+    {                                                                          \
+        (regs), offsetof(CPUX86State, begin),                                  \
+            offsetof(CPUX86State, end) - offsetof(CPUX86State, begin)          \
+    }
+
+// The CPU state up to retaddr, see uc->cpu_context_size, without the debug
+// registers: their break/watchpoints are pointers of the engine, which only
+// x86_context_restore() rebuilds. They are only saved with
+// UC_CTL_CONTEXT_REGS_ALL.
+static const struct uc_context_range x86_context_ranges[] = {
+    // regs, eip, eflags and the lazy flags state
+    X86_CONTEXT_RANGE(UC_CTL_CONTEXT_REGS_GPR, regs, hflags),
+    // hflags, segments, control registers, efer
+    X86_CONTEXT_RANGE(UC_CTL_CONTEXT_REGS_SYSTEM, hflags, fpstt),
+    // x87 and MMX
+    X86_CONTEXT_RANGE(UC_CTL_CONTEXT_REGS_FP, fpstt, sse_status),
+    // SSE, AVX and AVX-512
+    X86_CONTEXT_RANGE(UC_CTL_CONTEXT_REGS_VECTOR, sse_status, sysenter_cs),
+    // MSRs, exception state, SVM state...
+    X86_CONTEXT_RANGE(UC_CTL_CONTEXT_REGS_SYSTEM, sysenter_cs, dr),
+    X86_CONTEXT_RANGE(UC_CTL_CONTEXT_REGS_SYSTEM, old_exception, retaddr),
+};
+
+// The break/watchpoints of dr[0..3] are pointers of the engine which saved
+// the context, which may be another one or a snapshot file. Drop ours and
+// insert them again from the restored dr7.
+static uc_err x86_context_restore(struct uc_struct *uc, uc_context *context)
+{
+    CPUX86State *env = uc->cpu->env_ptr;
+    target_ulong dr7;
+
+    cpu_x86_update_dr7(env, 0);
+    memcpy(env, context->data, uc->cpu_context_size);
+    dr7 = env->dr[7];
+    memset(env->cpu_breakpoint, 0, sizeof(env->cpu_breakpoint));
+    env->dr[7] = DR7_FIXED_1;
+    cpu_x86_update_dr7(env, dr7);
+
+    return UC_ERR_OK;
+}
+
 DEFAULT_VISIBILITY
 void x86_uc_init(struct uc_struct *uc)
 {
@@ -1662,6 +1704,9 @@ void x86_uc_init(struct uc_struct *uc)
     uc->opcode_hook_invalidate = x86_opcode_hook_invalidate;
     uc->cpus_init = x86_cpus_init;
     uc->cpu_context_size = offsetof(CPUX86State, retaddr);
+    uc->context_ranges = x86_context_ranges;
+    uc->context_range_count = ARRAY_SIZE(x86_context_ranges);
+    uc->context_restore = x86_context_restore;
     uc_common_init(uc);
 }
 
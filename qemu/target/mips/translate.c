@@ -30931,8 +30931,33 @@ static void mips_tr_translate_insn(DisasContextBase *dcbase, CPUState *cs)
 
     is_slot = ctx->hflags & MIPS_HFLAG_BMASK;
 
+    // Unicorn: a TB resumed from a breakpoint runs the delay slot of its
+    // first instruction too, see CF_UC_BP_SKIP.
+    if (is_slot && uc->breakpoint_skip && ctx->base.num_insns == 2) {
+        uc->breakpoint_skip_pc = ctx->base.pc_next;
+    }
+
     // Unicorn: end address tells us to stop emulation
     if (uc_addr_is_exit(uc, ctx->base.pc_next)) {
+        // Stopping in a delay slot leaves the PC at the branch, see
+        // test_mips_stop_at_delay_slot.
+        if (!is_slot) {
+            gen_save_pc(tcg_ctx, ctx->base.pc_next);
+        } else if (uc_addr_is_breakpoint(uc, ctx->base.pc_next) &&
+                   !uc_addr_is_until(uc, ctx->base.pc_next)) {
+            // The PC can't tell the breakpoint, record it for uc_emu_start.
+            TCGv_ptr tuc = tcg_const_ptr(tcg_ctx, uc);
+            TCGv_i64 tpc = tcg_const_i64(tcg_ctx, ctx->base.pc_next);
+            TCGv_i32 tone = tcg_const_i32(tcg_ctx, 1);
+
+            tcg_gen_st_i64(tcg_ctx, tpc, tuc,
+                           offsetof(struct uc_struct, breakpoint_slot_pc));
+            tcg_gen_st8_i32(tcg_ctx, tone, tuc,
+                            offsetof(struct uc_struct, breakpoint_in_slot));
+            tcg_temp_free_i32(tcg_ctx, tone);
+            tcg_temp_free_i64(tcg_ctx, tpc);
+            tcg_temp_free_ptr(tcg_ctx, tuc);
+        }
         // raise a special interrupt to quit
         gen_helper_wait(tcg_ctx, tcg_ctx->cpu_env);
         ctx->base.is_jmp = DISAS_NORETURN;
@@ -31028,6 +31053,17 @@ static void mips_tr_translate_insn(DisasContextBase *dcbase, CPUState *cs)
         (ctx->hflags & MIPS_HFLAG_BMASK) == 0) {
         ctx->base.is_jmp = DISAS_TOO_MANY;
     }
+    /*
+     * Unicorn: likewise, a block cut short to fit the remaining instruction
+     * budget (see cpu_loop_exec_tb) must not end between a branch and its
+     * delay slot.
+     */
+    if ((tb_cflags(ctx->base.tb) & CF_COUNT_MASK) &&
+        ctx->base.num_insns == ctx->base.max_insns &&
+        ctx->base.max_insns < TCG_MAX_INSNS &&
+        (ctx->hflags & MIPS_HFLAG_BMASK)) {
+        ctx->base.max_insns++;
+    }
     if (ctx->base.pc_next - ctx->page_start >= TARGET_PAGE_SIZE) {
         ctx->base.is_jmp = DISAS_TOO_MANY;
     }
@@ -11,6 +11,9 @@
 #include "unicorn.h"
 #include "helper_regs.h"
 #include "cpu.h"
+#ifdef TARGET_PPC64
+#include "mmu-hash64.h"
+#endif
 
 #ifdef TARGET_PPC64
 typedef uint64_t ppcreg_t;
@@ -410,6 +413,100 @@ int ppc_context_reg_write(struct uc_context *ctx, unsigned int *regs,
     return 0;
 }
 
+// The software TLB lives out of the CPU state, see init_ppc_proc().
+static size_t ppc_tlb_size(CPUPPCState *env)
+{
+    size_t nr = env->nb_tlb;
+
+    if (env->id_tlbs != 0) {
+        nr *= 2;
+    }
+    switch (env->tlb_type) {
+    case TLB_6XX:
+        return nr * sizeof(ppc6xx_tlb_t);
+    case TLB_EMB:
+        return nr * sizeof(ppcemb_tlb_t);
+    case TLB_MAS:
+        return nr * sizeof(ppcmas_tlb_t);
+    default:
+        return 0;
+    }
+}
+
+static size_t ppc_context_size(struct uc_struct *uc)
+{
+    return uc->cpu_context_size + ppc_tlb_size(uc->cpu->env_ptr);
+}
+
+static uc_err ppc_context_save(struct uc_struct *uc, uc_context *context)
+{
+    CPUPPCState *env = uc->cpu->env_ptr;
+    size_t tlb_size = ppc_tlb_size(env);
+
+    memcpy(context->data, env, uc->cpu_context_size);
+    if (tlb_size != 0) {
+        memcpy(context->data + uc->cpu_context_size, env->tlb.tlb6, tlb_size);
+    }
+
+    return UC_ERR_OK;
+}
+
+// The context may come from another engine, e.g. with uc_clone(), or from a
+// snapshot file. Keep the TLB array, the timers, the IRQ inputs and the SPR
+// callbacks of this engine and only copy the TLB content.
+static uc_err ppc_context_restore(struct uc_struct *uc, uc_context *context)
+{
+    PowerPCCPU *cpu = (PowerPCCPU *)uc->cpu;
+    CPUPPCState *env = &cpu->env;
+    const CPUPPCState *saved = (const CPUPPCState *)context->data;
+    size_t tlb_size = ppc_tlb_size(env);
+    size_t spr_cb_end =
+        offsetof(CPUPPCState, spr_cb) + sizeof(env->spr_cb);
+    ppc_tlb_t tlb = env->tlb;
+    ppc_tb_t *tb_env = env->tb_env;
+    ppc_dcr_t *dcr_env = env->dcr_env;
+    void **irq_inputs = env->irq_inputs;
+    int (*check_pow)(CPUPPCState *env) = env->check_pow;
+    void *load_info = env->load_info;
+#ifdef TARGET_PPC64
+    int i;
+#endif
+
+    if (context->context_size != uc->cpu_context_size + tlb_size ||
+        saved->nb_tlb != env->nb_tlb || saved->id_tlbs != env->id_tlbs ||
+        saved->tlb_type != env->tlb_type) {
+        return UC_ERR_ARG;
+    }
+
+    memcpy(env, saved, offsetof(CPUPPCState, spr_cb));
+    memcpy((char *)env + spr_cb_end, (const char *)saved + spr_cb_end,
+           uc->cpu_context_size - spr_cb_end);
+    env->tlb = tlb;
+    env->tb_env = tb_env;
+    env->dcr_env = dcr_env;
+    env->irq_inputs = irq_inputs;
+    env->check_pow = check_pow;
+    env->load_info = load_info;
+    if (tlb_size != 0) {
+        memcpy(env->tlb.tlb6, context->data + uc->cpu_context_size, tlb_size);
+    }
+
+#ifdef TARGET_PPC64
+    // The SLB entries point to the page sizes of that engine, recompute
+    // them as slb_post_load() does.
+    if (cpu->hash64_opts) {
+        for (i = 0; i < cpu->hash64_opts->slb_size; i++) {
+            if (ppc_store_slb(cpu, i, env->slb[i].esid, env->slb[i].vsid) <
+                0) {
+                env->slb[i].sps = NULL;
+            }
+        }
+    }
+#endif
+
+    return UC_ERR_OK;
+}
+
 PowerPCCPU *cpu_ppc_init(struct uc_struct *uc);
 static int ppc_cpus_init(struct uc_struct *uc, const char *cpu_model)
 {
@@ -438,5 +535,8 @@ void ppc_uc_init(struct uc_struct *uc)
     uc->mem_redirect = ppc_mem_redirect;
     uc->cpus_init = ppc_cpus_init;
     uc->cpu_context_size = offsetof(CPUPPCState, uc);
+    uc->context_size = ppc_context_size;
+    uc->context_save = ppc_context_save;
+    uc->context_restore = ppc_context_restore;
     uc_common_init(uc);
 }
@@ -5953,6 +5953,8 @@ static void sparc_tr_translate_insn(DisasContextBase *dcbase, CPUState *cs)
     // Unicorn: end address tells us to stop emulation
     if (uc_addr_is_exit(uc, dc->pc)) {
 #ifndef TARGET_SPARC64
+        // power_down moves to npc, make it stop at this instruction.
+        tcg_gen_movi_tl(tcg_ctx, tcg_ctx->cpu_npc, dc->pc);
         gen_helper_power_down(tcg_ctx, tcg_ctx->cpu_env);
 #endif
         dcbase->is_jmp = DISAS_NORETURN;
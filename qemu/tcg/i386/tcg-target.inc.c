@@ -1758,12 +1758,11 @@ static inline void tcg_out_tlb_load(TCGContext *s, TCGReg addrlo, TCGReg addrhi,
        path function argument setup.  */
     tcg_out_mov(s, ttype, r1, addrlo);
 
-    // Unicorn: fast path if hookmem is not enable
-    if (!HOOK_EXISTS(s->uc, UC_HOOK_MEM_READ) && !HOOK_EXISTS(s->uc, UC_HOOK_MEM_WRITE))
-        tcg_out_opc(s, OPC_JCC_long + JCC_JNE, 0, 0, 0);
-    else
-        /* slow_path, so data access will go via load_helper() */
-        tcg_out_opc(s, OPC_JMP_long, 0, 0, 0);
+    /* jne slow_path */
+    /* Unicorn: pages covered by a memory hook are flagged with
+       TLB_WATCHPOINT, the comparison fails and the hooks are called from
+       the slow path.  */
+    tcg_out_opc(s, OPC_JCC_long + JCC_JNE, 0, 0, 0);
 
     label_ptr[0] = s->code_ptr;
     s->code_ptr += 4;
@@ -2853,6 +2853,7 @@ static void gen_ldst_i64(TCGContext *tcg_ctx, TCGOpcode opc, TCGv_i64 val, TCGv
 void check_exit_request(TCGContext *tcg_ctx)
 {
     TCGv_i32 count;
+    TCGLabel *exit_label = tcg_ctx->exitreq_label;
 
     // Unicorn:
     //   For ARM IT block, we couldn't exit in the middle of the
@@ -2867,7 +2868,21 @@ void check_exit_request(TCGContext *tcg_ctx)
                    offsetof(ArchCPU, neg.icount_decr.u32) -
                    offsetof(ArchCPU, env));
 
-    tcg_gen_brcondi_i32(tcg_ctx, TCG_COND_LT, count, 0, tcg_ctx->exitreq_label);
+    // The instructions from this one on don't retire, leave through the
+    // stub of this instruction which doesn't count them, see gen_tb_end().
+    if (tcg_ctx->icount_exits) {
+        int n = tcg_ctx->nb_icount_exits;
+
+        if (n == 0 || tcg_ctx->icount_exit_insn[n - 1] != tcg_ctx->icount_insn) {
+            tcg_debug_assert(n < TCG_MAX_INSNS);
+            tcg_ctx->icount_exit_label[n] = gen_new_label(tcg_ctx);
+            tcg_ctx->icount_exit_insn[n] = tcg_ctx->icount_insn;
+            tcg_ctx->nb_icount_exits = ++n;
+        }
+        exit_label = tcg_ctx->icount_exit_label[n - 1];
+    }
+
+    tcg_gen_brcondi_i32(tcg_ctx, TCG_COND_LT, count, 0, exit_label);
 
     tcg_temp_free_i32(tcg_ctx, count);
 }
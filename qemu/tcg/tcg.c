@@ -406,7 +406,6 @@ static void tcg_region_assign(TCGContext *s, size_t curr_region)
     s->code_gen_buffer = start;
     s->code_gen_ptr = start;
     s->code_gen_buffer_size = (char *)end - (char *)start;
-    memset(s->code_gen_buffer, 0x00, s->code_gen_buffer_size);
     s->code_gen_highwater = (char *)end - TCG_HIGHWATER;
 }
 
@@ -449,6 +448,22 @@ static inline bool tcg_region_initial_alloc__locked(TCGContext *s)
 /* Call from a safe-work context */
 void tcg_region_reset_all(TCGContext *tcg_ctx)
 {
+    size_t i;
+
+    /*
+     * Unicorn: wipe the code generated so far. Clearing the whole buffer
+     * here made every tb_flush() cost as much as touching all of it.
+     */
+    for (i = 0; i < tcg_ctx->region.current; i++) {
+        void *start, *end;
+
+        tcg_region_bounds(tcg_ctx, i, &start, &end);
+        if (i == tcg_ctx->region.current - 1) {
+            end = tcg_ctx->code_gen_ptr;
+        }
+        memset(start, 0x00, (char *)end - (char *)start);
+    }
+
     tcg_ctx->region.current = 0;
     tcg_ctx->region.agg_size_full = 0;
 
@@ -664,27 +679,31 @@ static TCGTemp *tcg_global_reg_new_internal(TCGContext *s, TCGType type,
 
 void uc_add_inline_hook(uc_engine *uc, struct hook *hk, void** args, int args_len)
 {
-    TCGHelperInfo* info = g_malloc(sizeof(TCGHelperInfo));
-    char *name = g_malloc(64);
+    TCGHelperInfo* info;
+    char *name;
     unsigned sizemask = 0xFFFFFFFF;
     TCGContext *tcg_ctx = uc->tcg_ctx;
     GHashTable *helper_table = uc->tcg_ctx->helper_table;
 
+    // The same callback is registered once, no matter how many instructions
+    // or hooks use it.
+    if (g_hash_table_lookup(uc->tcg_ctx->custom_helper_infos, hk->callback)) {
+        tcg_gen_callN(tcg_ctx, hk->callback, NULL, args_len, (TCGTemp**)args);
+        return;
+    }
+
+    info = g_malloc(sizeof(TCGHelperInfo));
+    name = g_malloc(64);
     info->func = hk->callback;
     info->name = name;
     info->flags = 0; // From helper-head.h
 
     // Only UC_HOOK_BLOCK and UC_HOOK_CODE is generated into tcg code and can be inlined.
-    switch (hk->type) {
-    case UC_HOOK_BLOCK:
-    case UC_HOOK_CODE:
+    // A single hook may be registered for both.
+    if (hk->type & (UC_HOOK_BLOCK | UC_HOOK_CODE)) {
         // (*uc_cb_hookcode_t)(uc_engine *uc, uint64_t address, uint32_t size, void *user_data);
         sizemask = dh_sizemask(void, 0) | dh_sizemask(ptr, 1) | dh_sizemask(i64, 2) | dh_sizemask(i32, 3) | dh_sizemask(ptr, 4);
         snprintf(name, 63, "hookcode_%d_%" PRIx64 , hk->type, (uint64_t)hk->callback);
-        break;
-
-    default:
-        break;
     }
 
     name[63] = 0;
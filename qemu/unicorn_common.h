@@ -37,6 +37,10 @@ static void release_common(void *t)
     int i;
 #endif
 
+    // Removing a breakpoint flushes the TBs, do it while they still exist.
+    cpu_watchpoint_remove_all(CPU(s->uc->cpu), BP_CPU);
+    cpu_breakpoint_remove_all(CPU(s->uc->cpu), BP_CPU);
+
     // Clean TCG.
     TCGOpDef* def = s->tcg_op_defs;
     g_free(def->args_ct);
@@ -69,9 +73,6 @@ static void release_common(void *t)
     /* qemu/util/qht.c:264: map = qht_map_create(n_buckets); */
     qht_destroy(&s->tb_ctx.htable);
 
-    cpu_watchpoint_remove_all(CPU(s->uc->cpu), BP_CPU);
-    cpu_breakpoint_remove_all(CPU(s->uc->cpu), BP_CPU);
-
 #if TCG_TARGET_REG_BITS == 32
     for(i = 0; i < s->nb_globals; i++) {
         TCGTemp *ts = &s->temps[i];
@@ -91,6 +92,26 @@ static inline void target_page_init(struct uc_struct* uc)
     uc->target_page_align = TARGET_PAGE_SIZE - 1;
 }
 
+// Unmap all the memory at once, the caller flushes the TLB.
+static void memory_unmap_all(struct uc_struct *uc)
+{
+    memory_free(uc);
+    uc->mapped_block_count = 0;
+}
+
+// Batch the memory map changes until memory_commit().
+static void memory_begin(struct uc_struct *uc)
+{
+    memory_region_transaction_begin(uc);
+}
+
+// Apply the memory map changes batched, the flatview is rebuilt and the TLB
+// flushed once.
+static void memory_commit(struct uc_struct *uc)
+{
+    memory_region_transaction_commit(uc->system_memory);
+}
+
 void softfloat_init(void);
 static inline void uc_common_init(struct uc_struct* uc)
 {
@@ -102,10 +123,15 @@ static inline void uc_common_init(struct uc_struct* uc)
     uc->memory_map = memory_map;
     uc->memory_map_ptr = memory_map_ptr;
     uc->memory_unmap = memory_unmap;
+    uc->memory_split = memory_split;
+    uc->memory_unmap_all = memory_unmap_all;
+    uc->memory_begin = memory_begin;
+    uc->memory_commit = memory_commit;
     uc->readonly_mem = memory_region_set_readonly;
     uc->target_page = target_page_init;
     uc->softfloat_initialize = softfloat_init;
     uc->tcg_flush_tlb = tcg_flush_softmmu_tlb;
+    uc->vmem_translate = tlb_vaddr_to_paddr;
     uc->memory_map_io = memory_map_io;
 
     if (!uc->release)
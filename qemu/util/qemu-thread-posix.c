@@ -14,6 +14,8 @@
 #include <stdio.h>
 #include <signal.h>
 #include <string.h>
+#include <errno.h>
+#include <time.h>
 #include "qemu/thread.h"
 
 static void error_exit(int err, const char *msg)
@@ -22,6 +24,85 @@ static void error_exit(int err, const char *msg)
     abort();
 }
 
+void qemu_mutex_lock(QemuMutex *mutex)
+{
+    int err;
+
+    err = pthread_mutex_lock(&mutex->lock);
+    if (err) {
+        error_exit(err, __func__);
+    }
+}
+
+void qemu_mutex_unlock(QemuMutex *mutex)
+{
+    int err;
+
+    err = pthread_mutex_unlock(&mutex->lock);
+    if (err) {
+        error_exit(err, __func__);
+    }
+}
+
+void qemu_cond_init(QemuCond *cond)
+{
+    pthread_condattr_t attr;
+    int err;
+
+    err = pthread_condattr_init(&attr);
+    if (err) {
+        error_exit(err, __func__);
+    }
+    cond->clock = CLOCK_REALTIME;
+#ifndef __APPLE__
+    if (pthread_condattr_setclock(&attr, CLOCK_MONOTONIC) == 0) {
+        cond->clock = CLOCK_MONOTONIC;
+    }
+#endif
+    err = pthread_cond_init(&cond->cond, &attr);
+    if (err) {
+        error_exit(err, __func__);
+    }
+    pthread_condattr_destroy(&attr);
+}
+
+void qemu_cond_signal(QemuCond *cond)
+{
+    int err;
+
+    err = pthread_cond_signal(&cond->cond);
+    if (err) {
+        error_exit(err, __func__);
+    }
+}
+
+bool qemu_cond_timedwait_ns(QemuCond *cond, QemuMutex *mutex, int64_t ns)
+{
+    struct timespec ts;
+    int err;
+
+#ifdef __APPLE__
+    /* No monotonic condition variables, but a relative wait */
+    ts.tv_sec = ns / 1000000000LL;
+    ts.tv_nsec = ns % 1000000000LL;
+    err = pthread_cond_timedwait_relative_np(&cond->cond, &mutex->lock, &ts);
+#else
+    clock_gettime(cond->clock, &ts);
+    ts.tv_sec += ns / 1000000000LL;
+    ts.tv_nsec += ns % 1000000000LL;
+    if (ts.tv_nsec >= 1000000000) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+    }
+
+    err = pthread_cond_timedwait(&cond->cond, &mutex->lock, &ts);
+#endif
+    if (err && err != ETIMEDOUT) {
+        error_exit(err, __func__);
+    }
+    return err != ETIMEDOUT;
+}
+
 int qemu_thread_create(struct uc_struct *uc, QemuThread *thread, const char *name,
                        void *(*start_routine)(void*),
                        void *arg, int mode)
@@ -30,6 +30,41 @@ static void error_exit(int err, const char *msg)
     //abort();
 }
 
+void qemu_mutex_lock(QemuMutex *mutex)
+{
+    AcquireSRWLockExclusive(&mutex->lock);
+}
+
+void qemu_mutex_unlock(QemuMutex *mutex)
+{
+    ReleaseSRWLockExclusive(&mutex->lock);
+}
+
+void qemu_cond_init(QemuCond *cond)
+{
+    /* The timeouts of SleepConditionVariableSRW are relative */
+    InitializeConditionVariable(&cond->var);
+}
+
+void qemu_cond_signal(QemuCond *cond)
+{
+    WakeConditionVariable(&cond->var);
+}
+
+bool qemu_cond_timedwait_ns(QemuCond *cond, QemuMutex *mutex, int64_t ns)
+{
+    /* Round up, the timer service must not wake up before a deadline */
+    DWORD ms = (DWORD)((ns + 999999) / 1000000);
+
+    if (!SleepConditionVariableSRW(&cond->var, &mutex->lock, ms, 0)) {
+        if (GetLastError() != ERROR_TIMEOUT) {
+            error_exit(GetLastError(), __func__);
+        }
+        return false;
+    }
+    return true;
+}
+
 struct QemuThreadData {
     /* Passed to win32_start_routine.  */
     void             *(*start_routine)(void *);
@@ -50,9 +85,11 @@ static unsigned __stdcall win32_start_routine(void *arg)
     void *thread_arg = data->arg;
 
     if (data->mode == QEMU_THREAD_DETACHED) {
-        data->uc->qemu_thread_data = NULL;
+        /* Nobody joins a detached thread, its data isn't tied to an engine */
         g_free(data);
         data = NULL;
+        start_routine(thread_arg);
+        _endthreadex(0);
     }
     qemu_thread_exit(data->uc, start_routine(thread_arg));
     abort();
@@ -117,9 +154,8 @@ int qemu_thread_create(struct uc_struct *uc, QemuThread *thread, const char *nam
     data->exited = false;
     data->uc = uc;
 
-    uc->qemu_thread_data = data;
-
     if (data->mode != QEMU_THREAD_DETACHED) {
+        uc->qemu_thread_data = data;
         InitializeCriticalSection(&data->cs);
     }
 
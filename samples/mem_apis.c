@@ -364,11 +364,127 @@ static void unmap_test()
     do_unmap_demo(true);
 }
 
+static void hook_mem_count(uc_engine *uc, uc_mem_type type, uint64_t addr,
+                           int size, int64_t value, void *user_data)
+{
+    (*(int *)user_data)++;
+}
+
+/*
+   bits 32
+   mov ecx, 0x100000
+ lb:
+   mov eax, [esi]
+   mov [esi + 4], eax
+   dec ecx
+   jnz lb
+ */
+static const uint8_t HOOK_PERF_DEMO[] =
+    "\xb9\x00\x00\x10\x00\x8b\x06\x89\x46\x04\x49\x75\xf8";
+
+static double time_hooked_run(uint64_t hook_begin, uint64_t hook_end,
+                              int *hooked)
+{
+    uc_engine *uc;
+    uc_hook trace;
+    uint32_t esi = 0x200000;
+    clock_t t1, t2;
+
+    uc_open(UC_ARCH_X86, UC_MODE_32, &uc);
+    uc_mem_map(uc, 0x100000, 0x1000, UC_PROT_ALL);
+    uc_mem_map(uc, 0x200000, 0x1000, UC_PROT_ALL);
+    uc_mem_map(uc, 0x300000, 0x1000, UC_PROT_ALL);
+    uc_mem_write(uc, 0x100000, HOOK_PERF_DEMO, sizeof(HOOK_PERF_DEMO) - 1);
+    uc_reg_write(uc, UC_X86_REG_ESI, &esi);
+
+    *hooked = 0;
+    if (hook_begin <= hook_end) {
+        uc_hook_add(uc, &trace, UC_HOOK_MEM_READ | UC_HOOK_MEM_WRITE,
+                    hook_mem_count, hooked, hook_begin, hook_end);
+    }
+
+    t1 = clock();
+    uc_emu_start(uc, 0x100000, 0x100000 + sizeof(HOOK_PERF_DEMO) - 1, 0, 0);
+    t2 = clock();
+
+    uc_close(uc);
+
+    return (t2 - t1) * 1000.0 / CLOCKS_PER_SEC;
+}
+
+static void hook_perf_test()
+{
+    int hooked;
+    double none, other_page, same_page;
+
+    printf("===================================\n");
+    printf("# Cost of a narrow memory hook on unrelated accesses\n");
+
+    none = time_hooked_run(1, 0, &hooked);
+    // a 4 bytes variable on another page, never accessed
+    other_page = time_hooked_run(0x300000, 0x300003, &hooked);
+    printf("Hook on another page: %d callbacks\n", hooked);
+    // a 4 bytes variable next to the data, only the page takes the slow path
+    same_page = time_hooked_run(0x200800, 0x200803, &hooked);
+    printf("Hook on the data page: %d callbacks\n", hooked);
+
+    printf(">>> Run time: No hook: %f ms, Hook on another page: %f ms, "
+           "Hook on the data page: %f ms\n",
+           none, other_page, same_page);
+}
+
+/*
+   bits 64
+   mov rax, [rsi]
+ */
+static const uint8_t CHURN_DEMO[] = "\x48\x8b\x06";
+
+static double time_map_churn(uint64_t size, int rounds)
+{
+    uc_engine *uc;
+    uint64_t rsi = 0x100000000;
+    clock_t t1, t2;
+    int i;
+
+    uc_open(UC_ARCH_X86, UC_MODE_64, &uc);
+    uc_mem_map(uc, 0x1000, 0x1000, UC_PROT_ALL);
+    uc_mem_write(uc, 0x1000, CHURN_DEMO, sizeof(CHURN_DEMO) - 1);
+    uc_reg_write(uc, UC_X86_REG_RSI, &rsi);
+
+    t1 = clock();
+    for (i = 0; i < rounds; i++) {
+        uc_mem_map(uc, rsi, size, UC_PROT_ALL);
+        uc_emu_start(uc, 0x1000, 0x1000 + sizeof(CHURN_DEMO) - 1, 0, 0);
+        uc_mem_unmap(uc, rsi, size);
+    }
+    t2 = clock();
+
+    uc_close(uc);
+
+    return (t2 - t1) * 1000.0 / CLOCKS_PER_SEC / rounds;
+}
+
+static void map_churn_test()
+{
+    double small, big;
+
+    printf("===================================\n");
+    printf("# Cost of mapping and unmapping memory while running\n");
+
+    small = time_map_churn(0x1000, 1000);
+    big = time_map_churn(0x100000000, 20);
+
+    printf(">>> Map, run and unmap: 4 KB region: %f ms, 4 GB region: %f ms\n",
+           small, big);
+}
+
 int main(int argc, char **argv, char **envp)
 {
     nx_test();
     perms_test();
     unmap_test();
+    hook_perf_test();
+    map_churn_test();
 
     return 0;
 }
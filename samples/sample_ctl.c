@@ -276,6 +276,66 @@ static void test_uc_ctl_tb_cache()
     uc_close(uc);
 }
 
+#define TIMEOUT_RUNS (10000)
+
+static double time_runs(uc_engine *uc, uint64_t timeout)
+{
+    time_t t1, t2;
+    int i;
+
+    t1 = clock();
+
+    for (i = 0; i < TIMEOUT_RUNS; i++) {
+        uc_emu_start(uc, ADDRESS, ADDRESS + sizeof(X86_CODE32) - 1, timeout, 0);
+    }
+
+    t2 = clock();
+
+    // microseconds per uc_emu_start
+    return (t2 - t1) * 1000000.0 / CLOCKS_PER_SEC / TIMEOUT_RUNS;
+}
+
+static void test_uc_timeout_overhead()
+{
+    uc_engine *uc;
+    uc_err err;
+    double standard, timed;
+
+    printf("Measuring the cost of a timeout on short uc_emu_start calls.\n");
+
+    // Initialize emulator in X86-32bit mode
+    err = uc_open(UC_ARCH_X86, UC_MODE_32, &uc);
+    if (err) {
+        printf("Failed on uc_open() with error returned: %u\n", err);
+        return;
+    }
+
+    err = uc_mem_map(uc, ADDRESS, 0x1000, UC_PROT_ALL);
+    if (err) {
+        printf("Failed on uc_mem_map() with error returned: %u\n", err);
+        return;
+    }
+
+    // Write our code to the memory.
+    err = uc_mem_write(uc, ADDRESS, X86_CODE32, sizeof(X86_CODE32) - 1);
+    if (err) {
+        printf("Failed on uc_mem_write() with error returned: %u\n", err);
+        return;
+    }
+
+    // Translate the code once so that only the runs are measured.
+    uc_emu_start(uc, ADDRESS, ADDRESS + sizeof(X86_CODE32) - 1, 0, 0);
+
+    standard = time_runs(uc, 0);
+    // One second, never reached.
+    timed = time_runs(uc, 1000 * 1000);
+
+    printf(">>> Per call: No timeout: %f us, Timeout: %f us, Overhead: %f us\n",
+           standard, timed, timed - standard);
+
+    uc_close(uc);
+}
+
 int main(int argc, char **argv, char **envp)
 {
     test_uc_ctl_read();
@@ -283,6 +343,8 @@ int main(int argc, char **argv, char **envp)
     test_uc_ctl_exits();
     printf("====================\n");
     test_uc_ctl_tb_cache();
+    printf("====================\n");
+    test_uc_timeout_overhead();
 
     return 0;
 }
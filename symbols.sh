@@ -76,6 +76,7 @@ qemu_ram_get_used_length \
 qemu_ram_is_shared \
 qemu_ram_pagesize \
 qemu_ram_alloc_from_ptr \
+qemu_ram_alloc_slice \
 qemu_ram_alloc \
 qemu_ram_free \
 qemu_map_ram_ptr \
@@ -120,6 +121,7 @@ memory_map \
 memory_map_io \
 memory_map_ptr \
 memory_unmap \
+memory_split \
 memory_free \
 flatview_unref \
 address_space_get_flatview \
@@ -764,6 +766,8 @@ cpu_loop_exit_atomic \
 tlb_init \
 tlb_flush_by_mmuidx \
 tlb_flush \
+tlb_flush_range \
+tlb_vaddr_to_paddr \
 tlb_flush_by_mmuidx_all_cpus \
 tlb_flush_all_cpus \
 tlb_flush_by_mmuidx_all_cpus_synced \
@@ -1243,6 +1247,7 @@ helper_gvec_umax32 \
 helper_gvec_umax64 \
 helper_gvec_bitsel \
 cpu_restore_state \
+cpu_restore_icount \
 page_collection_lock \
 page_collection_unlock \
 free_code_gen_buffer \
@@ -1,5 +1,8 @@
-#/bin/sh
+#!/bin/sh
 # generates all fuzz targets for different architectures from the template in fuzz_emu_x86_32.c
+# (one engine per target, reset with uc_reset() between inputs)
+
+cd "$(dirname "$0")" || exit 1
 
 sed 's/UC_MODE_32/UC_MODE_64/' fuzz_emu_x86_32.c > fuzz_emu_x86_64.c
 sed 's/UC_MODE_32/UC_MODE_16/' fuzz_emu_x86_32.c > fuzz_emu_x86_16.c
@@ -775,6 +775,67 @@ static void test_arm_context_save(void)
     OK(uc_close(uc2));
 }
 
+static void test_arm_context_regs(void)
+{
+    uc_engine *uc;
+    uc_context *ctx;
+    uint32_t r_r0 = 1, r_pc = 0x1000;
+    uint64_t r_d0 = 2;
+
+    OK(uc_open(UC_ARCH_ARM, UC_MODE_ARM, &uc));
+    OK(uc_ctl_context_regs(uc, UC_CTL_CONTEXT_REGS_GPR));
+    OK(uc_context_alloc(uc, &ctx));
+
+    OK(uc_reg_write(uc, UC_ARM_REG_R0, &r_r0));
+    OK(uc_reg_write(uc, UC_ARM_REG_PC, &r_pc));
+    OK(uc_reg_write(uc, UC_ARM_REG_D0, &r_d0));
+    OK(uc_context_save(uc, ctx));
+
+    r_r0 = 3;
+    r_pc = 0x2000;
+    r_d0 = 4;
+    OK(uc_reg_write(uc, UC_ARM_REG_R0, &r_r0));
+    OK(uc_reg_write(uc, UC_ARM_REG_PC, &r_pc));
+    OK(uc_reg_write(uc, UC_ARM_REG_D0, &r_d0));
+
+    // The FP registers are left alone.
+    OK(uc_context_restore(uc, ctx));
+    OK(uc_reg_read(uc, UC_ARM_REG_R0, &r_r0));
+    OK(uc_reg_read(uc, UC_ARM_REG_PC, &r_pc));
+    OK(uc_reg_read(uc, UC_ARM_REG_D0, &r_d0));
+    TEST_CHECK(r_r0 == 1 && r_pc == 0x1000);
+    TEST_CHECK(r_d0 == 4);
+
+    OK(uc_context_free(ctx));
+    OK(uc_close(uc));
+}
+
+static void test_arm_m_snapshot(void)
+{
+    uc_engine *uc, *uc2;
+    char code[] = "\x01\x30"; // adds r0, #1
+    const char *path = "test_arm_m_snapshot.snap";
+    int r_r0 = 0x10;
+
+    // The PMSAv7 MPU regions are arrays out of the CPU state.
+    uc_common_setup(&uc, UC_ARCH_ARM, UC_MODE_THUMB | UC_MODE_MCLASS, code,
+                    sizeof(code) - 1, UC_CPU_ARM_CORTEX_M3);
+    OK(uc_reg_write(uc, UC_ARM_REG_R0, &r_r0));
+    OK(uc_snapshot_save(uc, path));
+
+    OK(uc_open(UC_ARCH_ARM, UC_MODE_THUMB | UC_MODE_MCLASS, &uc2));
+    OK(uc_ctl_set_cpu_model(uc2, UC_CPU_ARM_CORTEX_M3));
+    OK(uc_snapshot_load(uc2, path));
+    OK(uc_close(uc));
+
+    OK(uc_emu_start(uc2, code_start | 1, code_start + sizeof(code) - 1, 0, 0));
+    OK(uc_reg_read(uc2, UC_ARM_REG_R0, &r_r0));
+    TEST_CHECK(r_r0 == 0x11);
+
+    OK(uc_close(uc2));
+    remove(path);
+}
+
 static void test_arm_thumb2(void)
 {
     uc_engine *uc;
@@ -838,6 +899,8 @@ TEST_LIST = {{"test_arm_nop", test_arm_nop},
              {"test_arm_switch_endian", test_arm_switch_endian},
              {"test_armeb_ldrb", test_armeb_ldrb},
              {"test_arm_context_save", test_arm_context_save},
+             {"test_arm_context_regs", test_arm_context_regs},
+             {"test_arm_m_snapshot", test_arm_m_snapshot},
              {"test_arm_thumb2", test_arm_thumb2},
              {"test_armeb_be32_thumb2", test_armeb_be32_thumb2},
              {NULL, NULL}};
\ No newline at end of file
@@ -372,6 +372,40 @@ static void test_arm64_block_invalid_mem_read_write_sync(void)
     OK(uc_close(uc));
 }
 
+static void test_arm64_context_regs(void)
+{
+    uc_engine *uc;
+    uc_context *ctx;
+    uint64_t r_x0 = 1, r_pc = 0x1000, r_d0 = 2;
+
+    OK(uc_open(UC_ARCH_ARM64, UC_MODE_ARM, &uc));
+    OK(uc_ctl_context_regs(uc, UC_CTL_CONTEXT_REGS_GPR));
+    OK(uc_context_alloc(uc, &ctx));
+
+    OK(uc_reg_write(uc, UC_ARM64_REG_X0, &r_x0));
+    OK(uc_reg_write(uc, UC_ARM64_REG_PC, &r_pc));
+    OK(uc_reg_write(uc, UC_ARM64_REG_D0, &r_d0));
+    OK(uc_context_save(uc, ctx));
+
+    r_x0 = 3;
+    r_pc = 0x2000;
+    r_d0 = 4;
+    OK(uc_reg_write(uc, UC_ARM64_REG_X0, &r_x0));
+    OK(uc_reg_write(uc, UC_ARM64_REG_PC, &r_pc));
+    OK(uc_reg_write(uc, UC_ARM64_REG_D0, &r_d0));
+
+    // The FP registers are left alone.
+    OK(uc_context_restore(uc, ctx));
+    OK(uc_reg_read(uc, UC_ARM64_REG_X0, &r_x0));
+    OK(uc_reg_read(uc, UC_ARM64_REG_PC, &r_pc));
+    OK(uc_reg_read(uc, UC_ARM64_REG_D0, &r_d0));
+    TEST_CHECK(r_x0 == 1 && r_pc == 0x1000);
+    TEST_CHECK(r_d0 == 4);
+
+    OK(uc_context_free(ctx));
+    OK(uc_close(uc));
+}
+
 TEST_LIST = {{"test_arm64_until", test_arm64_until},
              {"test_arm64_code_patching", test_arm64_code_patching},
              {"test_arm64_code_patching_count", test_arm64_code_patching_count},
@@ -385,4 +419,5 @@ TEST_LIST = {{"test_arm64_until", test_arm64_until},
              {"test_arm64_block_sync_pc", test_arm64_block_sync_pc},
              {"test_arm64_block_invalid_mem_read_write_sync",
               test_arm64_block_invalid_mem_read_write_sync},
+             {"test_arm64_context_regs", test_arm64_context_regs},
              {NULL, NULL}};
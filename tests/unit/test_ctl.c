@@ -175,6 +175,147 @@ static void test_uc_ctl_tb_cache(void)
     OK(uc_close(uc));
 }
 
+static void test_uc_ctl_timeout_clock(void)
+{
+    uc_engine *uc;
+    // lb:
+    //   inc ecx;
+    //   jmp lb;
+    char code[] = "\x41\xeb\xfd";
+    int clock;
+    int r_ecx = 0;
+    size_t timed_out;
+    size_t retired;
+
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code, sizeof(code) - 1);
+    OK(uc_ctl_get_timeout_clock(uc, &clock));
+    TEST_CHECK(clock == UC_TIMEOUT_CLOCK_HOST);
+    OK(uc_ctl_set_timeout_clock(uc, UC_TIMEOUT_CLOCK_VIRTUAL));
+    OK(uc_ctl_get_timeout_clock(uc, &clock));
+    TEST_CHECK(clock == UC_TIMEOUT_CLOCK_VIRTUAL);
+
+    // Times out after exactly 1001 instructions, every time.
+    for (int i = 0; i < 2; i++) {
+        OK(uc_reg_write(uc, UC_X86_REG_ECX, &r_ecx));
+        OK(uc_emu_start(uc, code_start, 0, 1001, 0));
+        OK(uc_reg_read(uc, UC_X86_REG_ECX, &r_ecx));
+        OK(uc_query(uc, UC_QUERY_TIMEOUT, &timed_out));
+        OK(uc_query(uc, UC_QUERY_INSN_COUNT, &retired));
+        TEST_CHECK(r_ecx == 501);
+        TEST_CHECK(timed_out == 1);
+        TEST_CHECK(retired == 1001);
+        r_ecx = 0;
+    }
+
+    // A smaller @count stops the emulation first.
+    OK(uc_emu_start(uc, code_start, 0, 1001, 10));
+    OK(uc_query(uc, UC_QUERY_TIMEOUT, &timed_out));
+    TEST_CHECK(timed_out == 0);
+
+    uc_assert_err(UC_ERR_ARG, uc_ctl_set_timeout_clock(uc, 2));
+
+    OK(uc_close(uc));
+}
+
+static void test_uc_ctl_breakpoints(void)
+{
+    uc_engine *uc;
+    // inc ecx; inc ecx; inc edx; inc edx; inc ecx
+    char code[] = "\x41\x41\x42\x42\x41";
+    uint64_t bps[] = {code_start + 2, code_start + 4};
+    uint64_t *many;
+    uint64_t hit;
+    int r_ecx = 0;
+    int r_edx = 0;
+
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code, sizeof(code) - 1);
+    OK(uc_ctl_add_breakpoints(uc, bps, 2));
+
+    // The same breakpoint is hit again once its TB is cached.
+    for (int i = 0; i < 2; i++) {
+        uc_assert_err(UC_ERR_BREAKPOINT,
+                      uc_emu_start(uc, code_start,
+                                   code_start + sizeof(code) - 1, 0, 0));
+        OK(uc_ctl_get_breakpoint_hit(uc, &hit));
+        TEST_CHECK(hit == code_start + 2);
+    }
+    OK(uc_reg_read(uc, UC_X86_REG_ECX, &r_ecx));
+    TEST_CHECK(r_ecx == 4);
+
+    // Resuming executes the breakpoint.
+    uc_assert_err(UC_ERR_BREAKPOINT,
+                  uc_emu_start(uc, hit, code_start + sizeof(code) - 1, 0, 0));
+    OK(uc_ctl_get_breakpoint_hit(uc, &hit));
+    TEST_CHECK(hit == code_start + 4);
+    OK(uc_reg_read(uc, UC_X86_REG_EDX, &r_edx));
+    TEST_CHECK(r_edx == 2);
+
+    OK(uc_emu_start(uc, hit, code_start + sizeof(code) - 1, 0, 0));
+    uc_assert_err(UC_ERR_ARG, uc_ctl_get_breakpoint_hit(uc, &hit));
+    OK(uc_reg_read(uc, UC_X86_REG_ECX, &r_ecx));
+    TEST_CHECK(r_ecx == 5);
+
+    // Lots of breakpoints elsewhere don't get in the way.
+    many = calloc(100000, sizeof(uint64_t));
+    for (int i = 0; i < 100000; i++) {
+        many[i] = 0x100000 + i;
+    }
+    OK(uc_ctl_add_breakpoints(uc, many, 100000));
+    OK(uc_ctl_remove_breakpoints(uc, bps, 1));
+    uc_assert_err(UC_ERR_BREAKPOINT,
+                  uc_emu_start(uc, code_start, code_start + sizeof(code) - 1,
+                               0, 0));
+    OK(uc_ctl_get_breakpoint_hit(uc, &hit));
+    TEST_CHECK(hit == code_start + 4);
+    free(many);
+
+    OK(uc_close(uc));
+}
+
+static uint32_t coverage_loc(uint64_t pc)
+{
+    return (uint32_t)((pc >> 4) ^ (pc << 8)) & 0xffff;
+}
+
+static void test_uc_ctl_coverage_map(void)
+{
+    uc_engine *uc;
+    // mov ecx, 3; loop: dec ecx; jnz loop
+    char code[] = "\xb9\x03\x00\x00\x00\x49\x75\xfd";
+    uint8_t *map = calloc(1, 0x10000);
+    uint8_t *map2;
+    size_t size;
+    uint32_t a = coverage_loc(code_start);
+    uint32_t b = coverage_loc(code_start + 5);
+    int total = 0;
+
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code, sizeof(code) - 1);
+
+    uc_assert_err(UC_ERR_ARG, uc_ctl_set_coverage_map(uc, map, 0x10001));
+    OK(uc_ctl_set_coverage_map(uc, map, 0x10000));
+    OK(uc_ctl_get_coverage_map(uc, &map2, &size));
+    TEST_CHECK(map2 == map && size == 0x10000);
+
+    // The second run goes through the cached and chained TBs.
+    for (int i = 1; i <= 2; i++) {
+        OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 0));
+        TEST_CHECK(map[a] == i);
+        TEST_CHECK(map[b ^ (a >> 1)] == i);
+        TEST_CHECK(map[b ^ (b >> 1)] == i);
+    }
+    for (int i = 0; i < 0x10000; i++) {
+        total += map[i];
+    }
+    TEST_CHECK(total == 6);
+
+    OK(uc_ctl_set_coverage_map(uc, NULL, 0));
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 0));
+    TEST_CHECK(map[a] == 2);
+
+    OK(uc_close(uc));
+    free(map);
+}
+
 // Test requires UC_ARCH_ARM.
 #ifdef UNICORN_HAS_ARM
 static void test_uc_ctl_change_page_size(void)
@@ -231,6 +372,36 @@ static void test_uc_ctl_arm_cpu(void)
 
     OK(uc_close(uc));
 }
+
+static void test_uc_ctl_arm_clone_mclass(void)
+{
+    uc_engine *uc, *clone;
+    char code[] = "\x01\x30"; // adds r0, #1
+    int r_r0 = 0x10;
+
+    OK(uc_open(UC_ARCH_ARM, UC_MODE_THUMB | UC_MODE_MCLASS, &uc));
+    // The PMSAv7 MPU regions are arrays out of the CPU state.
+    OK(uc_ctl_set_cpu_model(uc, UC_CPU_ARM_CORTEX_M3));
+    OK(uc_mem_map(uc, code_start, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, code_start, code, sizeof(code) - 1));
+    OK(uc_reg_write(uc, UC_ARM_REG_R0, &r_r0));
+
+    OK(uc_clone(uc, &clone));
+
+    OK(uc_emu_start(clone, code_start | 1, code_start + sizeof(code) - 1, 0,
+                    0));
+    OK(uc_reg_read(clone, UC_ARM_REG_R0, &r_r0));
+    TEST_CHECK(r_r0 == 0x11);
+
+    // The parent must outlive the clone and keep its own arrays.
+    OK(uc_close(clone));
+
+    OK(uc_emu_start(uc, code_start | 1, code_start + sizeof(code) - 1, 0, 0));
+    OK(uc_reg_read(uc, UC_ARM_REG_R0, &r_r0));
+    TEST_CHECK(r_r0 == 0x11);
+
+    OK(uc_close(uc));
+}
 #endif
 
 static void test_uc_hook_cached_cb(uc_engine *uc, uint64_t addr, size_t size,
@@ -310,9 +481,13 @@ TEST_LIST = {{"test_uc_ctl_mode", test_uc_ctl_mode},
              {"test_uc_ctl_time_out", test_uc_ctl_time_out},
              {"test_uc_ctl_exits", test_uc_ctl_exits},
              {"test_uc_ctl_tb_cache", test_uc_ctl_tb_cache},
+             {"test_uc_ctl_timeout_clock", test_uc_ctl_timeout_clock},
+             {"test_uc_ctl_breakpoints", test_uc_ctl_breakpoints},
+             {"test_uc_ctl_coverage_map", test_uc_ctl_coverage_map},
 #ifdef UNICORN_HAS_ARM
              {"test_uc_ctl_change_page_size", test_uc_ctl_change_page_size},
              {"test_uc_ctl_arm_cpu", test_uc_ctl_arm_cpu},
+             {"test_uc_ctl_arm_clone_mclass", test_uc_ctl_arm_clone_mclass},
 #endif
              {"test_uc_hook_cached_uaf", test_uc_hook_cached_uaf},
              {NULL, NULL}};
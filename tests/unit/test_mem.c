@@ -1,4 +1,7 @@
 #include "unicorn_test.h"
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
 
 static void test_map_correct(void)
 {
@@ -275,6 +278,750 @@ static void test_mem_protect_mmio(void)
     OK(uc_close(uc));
 }
 
+static void test_mem_hook_bounded_cb(uc_engine *uc, uc_mem_type type,
+                                     uint64_t address, int size, int64_t value,
+                                     void *user_data)
+{
+    (*(int *)user_data)++;
+}
+
+static void test_mem_hook_bounded(void)
+{
+    uc_engine *uc;
+    // mov eax, [0x2000]; mov [0x2800], eax
+    char code[] = "\xa1\x00\x20\x00\x00\x00\x00\x00\x00\xa3\x00\x28\x00\x00\x00"
+                  "\x00\x00\x00";
+    uc_hook h1, h2;
+    int other_page = 0, same_page = 0;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_64, &uc));
+    OK(uc_mem_map(uc, 0x1000, 0x8000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, 0x8000, code, sizeof(code) - 1));
+
+    // Fill the TLB before any hook exists.
+    OK(uc_emu_start(uc, 0x8000, 0x8000 + sizeof(code) - 1, 0, 0));
+
+    OK(uc_hook_add(uc, &h1, UC_HOOK_MEM_READ | UC_HOOK_MEM_WRITE,
+                   test_mem_hook_bounded_cb, &other_page, 0x5000, 0x5003));
+    OK(uc_hook_add(uc, &h2, UC_HOOK_MEM_WRITE, test_mem_hook_bounded_cb,
+                   &same_page, 0x2800, 0x2803));
+    OK(uc_emu_start(uc, 0x8000, 0x8000 + sizeof(code) - 1, 0, 0));
+
+    TEST_CHECK(other_page == 0);
+    TEST_CHECK(same_page == 1);
+
+    OK(uc_hook_del(uc, h2));
+    OK(uc_emu_start(uc, 0x8000, 0x8000 + sizeof(code) - 1, 0, 0));
+
+    TEST_CHECK(other_page == 0);
+    TEST_CHECK(same_page == 1);
+
+    OK(uc_close(uc));
+}
+
+typedef struct {
+    uc_hook victim;
+    int calls;
+} test_mem_hook_many_del_t;
+
+static void test_mem_hook_many_del_cb(uc_engine *uc, uc_mem_type type,
+                                      uint64_t address, int size,
+                                      int64_t value, void *user_data)
+{
+    test_mem_hook_many_del_t *del = (test_mem_hook_many_del_t *)user_data;
+
+    del->calls++;
+    OK(uc_hook_del(uc, del->victim));
+}
+
+static void test_mem_hook_many(void)
+{
+    uc_engine *uc;
+    // mov eax, [0x2000]; mov [0x2800], eax
+    char code[] = "\xa1\x00\x20\x00\x00\x00\x00\x00\x00\xa3\x00\x28\x00\x00\x00"
+                  "\x00\x00\x00";
+    test_mem_hook_many_del_t del = {0};
+    uc_hook h;
+    int outside = 0, read = 0, write = 0, victim = 0;
+    int i;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_64, &uc));
+    OK(uc_mem_map(uc, 0x1000, 0x8000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, 0x8000, code, sizeof(code) - 1));
+
+    for (i = 0; i < 1000; i++) {
+        OK(uc_hook_add(uc, &h, UC_HOOK_MEM_READ | UC_HOOK_MEM_WRITE,
+                       test_mem_hook_bounded_cb, &outside, 0x100000 + i * 0x10,
+                       0x100000 + i * 0x10 + 0xf));
+        if (i == 500) {
+            OK(uc_hook_add(uc, &h, UC_HOOK_MEM_READ, test_mem_hook_bounded_cb,
+                           &read, 0x1f00, 0x2003));
+            // Deletes the next hook, which must not be called then.
+            OK(uc_hook_add(uc, &h, UC_HOOK_MEM_WRITE, test_mem_hook_many_del_cb,
+                           &del, 0x2800, 0x2800));
+            OK(uc_hook_add(uc, &del.victim, UC_HOOK_MEM_WRITE,
+                           test_mem_hook_bounded_cb, &victim, 0x2000, 0x2fff));
+        }
+    }
+    OK(uc_hook_add(uc, &h, UC_HOOK_MEM_WRITE, test_mem_hook_bounded_cb, &write,
+                   0x2800, 0x2803));
+
+    OK(uc_emu_start(uc, 0x8000, 0x8000 + sizeof(code) - 1, 0, 0));
+
+    TEST_CHECK(outside == 0);
+    TEST_CHECK(read == 1);
+    TEST_CHECK(del.calls == 1);
+    TEST_CHECK(victim == 0);
+    TEST_CHECK(write == 1);
+
+    OK(uc_close(uc));
+}
+
+static void test_mem_context_memory(void)
+{
+    uc_engine *uc;
+    uc_context *ctx;
+    // mov dword ptr [0x12000], 0x41414141; inc ecx
+    char code[] = "\xc7\x05\x00\x20\x01\x00\x41\x41\x41\x41\x41";
+    char data[0x4000];
+    char buf[0x4000];
+    int r_ecx = 0;
+
+    memset(data, 'a', sizeof(data));
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, 0x1000, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_map(uc, 0x10000, 0x4000, UC_PROT_READ | UC_PROT_WRITE));
+    OK(uc_mem_write(uc, 0x1000, code, sizeof(code) - 1));
+    OK(uc_mem_write(uc, 0x10000, data, sizeof(data)));
+
+    OK(uc_ctl_context_mode(uc, UC_CTL_CONTEXT_CPU | UC_CTL_CONTEXT_MEMORY));
+    OK(uc_context_alloc(uc, &ctx));
+    OK(uc_context_save(uc, ctx));
+
+    // Guest writes and uc_mem_write() are both rolled back.
+    for (int i = 0; i < 2; i++) {
+        OK(uc_emu_start(uc, 0x1000, 0x1000 + sizeof(code) - 1, 0, 0));
+        OK(uc_mem_write(uc, 0x10ffe, "zzzz", 4));
+        OK(uc_context_restore(uc, ctx));
+        OK(uc_mem_read(uc, 0x10000, buf, sizeof(buf)));
+        TEST_CHECK(memcmp(buf, data, sizeof(data)) == 0);
+        OK(uc_reg_read(uc, UC_X86_REG_ECX, &r_ecx));
+        TEST_CHECK(r_ecx == 0);
+    }
+
+    // The memory map is restored as well.
+    OK(uc_mem_map(uc, 0x20000, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_unmap(uc, 0x11000, 0x1000));
+    OK(uc_mem_protect(uc, 0x1000, 0x1000, UC_PROT_READ));
+    OK(uc_context_restore(uc, ctx));
+    uc_assert_err(UC_ERR_READ_UNMAPPED, uc_mem_read(uc, 0x20000, buf, 1));
+    OK(uc_mem_read(uc, 0x10000, buf, sizeof(buf)));
+    TEST_CHECK(memcmp(buf, data, sizeof(data)) == 0);
+    OK(uc_emu_start(uc, 0x1000, 0x1000 + sizeof(code) - 1, 0, 0));
+    OK(uc_mem_read(uc, 0x12000, buf, 4));
+    TEST_CHECK(memcmp(buf, "AAAA", 4) == 0);
+
+    // Back on the fast path.
+    OK(uc_context_restore(uc, ctx));
+    OK(uc_mem_read(uc, 0x12000, buf, 4));
+    TEST_CHECK(memcmp(buf, "aaaa", 4) == 0);
+
+    // The code translated from a page which is then restored is dropped.
+    OK(uc_mem_write(uc, 0x1006, "BBBB", 4));
+    OK(uc_emu_start(uc, 0x1000, 0x1000 + sizeof(code) - 1, 0, 0));
+    OK(uc_mem_read(uc, 0x12000, buf, 4));
+    TEST_CHECK(memcmp(buf, "BBBB", 4) == 0);
+    OK(uc_context_restore(uc, ctx));
+    OK(uc_emu_start(uc, 0x1000, 0x1000 + sizeof(code) - 1, 0, 0));
+    OK(uc_mem_read(uc, 0x12000, buf, 4));
+    TEST_CHECK(memcmp(buf, "AAAA", 4) == 0);
+
+    OK(uc_context_free(ctx));
+    OK(uc_close(uc));
+}
+
+static void test_mem_context_memory_engines(void)
+{
+    uc_engine *uc, *clone;
+    uc_context *ctx, *clone_ctx;
+    char buf[1];
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, 0x10000, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, 0x10000, "P", 1));
+    OK(uc_ctl_context_mode(uc, UC_CTL_CONTEXT_CPU | UC_CTL_CONTEXT_MEMORY));
+    OK(uc_context_alloc(uc, &ctx));
+    OK(uc_context_save(uc, ctx));
+
+    OK(uc_clone(uc, &clone));
+    OK(uc_ctl_context_mode(clone,
+                           UC_CTL_CONTEXT_CPU | UC_CTL_CONTEXT_MEMORY));
+    OK(uc_context_alloc(clone, &clone_ctx));
+    OK(uc_context_save(clone, clone_ctx));
+
+    // A context saved by another engine is copied in whole, into the engine
+    // it is restored to.
+    OK(uc_mem_write(uc, 0x10000, "X", 1));
+    OK(uc_mem_write(clone, 0x10000, "Y", 1));
+    OK(uc_context_restore(clone, ctx));
+    OK(uc_mem_read(clone, 0x10000, buf, 1));
+    TEST_CHECK(buf[0] == 'P');
+    OK(uc_mem_read(uc, 0x10000, buf, 1));
+    TEST_CHECK(buf[0] == 'X');
+
+    OK(uc_context_free(clone_ctx));
+    OK(uc_context_free(ctx));
+    OK(uc_close(clone));
+    OK(uc_close(uc));
+}
+
+static void test_mem_dirty_pages(void)
+{
+    uc_engine *uc;
+    // mov dword ptr [0x12000], 0x41414141
+    char code[] = "\xc7\x05\x00\x20\x01\x00\x41\x41\x41\x41";
+    uint8_t bitmap;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, 0x1000, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_map(uc, 0x10000, 0x4000, UC_PROT_READ | UC_PROT_WRITE));
+    OK(uc_mem_write(uc, 0x1000, code, sizeof(code) - 1));
+    OK(uc_mem_dirty_pages(uc, 0x1000, 0x1000, &bitmap, true));
+    TEST_CHECK(bitmap == 1);
+
+    OK(uc_emu_start(uc, 0x1000, 0x1000 + sizeof(code) - 1, 0, 0));
+    OK(uc_mem_write(uc, 0x13000, "a", 1));
+    OK(uc_mem_dirty_pages(uc, 0x10000, 0x4000, &bitmap, true));
+    TEST_CHECK(bitmap == 0xc);
+    OK(uc_mem_dirty_pages(uc, 0x10000, 0x4000, &bitmap, false));
+    TEST_CHECK(bitmap == 0);
+
+    uc_assert_err(UC_ERR_NOMEM,
+                  uc_mem_dirty_pages(uc, 0x10000, 0x5000, &bitmap, false));
+    uc_assert_err(UC_ERR_ARG,
+                  uc_mem_dirty_pages(uc, 0x10001, 0x1000, &bitmap, false));
+
+    OK(uc_close(uc));
+}
+
+static void test_mem_snapshot_file(void)
+{
+    uc_engine *uc, *uc2;
+    // inc eax; mov dword ptr [0x12000], eax
+    char code[] = "\x40\xa3\x00\x20\x01\x00";
+    const char *path = "test_mem_snapshot_file.snap";
+    uint32_t r_eax = 0x41, mem;
+    uc_mem_region *regions;
+    uint32_t count;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, 0x1000, 0x1000, UC_PROT_READ | UC_PROT_EXEC));
+    OK(uc_mem_map(uc, 0x10000, 0x4000, UC_PROT_READ | UC_PROT_WRITE));
+    OK(uc_mem_write(uc, 0x1000, code, sizeof(code) - 1));
+    OK(uc_mem_write(uc, 0x12000, &r_eax, sizeof(r_eax)));
+    OK(uc_reg_write(uc, UC_X86_REG_EAX, &r_eax));
+    OK(uc_snapshot_save(uc, path));
+    OK(uc_close(uc));
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc2));
+    OK(uc_mem_map(uc2, 0x50000, 0x1000, UC_PROT_ALL));
+    OK(uc_snapshot_load(uc2, path));
+    OK(uc_mem_regions(uc2, &regions, &count));
+    TEST_CHECK(count == 2);
+    TEST_CHECK(regions[1].begin == 0x10000 && regions[1].end == 0x13fff);
+    TEST_CHECK(regions[1].perms == (UC_PROT_READ | UC_PROT_WRITE));
+    OK(uc_free(regions));
+
+    OK(uc_emu_start(uc2, 0x1000, 0x1000 + sizeof(code) - 1, 0, 0));
+    OK(uc_reg_read(uc2, UC_X86_REG_EAX, &r_eax));
+    OK(uc_mem_read(uc2, 0x12000, &mem, sizeof(mem)));
+    TEST_CHECK(r_eax == 0x42 && mem == 0x42);
+
+    // The writes did not reach the file.
+    OK(uc_snapshot_load(uc2, path));
+    OK(uc_reg_read(uc2, UC_X86_REG_EAX, &r_eax));
+    OK(uc_mem_read(uc2, 0x12000, &mem, sizeof(mem)));
+    TEST_CHECK(r_eax == 0x41 && mem == 0x41);
+    OK(uc_mem_read(uc2, 0x10000, &mem, sizeof(mem)));
+    TEST_CHECK(mem == 0);
+
+    OK(uc_close(uc2));
+    remove(path);
+}
+
+// Copy the first @size bytes of a snapshot file, with @len bytes at @offset
+// replaced by @patch.
+static void snapshot_copy(const char *src, const char *dst, long size,
+                          long offset, const void *patch, size_t len)
+{
+    FILE *in = fopen(src, "rb"), *out = fopen(dst, "wb");
+    char *buf = malloc(size);
+
+    TEST_CHECK(in != NULL && out != NULL && buf != NULL);
+    TEST_CHECK(fread(buf, size, 1, in) == 1);
+    memcpy(buf + offset, patch, len);
+    TEST_CHECK(fwrite(buf, size, 1, out) == 1);
+    free(buf);
+    fclose(in);
+    fclose(out);
+}
+
+static void test_mem_snapshot_file_invalid(void)
+{
+    uc_engine *uc;
+    const char *path = "test_mem_snapshot_file_invalid.snap";
+    const char *bad = "test_mem_snapshot_file_invalid_bad.snap";
+    // The header is 64 bytes, followed by the 40 bytes regions. The content
+    // of the second region starts at 0x20000 and the file ends at 0x30000.
+    uint32_t region_count = 0xffffffff;
+    uint64_t bitmap_offset = 0xffffffffffff0000ULL;
+    uint32_t byte_order = 0x04030201;
+    char buf[1];
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, 0x1000, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_map(uc, 0x10000, 0x4000, UC_PROT_ALL));
+    OK(uc_snapshot_save(uc, path));
+    OK(uc_mem_unmap(uc, 0x1000, 0x1000));
+    OK(uc_mem_unmap(uc, 0x10000, 0x4000));
+    OK(uc_mem_map(uc, 0x50000, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, 0x50000, "Q", 1));
+
+    // The engine keeps its memory when the file is rejected.
+    snapshot_copy(path, bad, 0x30000, 32, &region_count, 4);
+    uc_assert_err(UC_ERR_ARG, uc_snapshot_load(uc, bad));
+    snapshot_copy(path, bad, 0x30000, 64 + 40 + 24, &bitmap_offset, 8);
+    uc_assert_err(UC_ERR_ARG, uc_snapshot_load(uc, bad));
+    // Written on a host of the other byte order.
+    snapshot_copy(path, bad, 0x30000, 40, &byte_order, 4);
+    uc_assert_err(UC_ERR_ARG, uc_snapshot_load(uc, bad));
+    snapshot_copy(path, bad, 0x21000, 0, "", 0);
+    uc_assert_err(UC_ERR_ARG, uc_snapshot_load(uc, bad));
+    OK(uc_mmio_map(uc, 0x11000, 0x1000, NULL, NULL, NULL, NULL));
+    uc_assert_err(UC_ERR_MAP, uc_snapshot_load(uc, path));
+    OK(uc_mem_read(uc, 0x50000, buf, 1));
+    TEST_CHECK(buf[0] == 'Q');
+
+    OK(uc_close(uc));
+    remove(bad);
+    remove(path);
+}
+
+static void test_mem_protect_split(void)
+{
+    uc_engine *uc;
+    // inc eax; mov dword ptr [0x180000], eax
+    char code[] = "\x40\xa3\x00\x00\x18\x00";
+    uc_mem_region *regions;
+    uint32_t count, mem, r_eax = 0x41;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, 0x100000, 0x1000000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, 0x100000, code, sizeof(code) - 1));
+    OK(uc_reg_write(uc, UC_X86_REG_EAX, &r_eax));
+    OK(uc_emu_start(uc, 0x100000, 0x100000 + sizeof(code) - 1, 0, 0));
+    OK(uc_mem_write(uc, 0x7ff000, "a", 1));
+    OK(uc_mem_write(uc, 0x801000, "b", 1));
+
+    OK(uc_mem_protect(uc, 0x180000, 0x1000, UC_PROT_READ));
+    OK(uc_mem_unmap(uc, 0x800000, 0x1000));
+
+    OK(uc_mem_regions(uc, &regions, &count));
+    TEST_CHECK(count == 4);
+    TEST_CHECK(regions[1].begin == 0x180000 && regions[1].end == 0x180fff);
+    TEST_CHECK(regions[1].perms == UC_PROT_READ);
+    TEST_CHECK(regions[2].end == 0x7fffff && regions[3].begin == 0x801000);
+    OK(uc_free(regions));
+
+    OK(uc_mem_read(uc, 0x180000, &mem, sizeof(mem)));
+    TEST_CHECK(LEINT32(mem) == 0x42);
+    OK(uc_mem_read(uc, 0x7ff000, &mem, 1));
+    TEST_CHECK((mem & 0xff) == 'a');
+    OK(uc_mem_read(uc, 0x801000, &mem, 1));
+    TEST_CHECK((mem & 0xff) == 'b');
+
+    uc_assert_err(
+        UC_ERR_WRITE_PROT,
+        uc_emu_start(uc, 0x100000, 0x100000 + sizeof(code) - 1, 0, 0));
+
+    OK(uc_close(uc));
+}
+
+static void test_mem_mapping_sparse(void)
+{
+    uc_engine *uc;
+    uint64_t addrs[] = {0x0, 0x200000, 0x7fff00000000, 0xffffffff00000000ULL};
+    uint32_t mem = 0;
+    int i;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_64, &uc));
+
+    for (i = 0; i < 4; i++) {
+        mem = (uint32_t)(addrs[i] >> 32) + i;
+        OK(uc_mem_map(uc, addrs[i], 0x3000, UC_PROT_ALL));
+        OK(uc_mem_write(uc, addrs[i] + 0x2ffc, &mem, 4));
+    }
+    OK(uc_mem_unmap(uc, 0x201000, 0x1000));
+
+    for (i = 0; i < 4; i++) {
+        OK(uc_mem_read(uc, addrs[i] + 0x2ffc, &mem, 4));
+        TEST_CHECK(mem == (uint32_t)(addrs[i] >> 32) + i);
+        uc_assert_err(UC_ERR_READ_UNMAPPED,
+                      uc_mem_read(uc, addrs[i] + 0x3000, &mem, 4));
+    }
+    uc_assert_err(UC_ERR_READ_UNMAPPED, uc_mem_read(uc, 0x201000, &mem, 4));
+    OK(uc_mem_read(uc, 0x202000, &mem, 4));
+
+    OK(uc_close(uc));
+}
+
+static void test_mem_map_transaction(void)
+{
+    uc_engine *uc;
+    // mov dword ptr [0x12000], 0x41414141
+    char code[] = "\xc7\x05\x00\x20\x01\x00\x41\x41\x41\x41";
+    uc_mem_region *regions;
+    uint32_t count, mem;
+    int i;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    uc_assert_err(UC_ERR_ARG, uc_mem_map_commit(uc));
+
+    OK(uc_mem_map_begin(uc));
+    uc_assert_err(UC_ERR_ARG, uc_mem_map_begin(uc));
+    for (i = 0; i < 64; i++) {
+        OK(uc_mem_map(uc, 0x100000 + i * 0x2000, 0x1000, UC_PROT_ALL));
+    }
+    OK(uc_mem_protect(uc, 0x100000, 0x1000, UC_PROT_READ));
+    OK(uc_mem_unmap(uc, 0x102000, 0x1000));
+    OK(uc_mem_map(uc, 0x1000, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_map(uc, 0x10000, 0x4000, UC_PROT_READ | UC_PROT_WRITE));
+    OK(uc_mem_write(uc, 0x1000, code, sizeof(code) - 1));
+    OK(uc_emu_start(uc, 0x1000, 0x1000 + sizeof(code) - 1, 0, 0));
+    OK(uc_mem_unmap(uc, 0x104000, 0x1000));
+    OK(uc_mem_map_commit(uc));
+
+    OK(uc_mem_read(uc, 0x12000, &mem, sizeof(mem)));
+    TEST_CHECK(LEINT32(mem) == 0x41414141);
+    uc_assert_err(UC_ERR_WRITE_UNMAPPED, uc_mem_write(uc, 0x104000, "a", 1));
+    OK(uc_mem_write(uc, 0x106000, "a", 1));
+
+    OK(uc_mem_regions(uc, &regions, &count));
+    TEST_CHECK(count == 64);
+    TEST_CHECK(regions[2].begin == 0x100000);
+    TEST_CHECK(regions[2].perms == UC_PROT_READ);
+    OK(uc_free(regions));
+
+    OK(uc_mem_map_begin(uc));
+    OK(uc_close(uc));
+}
+
+static void test_mem_unmap_tlb_range(void)
+{
+    uc_engine *uc;
+    // mov eax, dword ptr [0x10000]; mov dword ptr [0x20000], eax
+    char code[] = "\xa1\x00\x00\x01\x00\xa3\x00\x00\x02\x00";
+    uint32_t mem;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, 0x1000, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_map(uc, 0x10000, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_map(uc, 0x20000, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, 0x1000, code, sizeof(code) - 1));
+    OK(uc_mem_write(uc, 0x10000, "AAAA", 4));
+    OK(uc_emu_start(uc, 0x1000, 0x1000 + sizeof(code) - 1, 0, 0));
+
+    // Both pages are in the TLB now, the new mappings must replace them.
+    OK(uc_mem_unmap(uc, 0x10000, 0x1000));
+    OK(uc_mem_map(uc, 0x10000, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, 0x10000, "BBBB", 4));
+    OK(uc_emu_start(uc, 0x1000, 0x1000 + sizeof(code) - 1, 0, 0));
+    OK(uc_mem_read(uc, 0x20000, &mem, 4));
+    TEST_CHECK(memcmp(&mem, "BBBB", 4) == 0);
+
+    OK(uc_mem_protect(uc, 0x20000, 0x1000, UC_PROT_READ));
+    uc_assert_err(UC_ERR_WRITE_PROT,
+                  uc_emu_start(uc, 0x1000, 0x1000 + sizeof(code) - 1, 0, 0));
+
+    OK(uc_mem_unmap(uc, 0x20000, 0x1000));
+    uc_assert_err(UC_ERR_WRITE_UNMAPPED,
+                  uc_emu_start(uc, 0x1000, 0x1000 + sizeof(code) - 1, 0, 0));
+
+    OK(uc_close(uc));
+}
+
+#ifdef __linux__
+static void test_mem_unmap_split_release(void)
+{
+    uc_engine *uc;
+    uc_mem_span span;
+    uint32_t count = 1;
+    size_t ps = sysconf(_SC_PAGESIZE);
+    size_t size = 0x400000, i, resident = 0;
+    unsigned char *vec = calloc(size / ps, 1);
+    char *data = malloc(size);
+    char buf[1];
+
+    memset(data, 'a', size);
+    OK(uc_open(UC_ARCH_X86, UC_MODE_64, &uc));
+    OK(uc_mem_map(uc, 0x400000, size, UC_PROT_ALL));
+    OK(uc_mem_write(uc, 0x400000, data, size));
+    OK(uc_mem_get_ptr(uc, 0x400000, size, &span, &count));
+
+    // The first page keeps the host memory of the region mapped, the pages
+    // unmapped are given back all the same.
+    OK(uc_mem_unmap(uc, 0x400000 + ps, size - ps));
+    TEST_CHECK(mincore((char *)span.ptr + ps, size - ps, vec) == 0);
+    for (i = 0; i < size / ps - 1; i++) {
+        resident += vec[i] & 1;
+    }
+    TEST_CHECK(resident == 0);
+    OK(uc_mem_read(uc, 0x400000 + ps - 1, buf, 1));
+    TEST_CHECK(buf[0] == 'a');
+
+    OK(uc_close(uc));
+    free(data);
+    free(vec);
+}
+#endif
+
+static void test_mem_get_ptr(void)
+{
+    uc_engine *uc;
+    // inc eax
+    char code[] = "\x40";
+    uc_mem_span spans[2];
+    uint32_t count, eax = 0;
+    uint8_t bitmap;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, 0x1000, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_map(uc, 0x2000, 0x1000, UC_PROT_ALL));
+    OK(uc_mmio_map(uc, 0x3000, 0x1000, NULL, NULL, NULL, NULL));
+    OK(uc_mem_write(uc, 0x1ffc, "AAAABBBB", 8));
+
+    count = 2;
+    OK(uc_mem_get_ptr(uc, 0x1ffc, 8, spans, &count));
+    TEST_CHECK(count == 2);
+    TEST_CHECK(spans[0].address == 0x1ffc && spans[0].size == 4);
+    TEST_CHECK(spans[1].address == 0x2000 && spans[1].size == 4);
+    TEST_CHECK(memcmp(spans[0].ptr, "AAAA", 4) == 0);
+    TEST_CHECK(memcmp(spans[1].ptr, "BBBB", 4) == 0);
+
+    count = 1;
+    uc_assert_err(UC_ERR_ARG, uc_mem_get_ptr(uc, 0x1ffc, 8, spans, &count));
+    TEST_CHECK(count == 2);
+    count = 2;
+    uc_assert_err(UC_ERR_ARG, uc_mem_get_ptr(uc, 0x2ffc, 8, spans, &count));
+    uc_assert_err(UC_ERR_NOMEM, uc_mem_get_ptr(uc, 0x4000, 4, spans, &count));
+
+    // Code written through the pointer replaces the code translated before.
+    OK(uc_mem_write(uc, 0x1000, code, 1));
+    OK(uc_emu_start(uc, 0x1000, 0x1001, 0, 0));
+    count = 1;
+    OK(uc_mem_get_ptr(uc, 0x1000, 1, spans, &count));
+    OK(uc_mem_dirty_pages(uc, 0x1000, 0x1000, &bitmap, true));
+    memcpy(spans[0].ptr, "\x90", 1);
+    OK(uc_mem_ptr_written(uc, 0x1000, 1));
+    OK(uc_mem_dirty_pages(uc, 0x1000, 0x1000, &bitmap, false));
+    TEST_CHECK(bitmap == 1);
+    OK(uc_emu_start(uc, 0x1000, 0x1001, 0, 0));
+    OK(uc_reg_read(uc, UC_X86_REG_EAX, &eax));
+    TEST_CHECK(eax == 1);
+
+    OK(uc_close(uc));
+}
+
+static void test_mem_batch(void)
+{
+    uc_engine *uc;
+    uint64_t addresses[3] = {0x1000, 0x1ffe, 0x3000};
+    char a[4] = "AAAA", b[4] = "BBBB", c[4] = "CCCC";
+    const void *wbytes[3] = {a, b, c};
+    char ra[4], rb[4], rc[4];
+    void *rbytes[3] = {ra, rb, rc};
+    size_t sizes[3] = {4, 4, 4};
+    uc_err results[3];
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, 0x1000, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_map(uc, 0x2000, 0x1000, UC_PROT_READ));
+
+    uc_assert_err(UC_ERR_WRITE_UNMAPPED,
+                  uc_mem_write_batch(uc, addresses, wbytes, sizes, results, 3));
+    TEST_CHECK(results[0] == UC_ERR_OK);
+    TEST_CHECK(results[1] == UC_ERR_OK);
+    TEST_CHECK(results[2] == UC_ERR_WRITE_UNMAPPED);
+
+    uc_assert_err(UC_ERR_READ_UNMAPPED,
+                  uc_mem_read_batch(uc, addresses, rbytes, sizes, results, 3));
+    TEST_CHECK(results[0] == UC_ERR_OK);
+    TEST_CHECK(results[1] == UC_ERR_OK);
+    TEST_CHECK(results[2] == UC_ERR_READ_UNMAPPED);
+    TEST_CHECK(memcmp(ra, "AAAA", 4) == 0);
+    TEST_CHECK(memcmp(rb, "BBBB", 4) == 0);
+
+    OK(uc_mem_read_batch(uc, addresses, rbytes, sizes, NULL, 2));
+
+    OK(uc_close(uc));
+}
+
+static void test_mem_vmem(void)
+{
+    uc_engine *uc;
+    // mov eax, dword ptr [0x400000]; mov ebx, cr3; mov cr3, ebx
+    char code[] = "\xa1\x00\x00\x40\x00\x0f\x20\xdb\x0f\x22\xdb";
+    // 0x3000, 0x400000 and 0x401000 are present, 0x402000 is not. Unicorn
+    // maps present pages to the same physical address.
+    uint32_t pdes[2] = {0x4003, 0x2003}, pte = 0x3003;
+    uint32_t ptes[3] = {0x5003, 0x7003, 0};
+    uint32_t cr3 = 0x1000, cr0 = 0x80000001, eax = 0;
+    uint64_t paddr;
+    char buf[8];
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, 0, 0x800000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, 0x1000, pdes, sizeof(pdes)));
+    OK(uc_mem_write(uc, 0x2000, ptes, sizeof(ptes)));
+    OK(uc_mem_write(uc, 0x400c, &pte, sizeof(pte)));
+    OK(uc_mem_write(uc, 0x3000, code, sizeof(code) - 1));
+    OK(uc_mem_write(uc, 0x400000, "AAAA", 4));
+    OK(uc_reg_write(uc, UC_X86_REG_CR3, &cr3));
+    OK(uc_reg_write(uc, UC_X86_REG_CR0, &cr0));
+
+    OK(uc_vmem_translate(uc, 0x400010, &paddr));
+    TEST_CHECK(paddr == 0x400010);
+    // Physically mapped, but not present in the guest page tables.
+    uc_assert_err(UC_ERR_READ_UNMAPPED,
+                  uc_vmem_translate(uc, 0x402000, &paddr));
+    uc_assert_err(UC_ERR_READ_UNMAPPED,
+                  uc_vmem_translate(uc, 0x800000, &paddr));
+
+    OK(uc_vmem_write(uc, 0x400ffe, "ABCD", 4));
+    OK(uc_mem_read(uc, 0x400ffe, buf, 4));
+    TEST_CHECK(memcmp(buf, "ABCD", 4) == 0);
+    OK(uc_mem_write(uc, 0x401ffc, "EFGH", 4));
+    OK(uc_vmem_read(uc, 0x401ffc, buf, 4));
+    TEST_CHECK(memcmp(buf, "EFGH", 4) == 0);
+    uc_assert_err(UC_ERR_READ_UNMAPPED, uc_vmem_read(uc, 0x401ffe, buf, 4));
+    uc_assert_err(UC_ERR_WRITE_UNMAPPED,
+                  uc_vmem_write(uc, 0x401ffe, "IJKL", 4));
+
+    OK(uc_emu_start(uc, 0x3000, 0x3005, 0, 0));
+    OK(uc_reg_read(uc, UC_X86_REG_EAX, &eax));
+    TEST_CHECK(memcmp(&eax, "AAAA", 4) == 0);
+
+    // The guest access cached the translation in the TLB, which is used
+    // until the guest flushes it, just like its own accesses would.
+    ptes[0] = 0;
+    OK(uc_mem_write(uc, 0x2000, ptes, sizeof(ptes)));
+    OK(uc_vmem_translate(uc, 0x400004, &paddr));
+    TEST_CHECK(paddr == 0x400004);
+    OK(uc_emu_start(uc, 0x3005, 0x3000 + sizeof(code) - 1, 0, 0));
+    uc_assert_err(UC_ERR_READ_UNMAPPED,
+                  uc_vmem_translate(uc, 0x400004, &paddr));
+
+    OK(uc_close(uc));
+}
+
+#ifndef _WIN32
+static void test_mem_map_file(void)
+{
+    uc_engine *uc, *clone;
+    char data[0x3000];
+    char buf[4];
+    FILE *f;
+    int fd;
+
+    memset(data, 'a', sizeof(data));
+    memset(data + 0x2000, 'b', 0x1000);
+    f = tmpfile();
+    TEST_CHECK(f != NULL);
+    fd = fileno(f);
+    TEST_CHECK(write(fd, data, sizeof(data)) == sizeof(data));
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    uc_assert_err(UC_ERR_ARG,
+                  uc_mem_map_file(uc, 0x10000, 0x4000, UC_PROT_ALL, fd, 0,
+                                  false));
+    OK(uc_mem_map_file(uc, 0x10000, 0x3000, UC_PROT_ALL, fd, 0, false));
+    OK(uc_mem_map_file(uc, 0x20000, 0x3000, UC_PROT_ALL, fd, 0, true));
+    OK(uc_mem_read(uc, 0x12000, buf, 1));
+    TEST_CHECK(buf[0] == 'b');
+
+    // Private writes stay in the engine and its clones, shared ones reach the
+    // file.
+    OK(uc_mem_write(uc, 0x10000, "x", 1));
+    OK(uc_mem_write(uc, 0x21000, "y", 1));
+    TEST_CHECK(pread(fd, buf, 1, 0) == 1 && buf[0] == 'a');
+    TEST_CHECK(pread(fd, buf, 1, 0x1000) == 1 && buf[0] == 'y');
+
+    OK(uc_clone(uc, &clone));
+    OK(uc_mem_read(clone, 0x10000, buf, 1));
+    TEST_CHECK(buf[0] == 'x');
+    OK(uc_mem_read(clone, 0x11000, buf, 1));
+    TEST_CHECK(buf[0] == 'y');
+    OK(uc_mem_read(clone, 0x12000, buf, 1));
+    TEST_CHECK(buf[0] == 'b');
+
+    OK(uc_close(clone));
+    OK(uc_close(uc));
+    fclose(f);
+}
+#endif
+
+static void test_mem_clone_cow(void)
+{
+    uc_engine *uc, *clone, *clone2, *clone3;
+    // mov dword ptr [0x12000], 0x41414141
+    char code[] = "\xc7\x05\x00\x20\x01\x00\x41\x41\x41\x41";
+    char buf[4];
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, 0x1000, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, 0x1000, code, sizeof(code) - 1));
+    OK(uc_mem_map(uc, 0x10000, 0x1000000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, 0x11000, "PPPP", 4));
+
+    OK(uc_clone(uc, &clone));
+
+    // The pages are shared until written, by the host or by the guest.
+    OK(uc_mem_write(uc, 0x11000, "XXXX", 4));
+    OK(uc_emu_start(uc, 0x1000, 0x1000 + sizeof(code) - 1, 0, 0));
+    OK(uc_mem_read(clone, 0x11000, buf, 4));
+    TEST_CHECK(memcmp(buf, "PPPP", 4) == 0);
+    OK(uc_mem_read(clone, 0x12000, buf, 4));
+    TEST_CHECK(memcmp(buf, "\0\0\0\0", 4) == 0);
+
+    // A later clone gets what was written since the first one.
+    OK(uc_clone(uc, &clone2));
+    OK(uc_mem_read(clone2, 0x11000, buf, 4));
+    TEST_CHECK(memcmp(buf, "XXXX", 4) == 0);
+    OK(uc_mem_read(clone2, 0x12000, buf, 4));
+    TEST_CHECK(memcmp(buf, "AAAA", 4) == 0);
+
+    OK(uc_mem_write(clone, 0x11000, "YYYY", 4));
+    OK(uc_mem_read(uc, 0x11000, buf, 4));
+    TEST_CHECK(memcmp(buf, "XXXX", 4) == 0);
+    OK(uc_mem_read(clone2, 0x11000, buf, 4));
+    TEST_CHECK(memcmp(buf, "XXXX", 4) == 0);
+
+    // A clone of a clone.
+    OK(uc_clone(clone, &clone3));
+    OK(uc_mem_write(clone, 0x13000, "ZZZZ", 4));
+    OK(uc_mem_read(clone3, 0x11000, buf, 4));
+    TEST_CHECK(memcmp(buf, "YYYY", 4) == 0);
+    OK(uc_mem_read(clone3, 0x13000, buf, 4));
+    TEST_CHECK(memcmp(buf, "\0\0\0\0", 4) == 0);
+
+    OK(uc_close(uc));
+    OK(uc_close(clone));
+    OK(uc_mem_read(clone3, 0x11000, buf, 4));
+    TEST_CHECK(memcmp(buf, "YYYY", 4) == 0);
+    OK(uc_close(clone3));
+    OK(uc_close(clone2));
+}
+
 TEST_LIST = {{"test_map_correct", test_map_correct},
              {"test_map_wrapping", test_map_wrapping},
              {"test_mem_protect", test_mem_protect},
@@ -286,4 +1033,27 @@ TEST_LIST = {{"test_map_correct", test_map_correct},
              {"test_map_big_memory", test_map_big_memory},
              {"test_mem_protect_remove_exec", test_mem_protect_remove_exec},
              {"test_mem_protect_mmio", test_mem_protect_mmio},
+             {"test_mem_hook_bounded", test_mem_hook_bounded},
+             {"test_mem_hook_many", test_mem_hook_many},
+             {"test_mem_context_memory", test_mem_context_memory},
+             {"test_mem_context_memory_engines",
+              test_mem_context_memory_engines},
+             {"test_mem_dirty_pages", test_mem_dirty_pages},
+             {"test_mem_snapshot_file", test_mem_snapshot_file},
+             {"test_mem_snapshot_file_invalid",
+              test_mem_snapshot_file_invalid},
+             {"test_mem_mapping_sparse", test_mem_mapping_sparse},
+             {"test_mem_map_transaction", test_mem_map_transaction},
+             {"test_mem_protect_split", test_mem_protect_split},
+             {"test_mem_unmap_tlb_range", test_mem_unmap_tlb_range},
+#ifdef __linux__
+             {"test_mem_unmap_split_release", test_mem_unmap_split_release},
+#endif
+             {"test_mem_get_ptr", test_mem_get_ptr},
+             {"test_mem_batch", test_mem_batch},
+             {"test_mem_vmem", test_mem_vmem},
+#ifndef _WIN32
+             {"test_mem_map_file", test_mem_map_file},
+#endif
+             {"test_mem_clone_cow", test_mem_clone_cow},
              {NULL, NULL}};
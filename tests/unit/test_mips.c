@@ -93,6 +93,43 @@ static void test_mips_stop_at_delay_slot(void)
     OK(uc_close(uc));
 }
 
+static void test_mips_breakpoint_at_delay_slot(void)
+{
+    uc_engine *uc;
+    char code[] = "\x02\x00\x00\x10"  // beq $0, $0, 0xc
+                  "\x01\x00\x08\x25"  // addiu $t0, $t0, 1
+                  "\x10\x00\x08\x25"  // addiu $t0, $t0, 0x10
+                  "\x00\x00\x00\x00"; // nop
+    uint64_t bp = code_start + 4;
+    uint64_t hit = 0;
+    int r_pc = 0x0;
+    int r_t0 = 0x0;
+
+    uc_common_setup(&uc, UC_ARCH_MIPS, UC_MODE_32 | UC_MODE_LITTLE_ENDIAN, code,
+                    sizeof(code) - 1);
+    OK(uc_ctl_add_breakpoints(uc, &bp, 1));
+
+    // The branch isn't committed, the PC is left at it and the breakpoint
+    // hit is the delay slot.
+    uc_assert_err(UC_ERR_BREAKPOINT,
+                  uc_emu_start(uc, code_start, code_start + 16, 0, 0));
+    OK(uc_reg_read(uc, UC_MIPS_REG_PC, &r_pc));
+    TEST_CHECK(r_pc == code_start);
+    OK(uc_ctl_get_breakpoint_hit(uc, &hit));
+    TEST_CHECK(hit == bp);
+    OK(uc_reg_read(uc, UC_MIPS_REG_T0, &r_t0));
+    TEST_CHECK(r_t0 == 0);
+
+    // Resuming at the branch executes it with its delay slot.
+    OK(uc_emu_start(uc, r_pc, code_start + 16, 0, 0));
+    OK(uc_reg_read(uc, UC_MIPS_REG_PC, &r_pc));
+    TEST_CHECK(r_pc == code_start + 16);
+    OK(uc_reg_read(uc, UC_MIPS_REG_T0, &r_t0));
+    TEST_CHECK(r_t0 == 1);
+
+    OK(uc_close(uc));
+}
+
 static void test_mips_lwx_exception_issue_1314(void)
 {
     uc_engine *uc;
@@ -129,6 +166,7 @@ static void test_mips_lwx_exception_issue_1314(void)
 TEST_LIST = {
     {"test_mips_stop_at_branch", test_mips_stop_at_branch},
     {"test_mips_stop_at_delay_slot", test_mips_stop_at_delay_slot},
+    {"test_mips_breakpoint_at_delay_slot", test_mips_breakpoint_at_delay_slot},
     {"test_mips_el_ori", test_mips_el_ori},
     {"test_mips_eb_ori", test_mips_eb_ori},
     {"test_mips_lwx_exception_issue_1314", test_mips_lwx_exception_issue_1314},
@@ -105,8 +105,71 @@ static void test_ppc32_cr(void)
     OK(uc_close(uc));
 }
 
+static void test_ppc_clone(uc_mode mode)
+{
+    uc_engine *uc, *clone;
+    uint64_t reg;
+
+    // The software TLB, the timers and the IRQ inputs are pointers out of
+    // the CPU state.
+    uc_common_setup(&uc, UC_ARCH_PPC, mode | UC_MODE_BIG_ENDIAN, NULL, 0);
+    reg = 42;
+    OK(uc_reg_write(uc, UC_PPC_REG_3, &reg));
+
+    OK(uc_clone(uc, &clone));
+
+    reg = 0;
+    OK(uc_reg_read(clone, UC_PPC_REG_3, &reg));
+    TEST_CHECK((uint32_t)reg == 42);
+    reg = 1337;
+    OK(uc_reg_write(clone, UC_PPC_REG_3, &reg));
+
+    // The parent must outlive the clone and keep its own TLB.
+    OK(uc_close(clone));
+
+    reg = 0;
+    OK(uc_reg_read(uc, UC_PPC_REG_3, &reg));
+    TEST_CHECK((uint32_t)reg == 42);
+
+    OK(uc_close(uc));
+}
+
+static void test_ppc32_clone(void) { test_ppc_clone(UC_MODE_32); }
+
+static void test_ppc64_clone(void) { test_ppc_clone(UC_MODE_PPC64); }
+
+static void test_ppc32_snapshot(void)
+{
+    uc_engine *uc, *uc2;
+    char code[] = "\x7f\x46\x1a\x14"; // ADD 26, 6, 3
+    const char *path = "test_ppc32_snapshot.snap";
+    int reg;
+
+    uc_common_setup(&uc, UC_ARCH_PPC, UC_MODE_32 | UC_MODE_BIG_ENDIAN, code,
+                    sizeof(code) - 1);
+    reg = 42;
+    OK(uc_reg_write(uc, UC_PPC_REG_3, &reg));
+    reg = 1337;
+    OK(uc_reg_write(uc, UC_PPC_REG_6, &reg));
+    OK(uc_snapshot_save(uc, path));
+
+    OK(uc_open(UC_ARCH_PPC, UC_MODE_32 | UC_MODE_BIG_ENDIAN, &uc2));
+    OK(uc_snapshot_load(uc2, path));
+    OK(uc_close(uc));
+
+    OK(uc_emu_start(uc2, code_start, code_start + sizeof(code) - 1, 0, 0));
+    OK(uc_reg_read(uc2, UC_PPC_REG_26, &reg));
+    TEST_CHECK(reg == 1379);
+
+    OK(uc_close(uc2));
+    remove(path);
+}
+
 TEST_LIST = {{"test_ppc32_add", test_ppc32_add},
              {"test_ppc32_fadd", test_ppc32_fadd},
              {"test_ppc32_sc", test_ppc32_sc},
              {"test_ppc32_cr", test_ppc32_cr},
+             {"test_ppc32_clone", test_ppc32_clone},
+             {"test_ppc64_clone", test_ppc64_clone},
+             {"test_ppc32_snapshot", test_ppc32_snapshot},
              {NULL, NULL}};
\ No newline at end of file
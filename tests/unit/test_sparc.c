@@ -1,6 +1,28 @@
 #include "unicorn_test.h"
 
-const uint64_t code_start = 0x1000;
+const uint64_t code_start = 0x10000;
 const uint64_t code_len = 0x4000;
 
-TEST_LIST = {{NULL, NULL}};
\ No newline at end of file
+static void test_sparc64_snapshot(void)
+{
+    uc_engine *uc, *uc2;
+    const char *path = "test_sparc64_snapshot.snap";
+    char buf[4];
+
+    // Contexts hold no CPU state on SPARC64, the snapshot is only memory.
+    OK(uc_open(UC_ARCH_SPARC, UC_MODE_SPARC64 | UC_MODE_BIG_ENDIAN, &uc));
+    OK(uc_mem_map(uc, code_start, code_len, UC_PROT_ALL));
+    OK(uc_mem_write(uc, code_start, "\x01\x00\x00\x00", 4)); // nop
+    OK(uc_snapshot_save(uc, path));
+    OK(uc_close(uc));
+
+    OK(uc_open(UC_ARCH_SPARC, UC_MODE_SPARC64 | UC_MODE_BIG_ENDIAN, &uc2));
+    OK(uc_snapshot_load(uc2, path));
+    OK(uc_mem_read(uc2, code_start, buf, sizeof(buf)));
+    TEST_CHECK(memcmp(buf, "\x01\x00\x00\x00", 4) == 0);
+
+    OK(uc_close(uc2));
+    remove(path);
+}
+
+TEST_LIST = {{"test_sparc64_snapshot", test_sparc64_snapshot}, {NULL, NULL}};
\ No newline at end of file
@@ -336,6 +336,43 @@ static void test_x86_reg_save(void)
     OK(uc_close(uc));
 }
 
+static void test_x86_context_restore_dr7_cb(uc_engine *uc, uint32_t intno,
+                                            void *user_data)
+{
+    *(uint32_t *)user_data = intno;
+    uc_emu_stop(uc);
+}
+
+static void test_x86_context_restore_dr7(void)
+{
+    uc_engine *uc, *uc2;
+    uc_context *ctx;
+    uc_hook h;
+    // mov eax, 0x1010; mov dr0, eax; mov eax, 1; mov dr7, eax; inc ebx
+    char code[] = "\xb8\x10\x10\x00\x00\x0f\x23\xc0\xb8\x01\x00\x00\x00"
+                  "\x0f\x23\xf8\x43";
+    uint32_t intno = 0;
+
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code, sizeof(code) - 1);
+    OK(uc_emu_start(uc, code_start, code_start + 0x10, 0, 0));
+    OK(uc_context_alloc(uc, &ctx));
+    OK(uc_context_save(uc, ctx));
+
+    // The breakpoint of dr0 belongs to the engine restoring the context.
+    uc_common_setup(&uc2, UC_ARCH_X86, UC_MODE_32, code, sizeof(code) - 1);
+    OK(uc_hook_add(uc2, &h, UC_HOOK_INTR, test_x86_context_restore_dr7_cb,
+                   &intno, 1, 0));
+    OK(uc_context_restore(uc2, ctx));
+    OK(uc_close(uc));
+
+    OK(uc_emu_start(uc2, code_start + 0x10, code_start + sizeof(code) - 1, 0,
+                    0));
+    TEST_CHECK(intno == 1);
+
+    OK(uc_context_free(ctx));
+    OK(uc_close(uc2));
+}
+
 static bool
 test_x86_invalid_mem_read_stop_in_cb_callback(uc_engine *uc, uc_mem_type type,
                                               uint64_t address, int size,
@@ -719,6 +756,207 @@ static void test_x86_clear_count_cache(void)
     OK(uc_close(uc));
 }
 
+static void test_x86_insn_count_cb(uc_engine *uc, uint64_t address,
+                                   uint32_t size, void *user_data)
+{
+    (*(int *)user_data)++;
+}
+
+static void test_x86_insn_count(void)
+{
+    uc_engine *uc;
+    char code[] = "\x41\x41\x41\x41\x41"; // INC ecx; INC ecx; INC ecx;
+                                         // INC ecx; INC ecx
+    int r_ecx = 0;
+    int r_eip;
+    int hooked = 0;
+    size_t retired;
+    uc_hook h;
+
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code, sizeof(code) - 1);
+    OK(uc_hook_add(uc, &h, UC_HOOK_CODE, test_x86_insn_count_cb, &hooked, 1,
+                   0));
+
+    // The budget ends in the middle of the block.
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 3));
+
+    OK(uc_reg_read(uc, UC_X86_REG_ECX, &r_ecx));
+    OK(uc_reg_read(uc, UC_X86_REG_EIP, &r_eip));
+    OK(uc_query(uc, UC_QUERY_INSN_COUNT, &retired));
+
+    TEST_CHECK(r_ecx == 3);
+    TEST_CHECK(r_eip == code_start + 3);
+    TEST_CHECK(hooked == 3);
+    TEST_CHECK(retired == 3);
+
+    OK(uc_close(uc));
+}
+
+static void test_x86_insn_count_refill(void)
+{
+    uc_engine *uc;
+    // mov ecx, 0x20000;
+    // lb:
+    //   dec ecx;
+    //   jnz lb;
+    char code[] = "\xb9\x00\x00\x02\x00\x49\x75\xfd";
+    int r_ecx;
+    size_t retired;
+
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code, sizeof(code) - 1);
+
+    // Larger than what the decrementer holds at once.
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0,
+                    1 + 2 * 50000));
+
+    OK(uc_reg_read(uc, UC_X86_REG_ECX, &r_ecx));
+    OK(uc_query(uc, UC_QUERY_INSN_COUNT, &retired));
+
+    TEST_CHECK(r_ecx == 0x20000 - 50000);
+    TEST_CHECK(retired == 1 + 2 * 50000);
+
+    OK(uc_close(uc));
+}
+
+static void test_x86_insn_count_stop_cb(uc_engine *uc, uint64_t address,
+                                        uint32_t size, void *user_data)
+{
+    if (address == code_start + 2) {
+        OK(uc_emu_stop(uc));
+    }
+}
+
+static void test_x86_insn_count_stop(void)
+{
+    uc_engine *uc;
+    char code[] = "\x41\x41\x41\x41\x41"; // INC ecx; INC ecx; INC ecx;
+                                         // INC ecx; INC ecx
+    // INC ecx; INC ecx; mov eax, [0x200000]; INC ecx
+    char code_read[] = "\x41\x41\xa1\x00\x00\x20\x00\x41";
+    // INC ecx; INC ecx; mov [0x200000], eax; INC ecx
+    char code_write[] = "\x41\x41\xa3\x00\x00\x20\x00\x41";
+    int r_ecx;
+    size_t retired;
+    uc_hook h;
+
+    // Stopped by a hook in the middle of the block, the rest of it doesn't
+    // count.
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code, sizeof(code) - 1);
+    OK(uc_hook_add(uc, &h, UC_HOOK_CODE, test_x86_insn_count_stop_cb, NULL, 1,
+                   0));
+
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 100));
+
+    OK(uc_reg_read(uc, UC_X86_REG_ECX, &r_ecx));
+    OK(uc_query(uc, UC_QUERY_INSN_COUNT, &retired));
+
+    TEST_CHECK(r_ecx == 2);
+    TEST_CHECK(retired == 2);
+
+    OK(uc_close(uc));
+
+    // Stopped by an invalid memory access.
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code_read,
+                    sizeof(code_read) - 1);
+
+    uc_assert_err(UC_ERR_READ_UNMAPPED,
+                  uc_emu_start(uc, code_start,
+                               code_start + sizeof(code_read) - 1, 0, 100));
+
+    OK(uc_query(uc, UC_QUERY_INSN_COUNT, &retired));
+
+    TEST_CHECK(retired == 2);
+
+    OK(uc_close(uc));
+
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code_write,
+                    sizeof(code_write) - 1);
+
+    uc_assert_err(UC_ERR_WRITE_UNMAPPED,
+                  uc_emu_start(uc, code_start,
+                               code_start + sizeof(code_write) - 1, 0, 100));
+
+    OK(uc_query(uc, UC_QUERY_INSN_COUNT, &retired));
+
+    TEST_CHECK(retired == 2);
+
+    OK(uc_close(uc));
+}
+
+static void test_x86_insn_count_tb_cb(uc_engine *uc, uc_tb *cur_tb,
+                                      uc_tb *prev_tb, void *user_data)
+{
+    (*(int *)user_data)++;
+}
+
+static void test_x86_insn_count_no_flush(void)
+{
+    uc_engine *uc;
+    uc_hook h;
+    // inc ecx;
+    // jmp 3;
+    // inc edx;
+    // jmp 7;
+    // nop;
+    char code[] = "\x41\xeb\x00\x42\xeb\x01\x90";
+    int generated = 0;
+    int before;
+    int r_ecx, r_edx;
+
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code, sizeof(code) - 1);
+    // The block at the exit address is thrown away after every run, leave it
+    // out.
+    OK(uc_hook_add(uc, &h, UC_HOOK_EDGE_GENERATED, test_x86_insn_count_tb_cb,
+                   &generated, code_start, code_start + 6));
+
+    // Translate both the counted and the uncounted variants once.
+    OK(uc_emu_start(uc, code_start, code_start + 7, 0, 100));
+    OK(uc_emu_start(uc, code_start, code_start + 7, 0, 0));
+    before = generated;
+
+    // Switching modes must reuse the blocks already translated.
+    OK(uc_emu_start(uc, code_start, code_start + 7, 0, 100));
+    OK(uc_emu_start(uc, code_start, code_start + 7, 0, 0));
+    OK(uc_emu_start(uc, code_start, code_start + 7, 0, 2));
+
+    OK(uc_reg_read(uc, UC_X86_REG_ECX, &r_ecx));
+    OK(uc_reg_read(uc, UC_X86_REG_EDX, &r_edx));
+
+    TEST_CHECK(generated == before);
+    TEST_CHECK(r_ecx == 5);
+    TEST_CHECK(r_edx == 4);
+
+    OK(uc_close(uc));
+}
+
+static void test_x86_timeout(void)
+{
+    uc_engine *uc;
+    // inc ecx;
+    // lb:
+    //   jmp lb;
+    char code[] = "\x41\xeb\xfe";
+    size_t timed_out;
+    int r_ecx;
+
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code, sizeof(code) - 1);
+
+    // Stops well before the timeout.
+    OK(uc_emu_start(uc, code_start, code_start + 1, 1000 * 1000, 0));
+    OK(uc_query(uc, UC_QUERY_TIMEOUT, &timed_out));
+    TEST_CHECK(timed_out == 0);
+
+    // Loops until the timeout, 10ms.
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 10 * 1000,
+                    0));
+    OK(uc_query(uc, UC_QUERY_TIMEOUT, &timed_out));
+    OK(uc_reg_read(uc, UC_X86_REG_ECX, &r_ecx));
+    TEST_CHECK(timed_out == 1);
+    TEST_CHECK(r_ecx == 2);
+
+    OK(uc_close(uc));
+}
+
 // This is a regression bug.
 static void test_x86_clear_empty_tb(void)
 {
@@ -826,6 +1064,98 @@ static void test_x86_hook_tcg_op(void)
     OK(uc_close(uc));
 }
 
+typedef struct _CMPLOG_RESULTS {
+    uc_cmplog_entry entries[8];
+    size_t len;
+    int drains;
+} CMPLOG_RESULTS;
+
+static void test_x86_cmplog_cb(uc_engine *uc, const uc_cmplog_entry *entries,
+                               size_t count, void *data)
+{
+    CMPLOG_RESULTS *results = (CMPLOG_RESULTS *)data;
+
+    memcpy(&results->entries[results->len], entries,
+           count * sizeof(uc_cmplog_entry));
+    results->len += count;
+    results->drains++;
+}
+
+static void test_x86_cmplog(void)
+{
+    uc_engine *uc;
+    uc_cmplog_entry buffer[3];
+    CMPLOG_RESULTS results;
+    // cmp eax, 0x1234; sub ebx, ecx; test dl, 0x80; cmp al, 0x34
+    char code[] = "\x3d\x34\x12\x00\x00\x29\xcb\xf6\xc2\x80\x3c\x34";
+    int r_eax = 0x1234;
+    int r_ebx = 5;
+    int r_ecx = 2;
+    int r_edx = 0x81;
+
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code, sizeof(code) - 1);
+    OK(uc_reg_write(uc, UC_X86_REG_EAX, &r_eax));
+    OK(uc_reg_write(uc, UC_X86_REG_EBX, &r_ebx));
+    OK(uc_reg_write(uc, UC_X86_REG_ECX, &r_ecx));
+    OK(uc_reg_write(uc, UC_X86_REG_EDX, &r_edx));
+
+    memset(&results, 0, sizeof(CMPLOG_RESULTS));
+    uc_assert_err(UC_ERR_ARG, uc_ctl_set_cmplog(uc, buffer, 3, NULL, NULL));
+    OK(uc_ctl_set_cmplog(uc, buffer, 3, test_x86_cmplog_cb, &results));
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 0));
+
+    // Drained once full and once more when the emulation stops.
+    TEST_CHECK(results.drains == 2);
+    TEST_CHECK(results.len == 4);
+    TEST_CHECK(results.entries[0].address == code_start);
+    TEST_CHECK(results.entries[0].type == UC_CMPLOG_SUB);
+    TEST_CHECK(results.entries[0].arg1 == 0x1234);
+    TEST_CHECK(results.entries[0].arg2 == 0x1234);
+    TEST_CHECK(results.entries[0].size == 32);
+    TEST_CHECK(results.entries[1].address == code_start + 5);
+    TEST_CHECK(results.entries[1].arg1 == 5);
+    TEST_CHECK(results.entries[1].arg2 == 2);
+    TEST_CHECK(results.entries[2].type == UC_CMPLOG_AND);
+    TEST_CHECK(results.entries[2].arg1 == 0x81);
+    TEST_CHECK(results.entries[2].arg2 == 0x80);
+    TEST_CHECK(results.entries[2].size == 8);
+    TEST_CHECK(results.entries[3].address == code_start + 10);
+    TEST_CHECK(results.entries[3].arg1 == 0x34);
+    TEST_CHECK(results.entries[3].arg2 == 0x34);
+    TEST_CHECK(results.entries[3].size == 8);
+
+    OK(uc_ctl_set_cmplog(uc, NULL, 0, NULL, NULL));
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 0));
+    TEST_CHECK(results.len == 4);
+
+    OK(uc_close(uc));
+}
+
+static void test_x86_cmplog_single(void)
+{
+    uc_engine *uc;
+    // The second entry checks that nothing is written past the buffer.
+    uc_cmplog_entry buffer[2], guard;
+    CMPLOG_RESULTS results;
+    // cmp eax, 0x1234; sub ebx, ecx; test dl, 0x80; cmp al, 0x34
+    char code[] = "\x3d\x34\x12\x00\x00\x29\xcb\xf6\xc2\x80\x3c\x34";
+
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code, sizeof(code) - 1);
+    memset(&buffer[1], 0xcc, sizeof(buffer[1]));
+    memcpy(&guard, &buffer[1], sizeof(guard));
+
+    memset(&results, 0, sizeof(CMPLOG_RESULTS));
+    OK(uc_ctl_set_cmplog(uc, buffer, 1, test_x86_cmplog_cb, &results));
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 0));
+
+    TEST_CHECK(results.len == 4);
+    TEST_CHECK(results.entries[1].address == code_start + 5);
+    TEST_CHECK(results.entries[3].address == code_start + 10);
+    TEST_CHECK(memcmp(&buffer[1], &guard, sizeof(guard)) == 0);
+
+    OK(uc_close(uc));
+}
+
 static bool test_x86_cmpxchg_mem_hook(uc_engine *uc, uc_mem_type type,
                                       uint64_t address, int size, int64_t val,
                                       void *data)
@@ -839,6 +1169,162 @@ static bool test_x86_cmpxchg_mem_hook(uc_engine *uc, uc_mem_type type,
     return true;
 }
 
+static void test_x86_reset_hook(uc_engine *uc, uint64_t addr, uint32_t size,
+                                void *user_data)
+{
+    (*(int *)user_data)++;
+}
+
+static void test_x86_reset(void)
+{
+    uc_engine *uc;
+    char code[] = "\x41\x41"; // inc ecx; inc ecx
+    char code2[] = "\x49";     // dec ecx
+    int r_ecx = 0;
+    int count = 0;
+    char buf[1];
+    uc_hook h;
+
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code, sizeof(code) - 1);
+    OK(uc_hook_add(uc, &h, UC_HOOK_CODE, test_x86_reset_hook, &count, 1, 0));
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 0));
+    OK(uc_reg_read(uc, UC_X86_REG_ECX, &r_ecx));
+    TEST_CHECK(r_ecx == 2);
+    TEST_CHECK(count == 2);
+
+    OK(uc_reset(uc, false));
+    uc_assert_err(UC_ERR_READ_UNMAPPED, uc_mem_read(uc, code_start, buf, 1));
+    OK(uc_reg_read(uc, UC_X86_REG_ECX, &r_ecx));
+    TEST_CHECK(r_ecx == 0);
+
+    for (int i = 0; i < 2; i++) {
+        OK(uc_mem_map(uc, code_start, code_len, UC_PROT_ALL));
+        OK(uc_mem_write(uc, code_start, code2, sizeof(code2) - 1));
+        OK(uc_emu_start(uc, code_start, code_start + sizeof(code2) - 1, 0, 0));
+        OK(uc_reg_read(uc, UC_X86_REG_ECX, &r_ecx));
+        TEST_CHECK(r_ecx == -1);
+        // The hook is gone.
+        TEST_CHECK(count == 2);
+        OK(uc_reset(uc, true));
+    }
+
+    OK(uc_close(uc));
+}
+
+static void test_x86_context_regs(void)
+{
+    uc_engine *uc;
+    uc_context *ctx;
+    uint64_t r_rax = 1, r_rip = 0x1000;
+    uint64_t r_xmm0[2] = {1, 2};
+    int regs;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_64, &uc));
+    OK(uc_ctl_context_regs(uc, UC_CTL_CONTEXT_REGS_GPR));
+    OK(uc_ctl_get_context_regs(uc, &regs));
+    TEST_CHECK(regs == UC_CTL_CONTEXT_REGS_GPR);
+    uc_assert_err(UC_ERR_ARG, uc_ctl_context_regs(uc, 0));
+    OK(uc_context_alloc(uc, &ctx));
+
+    OK(uc_reg_write(uc, UC_X86_REG_RAX, &r_rax));
+    OK(uc_reg_write(uc, UC_X86_REG_RIP, &r_rip));
+    OK(uc_reg_write(uc, UC_X86_REG_XMM0, &r_xmm0));
+    OK(uc_context_save(uc, ctx));
+    OK(uc_context_reg_read(ctx, UC_X86_REG_RAX, &r_rax));
+    TEST_CHECK(r_rax == 1);
+
+    r_rax = 2;
+    r_rip = 0x2000;
+    r_xmm0[0] = 3;
+    OK(uc_reg_write(uc, UC_X86_REG_RAX, &r_rax));
+    OK(uc_reg_write(uc, UC_X86_REG_RIP, &r_rip));
+    OK(uc_reg_write(uc, UC_X86_REG_XMM0, &r_xmm0));
+
+    // The vector registers are left alone.
+    OK(uc_context_restore(uc, ctx));
+    OK(uc_reg_read(uc, UC_X86_REG_RAX, &r_rax));
+    OK(uc_reg_read(uc, UC_X86_REG_RIP, &r_rip));
+    OK(uc_reg_read(uc, UC_X86_REG_XMM0, &r_xmm0));
+    TEST_CHECK(r_rax == 1 && r_rip == 0x1000);
+    TEST_CHECK(r_xmm0[0] == 3 && r_xmm0[1] == 2);
+
+    OK(uc_context_free(ctx));
+    OK(uc_close(uc));
+}
+
+static void test_x86_context_regs_debug(void)
+{
+    uc_engine *uc;
+    uc_context *clear, *bp, *sys;
+    uint64_t r_dr0 = 0x5000, r_dr7 = 0x401;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_64, &uc));
+    OK(uc_context_alloc(uc, &clear));
+    OK(uc_context_alloc(uc, &bp));
+    OK(uc_context_save(uc, clear));
+
+    // Restoring the whole state inserts the breakpoint of dr0 from dr7.
+    OK(uc_reg_write(uc, UC_X86_REG_DR0, &r_dr0));
+    OK(uc_reg_write(uc, UC_X86_REG_DR7, &r_dr7));
+    OK(uc_context_save(uc, bp));
+    OK(uc_context_restore(uc, bp));
+
+    OK(uc_ctl_context_regs(uc, UC_CTL_CONTEXT_REGS_SYSTEM));
+    OK(uc_context_alloc(uc, &sys));
+    OK(uc_context_save(uc, sys));
+
+    // The breakpoint is removed, restoring the system registers must not
+    // bring back dr7 and the pointer of the breakpoint.
+    OK(uc_context_restore(uc, clear));
+    OK(uc_context_restore(uc, sys));
+    OK(uc_reg_read(uc, UC_X86_REG_DR7, &r_dr7));
+    TEST_CHECK((r_dr7 & 0xff) == 0);
+    OK(uc_context_restore(uc, clear));
+
+    OK(uc_context_free(sys));
+    OK(uc_context_free(bp));
+    OK(uc_context_free(clear));
+    OK(uc_close(uc));
+}
+
+static void test_x86_clone(void)
+{
+    uc_engine *uc, *clone;
+    // inc ecx; mov dword ptr [0x12000], ecx
+    char code[] = "\x41\x89\x0d\x00\x20\x01\x00";
+    int r_ecx = 5;
+    int count = 0;
+    uint32_t mem;
+    uc_hook h;
+
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code, sizeof(code) - 1);
+    OK(uc_mem_map(uc, 0x10000, 0x4000, UC_PROT_READ | UC_PROT_WRITE));
+    OK(uc_hook_add(uc, &h, UC_HOOK_CODE, test_x86_reset_hook, &count, 1, 0));
+    OK(uc_reg_write(uc, UC_X86_REG_ECX, &r_ecx));
+
+    OK(uc_clone(uc, &clone));
+    OK(uc_emu_start(clone, code_start, code_start + sizeof(code) - 1, 0, 0));
+    OK(uc_reg_read(clone, UC_X86_REG_ECX, &r_ecx));
+    TEST_CHECK(r_ecx == 6);
+    OK(uc_mem_read(clone, 0x12000, &mem, sizeof(mem)));
+    TEST_CHECK(mem == 6);
+    TEST_CHECK(count == 2);
+
+    // The parent is left untouched.
+    OK(uc_reg_read(uc, UC_X86_REG_ECX, &r_ecx));
+    TEST_CHECK(r_ecx == 5);
+    OK(uc_mem_read(uc, 0x12000, &mem, sizeof(mem)));
+    TEST_CHECK(mem == 0);
+
+    OK(uc_close(clone));
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 0));
+    OK(uc_mem_read(uc, 0x12000, &mem, sizeof(mem)));
+    TEST_CHECK(mem == 6);
+    TEST_CHECK(count == 4);
+
+    OK(uc_close(uc));
+}
+
 static void test_x86_cmpxchg(void)
 {
     uc_engine *uc;
@@ -1229,6 +1715,115 @@ static void test_x86_lazy_mapping(void)
     OK(uc_close(uc));
 }
 
+static void test_x86_hook_code_bounded_cb(uc_engine *uc, uint64_t address,
+                                          uint32_t size, void *user_data)
+{
+    (*(int *)user_data)++;
+}
+
+static void test_x86_hook_code_bounded(void)
+{
+    uc_engine *uc;
+    // inc ecx; inc ecx; inc edx
+    char code[] = "\x41\x41\x42";
+    uc_hook h;
+    int bounded[3] = {0};
+    int unbounded[10] = {0};
+    int i;
+
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code, sizeof(code) - 1);
+    for (i = 0; i < 3; i++) {
+        OK(uc_hook_add(uc, &h, UC_HOOK_CODE, test_x86_hook_code_bounded_cb,
+                       &bounded[i], code_start + i, code_start + i));
+    }
+    // More hooks than can be called directly on every instruction.
+    for (i = 0; i < 10; i++) {
+        OK(uc_hook_add(uc, &h, UC_HOOK_CODE, test_x86_hook_code_bounded_cb,
+                       &unbounded[i], 1, 0));
+    }
+
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 0));
+
+    for (i = 0; i < 3; i++) {
+        TEST_CHECK(bounded[i] == 1);
+    }
+    for (i = 0; i < 10; i++) {
+        TEST_CHECK(unbounded[i] == 3);
+    }
+
+    OK(uc_close(uc));
+}
+
+static void test_x86_hook_code_stop_cb(uc_engine *uc, uint64_t address,
+                                       uint32_t size, void *user_data)
+{
+    OK(uc_emu_stop(uc));
+}
+
+static void test_x86_hook_code_stop(void)
+{
+    uc_engine *uc;
+    // inc ecx; inc ecx; inc edx
+    char code[] = "\x41\x41\x42";
+    uc_hook h;
+    int before = 0, after = 0;
+    uint32_t r_ecx;
+
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code, sizeof(code) - 1);
+    OK(uc_hook_add(uc, &h, UC_HOOK_CODE, test_x86_hook_code_bounded_cb,
+                   &before, code_start, code_start + 1));
+    OK(uc_hook_add(uc, &h, UC_HOOK_CODE, test_x86_hook_code_stop_cb, NULL,
+                   code_start + 1, code_start + 1));
+    OK(uc_hook_add(uc, &h, UC_HOOK_CODE, test_x86_hook_code_bounded_cb,
+                   &after, code_start, code_start + 1));
+
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 0));
+    OK(uc_reg_read(uc, UC_X86_REG_ECX, &r_ecx));
+
+    // The hooks after the one stopping the emulation are not called.
+    TEST_CHECK(before == 2);
+    TEST_CHECK(after == 1);
+    TEST_CHECK(r_ecx == 1);
+
+    OK(uc_close(uc));
+}
+
+static void test_x86_hook_code_many(void)
+{
+    uc_engine *uc;
+    // inc ecx; inc ecx; inc edx
+    char code[] = "\x41\x41\x42";
+    uc_hook h, deleted;
+    int outside = 0, wide = 0, narrow = 0, removed = 0;
+    int i;
+
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code, sizeof(code) - 1);
+    for (i = 0; i < 1000; i++) {
+        OK(uc_hook_add(uc, &h, UC_HOOK_CODE, test_x86_hook_code_bounded_cb,
+                       &outside, 0x100000 + i * 0x10,
+                       0x100000 + i * 0x10 + 0xf));
+        if (i == 500) {
+            OK(uc_hook_add(uc, &deleted, UC_HOOK_CODE,
+                           test_x86_hook_code_bounded_cb, &removed, code_start,
+                           code_start + 2));
+            OK(uc_hook_add(uc, &h, UC_HOOK_CODE, test_x86_hook_code_bounded_cb,
+                           &wide, code_start - 0x100, code_start + 1));
+        }
+    }
+    OK(uc_hook_add(uc, &h, UC_HOOK_CODE, test_x86_hook_code_bounded_cb,
+                   &narrow, code_start + 2, code_start + 2));
+    OK(uc_hook_del(uc, deleted));
+
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 0));
+
+    TEST_CHECK(outside == 0);
+    TEST_CHECK(removed == 0);
+    TEST_CHECK(wide == 2);
+    TEST_CHECK(narrow == 1);
+
+    OK(uc_close(uc));
+}
+
 TEST_LIST = {
     {"test_x86_in", test_x86_in},
     {"test_x86_out", test_x86_out},
@@ -1242,6 +1837,7 @@ TEST_LIST = {
     {"test_x86_64_syscall", test_x86_64_syscall},
     {"test_x86_16_add", test_x86_16_add},
     {"test_x86_reg_save", test_x86_reg_save},
+    {"test_x86_context_restore_dr7", test_x86_context_restore_dr7},
     {"test_x86_invalid_mem_read_stop_in_cb",
      test_x86_invalid_mem_read_stop_in_cb},
     {"test_x86_x87_fnstenv", test_x86_x87_fnstenv},
@@ -1255,6 +1851,12 @@ TEST_LIST = {
     {"test_x86_clear_tb_cache", test_x86_clear_tb_cache},
     {"test_x86_clear_empty_tb", test_x86_clear_empty_tb},
     {"test_x86_hook_tcg_op", test_x86_hook_tcg_op},
+    {"test_x86_cmplog", test_x86_cmplog},
+    {"test_x86_cmplog_single", test_x86_cmplog_single},
+    {"test_x86_reset", test_x86_reset},
+    {"test_x86_context_regs", test_x86_context_regs},
+    {"test_x86_context_regs_debug", test_x86_context_regs_debug},
+    {"test_x86_clone", test_x86_clone},
     {"test_x86_cmpxchg", test_x86_cmpxchg},
     {"test_x86_nested_emu_start", test_x86_nested_emu_start},
     {"test_x86_nested_emu_stop", test_x86_nested_emu_stop},
@@ -1262,6 +1864,11 @@ TEST_LIST = {
     {"test_x86_eflags_reserved_bit", test_x86_eflags_reserved_bit},
     {"test_x86_nested_uc_emu_start_exits", test_x86_nested_uc_emu_start_exits},
     {"test_x86_clear_count_cache", test_x86_clear_count_cache},
+    {"test_x86_insn_count", test_x86_insn_count},
+    {"test_x86_insn_count_refill", test_x86_insn_count_refill},
+    {"test_x86_insn_count_stop", test_x86_insn_count_stop},
+    {"test_x86_insn_count_no_flush", test_x86_insn_count_no_flush},
+    {"test_x86_timeout", test_x86_timeout},
     {"test_x86_correct_address_in_small_jump_hook",
      test_x86_correct_address_in_small_jump_hook},
     {"test_x86_correct_address_in_long_jump_hook",
@@ -1271,4 +1878,7 @@ TEST_LIST = {
     {"test_x86_unaligned_access", test_x86_unaligned_access},
 #endif
     {"test_x86_lazy_mapping", test_x86_lazy_mapping},
+    {"test_x86_hook_code_bounded", test_x86_hook_code_bounded},
+    {"test_x86_hook_code_stop", test_x86_hook_code_stop},
+    {"test_x86_hook_code_many", test_x86_hook_code_many},
     {NULL, NULL}};
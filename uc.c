@@ -13,6 +13,15 @@
 
 #include <time.h> // nanosleep
 #include <string.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 #include "uc_priv.h"
 
@@ -31,6 +40,8 @@
 #include "qemu-common.h"
 
 static void clear_deleted_hooks(uc_engine *uc);
+static uc_err context_save_cpu(uc_engine *uc, uc_context *context);
+static uc_err context_restore_cpu(uc_engine *uc, uc_context *context);
 
 static void *hook_insert(struct list *l, struct hook *h)
 {
@@ -136,6 +147,8 @@ const char *uc_strerror(uc_err code)
         return "Insufficient resource (UC_ERR_RESOURCE)";
     case UC_ERR_EXCEPTION:
         return "Unhandled CPU exception (UC_ERR_EXCEPTION)";
+    case UC_ERR_BREAKPOINT:
+        return "Emulation stopped at a breakpoint (UC_ERR_BREAKPOINT)";
     }
 }
 
@@ -211,6 +224,27 @@ static gint uc_exits_cmp(gconstpointer a, gconstpointer b, gpointer user_data)
     }
 }
 
+static guint uc_breakpoints_hash(gconstpointer p)
+{
+    return qemu_xxhash2(*(uint64_t *)p);
+}
+
+static gboolean uc_breakpoints_equal(gconstpointer lhs, gconstpointer rhs)
+{
+    return *(uint64_t *)lhs == *(uint64_t *)rhs;
+}
+
+// Drop the TBs which contain addr, and those which end right before it with
+// the code stopping the emulation there (see uc_exit_invalidate_iter).
+static void uc_breakpoint_invalidate(uc_engine *uc, uint64_t addr)
+{
+    if (addr == 0) {
+        uc->uc_invalidate_tb(uc, addr, 1);
+    } else {
+        uc->uc_invalidate_tb(uc, addr - 1, 2);
+    }
+}
+
 static uc_err uc_init(uc_engine *uc)
 {
 
@@ -225,7 +259,11 @@ static uc_err uc_init(uc_engine *uc)
     }
 
     uc->ctl_exits = g_tree_new_full(uc_exits_cmp, NULL, g_free, NULL);
+    uc->breakpoints = g_hash_table_new_full(uc_breakpoints_hash,
+                                            uc_breakpoints_equal, g_free, NULL);
 
+    // The arch may replace the default model with an index of its own.
+    uc->cpu_model_ctl = uc->cpu_model;
     if (machine_initialize(uc)) {
         return UC_ERR_RESOURCE;
     }
@@ -237,6 +275,9 @@ static uc_err uc_init(uc_engine *uc)
         uc->reg_reset(uc);
     }
 
+    // Keep the pristine CPU state around for uc_reset().
+    uc->init_cpu_state = g_memdup(uc->cpu->env_ptr, uc->cpu_context_size);
+
     uc->init_done = true;
 
     return UC_ERR_OK;
@@ -259,14 +300,21 @@ uc_err uc_open(uc_arch arch, uc_mode mode, uc_engine **result)
         uc->errnum = UC_ERR_OK;
         uc->arch = arch;
         uc->mode = mode;
+        uc->context_content = UC_CTL_CONTEXT_CPU;
+        uc->context_regs = UC_CTL_CONTEXT_REGS_ALL;
 
         // uc->ram_list = { .blocks = QLIST_HEAD_INITIALIZER(ram_list.blocks) };
         QLIST_INIT(&uc->ram_list.blocks);
+        QLIST_INIT(&uc->ram_list.blocks_by_offset);
 
         QTAILQ_INIT(&uc->memory_listeners);
 
         QTAILQ_INIT(&uc->address_spaces);
 
+        // no TLB range to flush yet
+        uc->memory_flush_first = UINT64_MAX;
+        uc->memory_flush_host_first = UINTPTR_MAX;
+
         switch (arch) {
         default:
             break;
@@ -438,6 +486,11 @@ uc_err uc_close(uc_engine *uc)
         return UC_ERR_OK;
     }
 
+    // The regions unmapped in an open transaction are freed by the commit.
+    if (uc->memory_region_transaction_depth) {
+        uc->memory_commit(uc);
+    }
+
     // Cleanup internally.
     if (uc->release) {
         uc->release(uc->tcg_ctx);
@@ -486,11 +539,17 @@ uc_err uc_close(uc_engine *uc)
 
     for (i = 0; i < UC_HOOK_MAX; i++) {
         list_clear(&uc->hook[i]);
+        g_free(uc->hook_index[i].bounded);
+        g_free(uc->hook_index[i].max_end);
+        g_free(uc->hook_index[i].unbounded);
+        g_free(uc->hook_index[i].found);
     }
 
     free(uc->mapped_blocks);
 
     g_tree_destroy(uc->ctl_exits);
+    g_hash_table_destroy(uc->breakpoints);
+    g_free(uc->init_cpu_state);
 
     // finally, free uc itself.
     memset(uc, 0, sizeof(*uc));
@@ -499,6 +558,105 @@ uc_err uc_close(uc_engine *uc)
     return UC_ERR_OK;
 }
 
+gboolean uc_exit_invalidate_iter(gpointer key, gpointer val, gpointer data)
+{
+    uint64_t exit = *(uint64_t *)key;
+    uc_engine *uc = (uc_engine *)data;
+
+    // The TB stopping at exit ends right before it:
+    //
+    // 0: INC ecx
+    // 1: DEC edx <--- We put exit here, then the range of TB is [0, 1)
+    //
+    // While tb_invalidate_phys_range invalides [start, end)
+    if (exit != 0) {
+        uc->uc_invalidate_tb(uc, exit - 1, 1);
+    }
+
+    return false;
+}
+
+// Drop the TBs which stop at the exits of the last outermost run, this must
+// be called before these exits change.
+static void uc_drop_exit_tbs(uc_engine *uc)
+{
+    if (!uc->exit_tbs_cached) {
+        return;
+    }
+
+    if (uc->exit_tbs_use_exits) {
+        g_tree_foreach(uc->ctl_exits, uc_exit_invalidate_iter, uc);
+    } else {
+        uc_exit_invalidate_iter(&uc->exit_tbs_exit, NULL, uc);
+    }
+    uc->exit_tbs_cached = false;
+}
+
+UNICORN_EXPORT
+uc_err uc_reset(uc_engine *uc, bool keep_cache)
+{
+    struct list_item *cur;
+    int i;
+
+    UC_INIT(uc);
+
+    // Not from within a hook.
+    if (uc->nested_level) {
+        return UC_ERR_ARG;
+    }
+
+    // Remove the hooks first, deleting them invalidates the TBs they were
+    // inlined into which needs the memory to still be mapped.
+    for (i = 0; i < UC_HOOK_MAX; i++) {
+        for (cur = uc->hook[i].head; cur != NULL; cur = cur->next) {
+            struct hook *hook = (struct hook *)cur->data;
+            if (!hook->to_delete) {
+                uc_hook_del(uc, (uc_hook)hook);
+            }
+        }
+    }
+    clear_deleted_hooks(uc);
+    uc->hook_insert = false;
+
+    // These are baked into the translated code.
+    if (g_tree_nnodes(uc->ctl_exits) || g_hash_table_size(uc->breakpoints) ||
+        uc->coverage_map || uc->cmplog_buf ||
+        uc->timeout_clock != UC_TIMEOUT_CLOCK_HOST) {
+        keep_cache = false;
+    }
+
+    uc_drop_exit_tbs(uc);
+    uc->use_exits = false;
+    g_tree_remove_all(uc->ctl_exits);
+    g_hash_table_remove_all(uc->breakpoints);
+    uc->breakpoint_hit = false;
+    uc->coverage_map = NULL;
+    uc->coverage_mask = 0;
+    uc->cmplog_buf = NULL;
+    uc->cmplog_size = 0;
+    uc->cmplog_count = 0;
+    uc->cmplog_cb = NULL;
+    uc->cmplog_data = NULL;
+    uc->timeout_clock = UC_TIMEOUT_CLOCK_HOST;
+    uc->context_content = UC_CTL_CONTEXT_CPU;
+    uc->context_regs = UC_CTL_CONTEXT_REGS_ALL;
+
+    if (uc->memory_region_transaction_depth) {
+        uc->memory_commit(uc);
+    }
+    uc->memory_unmap_all(uc);
+    uc->mem_epoch = 0;
+
+    if (!keep_cache) {
+        uc->tb_flush(uc);
+    }
+    uc->tcg_flush_tlb(uc);
+
+    memcpy(uc->cpu->env_ptr, uc->init_cpu_state, uc->cpu_context_size);
+
+    return UC_ERR_OK;
+}
+
 UNICORN_EXPORT
 uc_err uc_reg_read_batch(uc_engine *uc, int *ids, void **vals, int count)
 {
@@ -565,14 +723,22 @@ static bool check_mem_area(uc_engine *uc, uint64_t address, size_t size)
     return (count == size);
 }
 
-UNICORN_EXPORT
-uc_err uc_mem_read(uc_engine *uc, uint64_t address, void *_bytes, size_t size)
+// Apply the changes of an open memory map transaction, before the memory is
+// accessed.
+static void uc_mem_sync(uc_engine *uc)
+{
+    if (uc->memory_region_transaction_depth) {
+        uc->memory_commit(uc);
+        uc->memory_begin(uc);
+    }
+}
+
+static uc_err mem_read(uc_engine *uc, uint64_t address, void *_bytes,
+                       size_t size)
 {
     size_t count = 0, len;
     uint8_t *bytes = _bytes;
 
-    UC_INIT(uc);
-
     // qemu cpu_physical_memory_rw() size is an int
     if (size > INT_MAX)
         return UC_ERR_ARG;
@@ -610,14 +776,21 @@ uc_err uc_mem_read(uc_engine *uc, uint64_t address, void *_bytes, size_t size)
 }
 
 UNICORN_EXPORT
-uc_err uc_mem_write(uc_engine *uc, uint64_t address, const void *_bytes,
-                    size_t size)
+uc_err uc_mem_read(uc_engine *uc, uint64_t address, void *bytes, size_t size)
+{
+    UC_INIT(uc);
+
+    uc_mem_sync(uc);
+
+    return mem_read(uc, address, bytes, size);
+}
+
+static uc_err mem_write(uc_engine *uc, uint64_t address, const void *_bytes,
+                        size_t size)
 {
     size_t count = 0, len;
     const uint8_t *bytes = _bytes;
 
-    UC_INIT(uc);
-
     // qemu cpu_physical_memory_rw() size is an int
     if (size > INT_MAX)
         return UC_ERR_ARG;
@@ -667,48 +840,267 @@ uc_err uc_mem_write(uc_engine *uc, uint64_t address, const void *_bytes,
     }
 }
 
-#define TIMEOUT_STEP 2 // microseconds
-static void *_timeout_fn(void *arg)
+UNICORN_EXPORT
+uc_err uc_mem_write(uc_engine *uc, uint64_t address, const void *bytes,
+                    size_t size)
 {
-    struct uc_struct *uc = arg;
-    int64_t current_time = get_clock();
+    UC_INIT(uc);
 
-    do {
-        usleep(TIMEOUT_STEP);
-        // perhaps emulation is even done before timeout?
-        if (uc->emulation_done) {
-            break;
+    uc_mem_sync(uc);
+
+    return mem_write(uc, address, bytes, size);
+}
+
+UNICORN_EXPORT
+uc_err uc_mem_read_batch(uc_engine *uc, const uint64_t *addresses,
+                         void *const *bytes, const size_t *sizes,
+                         uc_err *results, int count)
+{
+    uc_err err, ret = UC_ERR_OK;
+    int i;
+
+    UC_INIT(uc);
+
+    uc_mem_sync(uc);
+
+    for (i = 0; i < count; i++) {
+        err = mem_read(uc, addresses[i], bytes[i], sizes[i]);
+        if (results) {
+            results[i] = err;
+        }
+        if (ret == UC_ERR_OK) {
+            ret = err;
+        }
+    }
+
+    return ret;
+}
+
+UNICORN_EXPORT
+uc_err uc_mem_write_batch(uc_engine *uc, const uint64_t *addresses,
+                          const void *const *bytes, const size_t *sizes,
+                          uc_err *results, int count)
+{
+    uc_err err, ret = UC_ERR_OK;
+    int i;
+
+    UC_INIT(uc);
+
+    uc_mem_sync(uc);
+
+    for (i = 0; i < count; i++) {
+        err = mem_write(uc, addresses[i], bytes[i], sizes[i]);
+        if (results) {
+            results[i] = err;
+        }
+        if (ret == UC_ERR_OK) {
+            ret = err;
+        }
+    }
+
+    return ret;
+}
+
+UNICORN_EXPORT
+uc_err uc_vmem_translate(uc_engine *uc, uint64_t address, uint64_t *paddress)
+{
+    UC_INIT(uc);
+
+    if (paddress == NULL) {
+        return UC_ERR_ARG;
+    }
+
+    uc_mem_sync(uc);
+
+    if (!uc->vmem_translate(uc, address, paddress)) {
+        return UC_ERR_READ_UNMAPPED;
+    }
+
+    return UC_ERR_OK;
+}
+
+// Access a virtual range one physical run at a time, pages which follow each
+// other in physical memory too are accessed with a single call.
+static uc_err vmem_rw(uc_engine *uc, uint64_t address, uint8_t *bytes,
+                      size_t size, bool write)
+{
+    uint64_t paddr, run = 0;
+    size_t run_len = 0, len;
+    uc_err err;
+
+    UC_INIT(uc);
+
+    uc_mem_sync(uc);
+
+    while (size > 0) {
+        len = (size_t)MIN(size, uc->target_page_size -
+                                    (address & uc->target_page_align));
+        if (!uc->vmem_translate(uc, address, &paddr)) {
+            return write ? UC_ERR_WRITE_UNMAPPED : UC_ERR_READ_UNMAPPED;
+        }
+
+        if (run_len > 0 && paddr != run + run_len) {
+            err = write ? mem_write(uc, run, bytes, run_len)
+                        : mem_read(uc, run, bytes, run_len);
+            if (err != UC_ERR_OK) {
+                return err;
+            }
+            bytes += run_len;
+            run_len = 0;
+        }
+        if (run_len == 0) {
+            run = paddr;
+        }
+
+        run_len += len;
+        address += len;
+        size -= len;
+    }
+
+    if (run_len > 0) {
+        return write ? mem_write(uc, run, bytes, run_len)
+                     : mem_read(uc, run, bytes, run_len);
+    }
+
+    return UC_ERR_OK;
+}
+
+UNICORN_EXPORT
+uc_err uc_vmem_read(uc_engine *uc, uint64_t address, void *bytes, size_t size)
+{
+    return vmem_rw(uc, address, bytes, size, false);
+}
+
+UNICORN_EXPORT
+uc_err uc_vmem_write(uc_engine *uc, uint64_t address, const void *bytes,
+                     size_t size)
+{
+    return vmem_rw(uc, address, (uint8_t *)bytes, size, true);
+}
+
+// A single timer thread serves the uc_emu_start() timeouts of all the engines
+// of the process. Engines with a pending timeout are queued by deadline, the
+// thread sleeps until the earliest one and exits after staying idle for
+// TIMER_IDLE_NS.
+#define TIMER_IDLE_NS (1000LL * 1000 * 1000)
+
+static QemuMutex timer_lock = QEMU_MUTEX_INITIALIZER;
+static QemuCond timer_cond; // initialized with the first thread
+static struct uc_struct *timer_queue;
+static bool timer_running;
+static bool timer_thread_started;
+static int64_t timer_wakeup; // when the thread wakes up on its own
+
+static void *timer_service_fn(void *arg)
+{
+    struct uc_struct *uc;
+    int64_t now;
+
+    qemu_mutex_lock(&timer_lock);
+    while (true) {
+        uc = timer_queue;
+        now = get_clock();
+        if (uc == NULL) {
+            timer_wakeup = now + TIMER_IDLE_NS;
+            if (!qemu_cond_timedwait_ns(&timer_cond, &timer_lock,
+                                        TIMER_IDLE_NS) &&
+                timer_queue == NULL) {
+                break;
+            }
+            continue;
+        }
+
+        if (now < uc->timer_deadline) {
+            timer_wakeup = uc->timer_deadline;
+            qemu_cond_timedwait_ns(&timer_cond, &timer_lock,
+                                   uc->timer_deadline - now);
+            continue;
         }
-    } while ((uint64_t)(get_clock() - current_time) < uc->timeout);
 
-    // timeout before emulation is done?
-    if (!uc->emulation_done) {
+        // timeout before emulation is done, force emulation to stop. The
+        // lock is held so that the engine can't be disarmed meanwhile.
+        timer_queue = uc->timer_next;
+        uc->timer_armed = false;
         uc->timed_out = true;
-        // force emulation to stop
         uc_emu_stop(uc);
     }
+    timer_running = false;
+    qemu_mutex_unlock(&timer_lock);
 
     return NULL;
 }
 
-static void enable_emu_timer(uc_engine *uc, uint64_t timeout)
+// must be called with timer_lock held
+static void timer_unlink(uc_engine *uc)
 {
-    uc->timeout = timeout;
-    qemu_thread_create(uc, &uc->timer, "timeout", _timeout_fn, uc,
-                       QEMU_THREAD_JOINABLE);
+    struct uc_struct **pp;
+
+    if (!uc->timer_armed) {
+        return;
+    }
+
+    for (pp = &timer_queue; *pp != uc; pp = &(*pp)->timer_next) {
+    }
+    *pp = uc->timer_next;
+    uc->timer_armed = false;
 }
 
-static void hook_count_cb(struct uc_struct *uc, uint64_t address, uint32_t size,
-                          void *user_data)
+// must be called with timer_lock held
+static void timer_insert(uc_engine *uc, int64_t deadline)
 {
-    // count this instruction. ah ah ah.
-    uc->emu_counter++;
-    // printf(":: emu counter = %u, at %lx\n", uc->emu_counter, address);
+    struct uc_struct **pp;
+    QemuThread thread;
 
-    if (uc->emu_counter > uc->emu_count) {
-        // printf(":: emu counter = %u, stop emulation\n", uc->emu_counter);
-        uc_emu_stop(uc);
+    for (pp = &timer_queue; *pp && (*pp)->timer_deadline <= deadline;
+         pp = &(*pp)->timer_next) {
+    }
+    uc->timer_deadline = deadline;
+    uc->timer_next = *pp;
+    uc->timer_armed = true;
+    *pp = uc;
+
+    if (!timer_running) {
+        if (!timer_thread_started) {
+            qemu_cond_init(&timer_cond);
+            timer_thread_started = true;
+        }
+        timer_running = true;
+        qemu_thread_create(uc, &thread, "timeout", timer_service_fn, NULL,
+                           QEMU_THREAD_DETACHED);
+    } else if (deadline < timer_wakeup) {
+        // the thread would oversleep this deadline. Only waking it up when
+        // needed keeps short runs from paying for a context switch.
+        qemu_cond_signal(&timer_cond);
+    }
+}
+
+// Returns the deadline of the outer uc_emu_start if its timer is pending,
+// 0 otherwise.
+static int64_t enable_emu_timer(uc_engine *uc, uint64_t timeout)
+{
+    int64_t outer_deadline = 0;
+
+    uc->timeout = timeout;
+
+    qemu_mutex_lock(&timer_lock);
+    if (uc->timer_armed) {
+        outer_deadline = uc->timer_deadline;
+        timer_unlink(uc);
+    }
+    timer_insert(uc, get_clock() + timeout);
+    qemu_mutex_unlock(&timer_lock);
+
+    return outer_deadline;
+}
+
+static void disable_emu_timer(uc_engine *uc, int64_t outer_deadline)
+{
+    qemu_mutex_lock(&timer_lock);
+    timer_unlink(uc);
+    if (outer_deadline) {
+        timer_insert(uc, outer_deadline);
     }
+    qemu_mutex_unlock(&timer_lock);
 }
 
 static void clear_deleted_hooks(uc_engine *uc)
@@ -730,11 +1122,31 @@ static void clear_deleted_hooks(uc_engine *uc)
     list_clear(&uc->hooks_to_del);
 }
 
+// TCG helper, called by the translated code once the comparison log is full.
+void helper_uc_cmplog_drain(void *handle);
+void helper_uc_cmplog_drain(void *handle)
+{
+    struct uc_struct *uc = handle;
+    uint32_t count = uc->cmplog_count;
+
+    if (count == 0) {
+        return;
+    }
+
+    // Reset first, the callback may run a nested uc_emu_start.
+    uc->cmplog_count = 0;
+    uc->cmplog_cb(uc, uc->cmplog_buf, count, uc->cmplog_data);
+}
+
 UNICORN_EXPORT
 uc_err uc_emu_start(uc_engine *uc, uint64_t begin, uint64_t until,
                     uint64_t timeout, size_t count)
 {
     uc_err err;
+    size_t outer_count;
+    int64_t outer_deadline = 0;
+    bool virtual_timeout =
+        timeout && uc->timeout_clock == UC_TIMEOUT_CLOCK_VIRTUAL;
 
     // reset the counter
     uc->emu_counter = 0;
@@ -841,30 +1253,25 @@ uc_err uc_emu_start(uc_engine *uc, uint64_t begin, uint64_t until,
 
     uc->stop_request = false;
 
+    // Starting at a breakpoint executes it, see CF_UC_BP_SKIP. So does
+    // starting at the branch left by a breakpoint in its delay slot.
+    uc->breakpoint_resume =
+        uc_addr_is_breakpoint(uc, begin) ||
+        (uc->breakpoint_hit && uc->breakpoint_stop_pc == begin);
+    uc->breakpoint_in_slot = false;
+
+    // Every run starts a new coverage trace, like an AFL execution.
+    uc->coverage_prev = 0;
+
+    // Counted and uncounted TBs are cached side by side (CF_UC_ICOUNT), so
+    // the mode can change from one run to the next without a tb_flush.
+    outer_count = uc->emu_count;
     uc->emu_count = count;
-    // remove count hook if counting isn't necessary
-    if (count <= 0 && uc->count_hook != 0) {
-        uc_hook_del(uc, uc->count_hook);
-        uc->count_hook = 0;
 
-        // In this case, we have to drop all translated blocks.
-        uc->tb_flush(uc);
-    }
-    // set up count hook to count instructions.
-    if (count > 0 && uc->count_hook == 0) {
-        uc_err err;
-        // callback to count instructions must be run before everything else,
-        // so instead of appending, we must insert the hook at the begin
-        // of the hook list
-        uc->hook_insert = 1;
-        err = uc_hook_add(uc, &uc->count_hook, UC_HOOK_CODE, hook_count_cb,
-                          NULL, 1, 0);
-        // restore to append mode for uc_hook_add()
-        uc->hook_insert = 0;
-        if (err != UC_ERR_OK) {
-            uc->nested_level--;
-            return err;
-        }
+    // The virtual clock is the instruction budget itself, whichever of
+    // @count and @timeout runs out first stops the emulation.
+    if (virtual_timeout && (count == 0 || timeout < count)) {
+        uc->emu_count = (size_t)MIN(timeout, SIZE_MAX);
     }
 
     // If UC_CTL_UC_USE_EXITS is set, then the @until param won't have any
@@ -873,12 +1280,58 @@ uc_err uc_emu_start(uc_engine *uc, uint64_t begin, uint64_t until,
         uc->exits[uc->nested_level - 1] = until;
     }
 
-    if (timeout) {
-        enable_emu_timer(uc, timeout * 1000); // microseconds -> nanoseconds
+    if (uc->nested_level == 1 &&
+        (uc->exit_tbs_use_exits != (bool)uc->use_exits ||
+         (!uc->use_exits && uc->exit_tbs_exit != until))) {
+        uc_drop_exit_tbs(uc);
+    }
+
+    if (virtual_timeout) {
+        uc->timeout = timeout;
+    } else if (timeout) {
+        // microseconds -> nanoseconds
+        outer_deadline = enable_emu_timer(uc, timeout * 1000);
     }
 
+    uc_mem_sync(uc);
     uc->vm_start(uc);
 
+    if (timeout && !virtual_timeout) {
+        // Cancel the timer, or give it back to the outer uc_emu_start, before
+        // anything else. A deadline passing after the run finished must not
+        // flag it as timed out.
+        disable_emu_timer(uc, outer_deadline);
+    }
+
+    if (virtual_timeout && uc->emu_counter >= timeout) {
+        uc->timed_out = true;
+    }
+
+    // Breakpoints stop the emulation the same way as @until, tell them apart.
+    uc->breakpoint_hit = false;
+    if (!uc->invalid_error && !uc->stop_request && !uc->timed_out &&
+        g_hash_table_size(uc->breakpoints) != 0) {
+        uint64_t pc = uc->get_pc(uc);
+
+        // A breakpoint in a delay slot stops before the branch, which is
+        // not committed yet.
+        if (uc->breakpoint_in_slot) {
+            uc->breakpoint_hit = true;
+            uc->breakpoint_hit_pc = uc->breakpoint_slot_pc;
+            uc->breakpoint_stop_pc = pc;
+        } else if (uc_addr_is_breakpoint(uc, pc) &&
+                   !uc_addr_is_until(uc, pc)) {
+            uc->breakpoint_hit = true;
+            uc->breakpoint_hit_pc = pc;
+            uc->breakpoint_stop_pc = pc;
+        }
+    }
+
+    helper_uc_cmplog_drain(uc);
+
+    // Back to the budget of the outer uc_emu_start, if any.
+    uc->emu_count = outer_count;
+
     uc->nested_level--;
 
     // emulation is done if and only if we exit the outer uc_emu_start
@@ -891,15 +1344,13 @@ uc_err uc_emu_start(uc_engine *uc, uint64_t begin, uint64_t until,
         clear_deleted_hooks(uc);
     }
 
-    if (timeout) {
-        // wait for the timer to finish
-        qemu_thread_join(&uc->timer);
-    }
-
     // We may be in a nested uc_emu_start and thus clear invalid_error
     // once we are done.
     err = uc->invalid_error;
     uc->invalid_error = 0;
+    if (err == UC_ERR_OK && uc->breakpoint_hit) {
+        err = UC_ERR_BREAKPOINT;
+    }
     return err;
 }
 
@@ -1004,6 +1455,10 @@ static uc_err mem_map(uc_engine *uc, uint64_t address, size_t size,
 
     uc->mapped_blocks[pos] = block;
     uc->mapped_block_count++;
+    memory_mapping_set(uc, block->addr, block->end, block);
+
+    // The memory snapshots don't match the memory map anymore.
+    uc->mem_epoch = 0;
 
     return UC_ERR_OK;
 }
@@ -1064,6 +1519,34 @@ uc_err uc_mem_map(uc_engine *uc, uint64_t address, size_t size, uint32_t perms)
                    uc->memory_map(uc, address, size, perms));
 }
 
+UNICORN_EXPORT
+uc_err uc_mem_map_begin(uc_engine *uc)
+{
+    UC_INIT(uc);
+
+    if (uc->memory_region_transaction_depth) {
+        return UC_ERR_ARG;
+    }
+
+    uc->memory_begin(uc);
+
+    return UC_ERR_OK;
+}
+
+UNICORN_EXPORT
+uc_err uc_mem_map_commit(uc_engine *uc)
+{
+    UC_INIT(uc);
+
+    if (!uc->memory_region_transaction_depth) {
+        return UC_ERR_ARG;
+    }
+
+    uc->memory_commit(uc);
+
+    return UC_ERR_OK;
+}
+
 UNICORN_EXPORT
 uc_err uc_mem_map_ptr(uc_engine *uc, uint64_t address, size_t size,
                       uint32_t perms, void *ptr)
@@ -1090,44 +1573,81 @@ uc_err uc_mem_map_ptr(uc_engine *uc, uint64_t address, size_t size,
 }
 
 UNICORN_EXPORT
-uc_err uc_mmio_map(uc_engine *uc, uint64_t address, size_t size,
-                   uc_cb_mmio_read_t read_cb, void *user_data_read,
-                   uc_cb_mmio_write_t write_cb, void *user_data_write)
+uc_err uc_mem_map_file(uc_engine *uc, uint64_t address, size_t size,
+                       uint32_t perms, int fd, uint64_t offset, bool shared)
 {
+#ifdef _WIN32
+    return UC_ERR_ARG;
+#else
+    MemoryRegion *mr;
+    RAMBlock *block;
+    struct stat st;
     uc_err res;
 
     UC_INIT(uc);
 
+    if (fd < 0 || offset % uc->qemu_real_host_page_size != 0 ||
+        fstat(fd, &st) != 0 ||
+        (S_ISREG(st.st_mode) && offset + size > (uint64_t)st.st_size)) {
+        return UC_ERR_ARG;
+    }
+
     if (uc->mem_redirect) {
         address = uc->mem_redirect(address);
     }
 
-    res = mem_map_check(uc, address, size, UC_PROT_ALL);
-    if (res)
+    res = mem_map_check(uc, address, size, perms);
+    if (res) {
         return res;
-
-    // The callbacks do not need to be checked for NULL here, as their presence
-    // (or lack thereof) will determine the permissions used.
-    return mem_map(uc, address, size, UC_PROT_NONE,
-                   uc->memory_map_io(uc, address, size, read_cb, write_cb,
-                                     user_data_read, user_data_write));
-}
-
-// Create a backup copy of the indicated MemoryRegion.
-// Generally used in prepartion for splitting a MemoryRegion.
-static uint8_t *copy_region(struct uc_struct *uc, MemoryRegion *mr)
-{
-    uint8_t *block = (uint8_t *)g_malloc0((size_t)int128_get64(mr->size));
-    if (block != NULL) {
-        uc_err err =
-            uc_mem_read(uc, mr->addr, block, (size_t)int128_get64(mr->size));
-        if (err != UC_ERR_OK) {
-            free(block);
-            block = NULL;
-        }
     }
 
-    return block;
+    res = mem_map(uc, address, size, perms,
+                  uc->memory_map(uc, address, size, perms));
+    if (res) {
+        return res;
+    }
+
+    // Replace the fresh anonymous memory with the file, nothing is read
+    // until the guest touches it.
+    mr = memory_mapping(uc, address);
+    block = mr->ram_block;
+    block->fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (block->fd < 0 ||
+        mmap(block->host, block->max_length, PROT_READ | PROT_WRITE,
+             (shared ? MAP_SHARED : MAP_PRIVATE) | MAP_FIXED, block->fd,
+             (off_t)offset) == MAP_FAILED) {
+        uc->memory_unmap(uc, mr);
+        return UC_ERR_RESOURCE;
+    }
+    block->fd_offset = offset;
+    block->fd_shared = shared;
+
+    return UC_ERR_OK;
+#endif
+}
+
+UNICORN_EXPORT
+uc_err uc_mmio_map(uc_engine *uc, uint64_t address, size_t size,
+                   uc_cb_mmio_read_t read_cb, void *user_data_read,
+                   uc_cb_mmio_write_t write_cb, void *user_data_write)
+{
+    uc_err res;
+
+    UC_INIT(uc);
+
+    if (uc->mem_redirect) {
+        address = uc->mem_redirect(address);
+    }
+
+    res = mem_map_check(uc, address, size, UC_PROT_ALL);
+    if (res)
+        return res;
+
+    // The callbacks do not need to be checked for NULL here, as their presence
+    // (or lack thereof) will determine the permissions used.
+    return mem_map(uc, address, size, UC_PROT_NONE,
+                   uc->memory_map_io(uc, address, size, read_cb, write_cb,
+                                     user_data_read, user_data_write));
 }
 
 /*
@@ -1209,30 +1729,37 @@ static bool split_mmio_region(struct uc_struct *uc, MemoryRegion *mr,
     return true;
 }
 
+// Split a RAM region in two at address, the upper half is returned in hi.
+static bool split_region_at(struct uc_struct *uc, MemoryRegion *mr,
+                            uint64_t address, MemoryRegion **hi)
+{
+    MemoryRegion *lo;
+
+    if (!uc->memory_split(uc, mr, address, &lo, hi)) {
+        return false;
+    }
+
+    return mem_map(uc, lo->addr, (size_t)(lo->end - lo->addr), lo->perms,
+                   lo) == UC_ERR_OK &&
+           mem_map(uc, (*hi)->addr, (size_t)((*hi)->end - (*hi)->addr),
+                   (*hi)->perms, *hi) == UC_ERR_OK;
+}
+
 /*
    Split the given MemoryRegion at the indicated address for the indicated size
-   this may result in the create of up to 3 spanning sections. If the delete
-   parameter is true, the no new section will be created to replace the indicate
-   range. This functions exists to support uc_mem_protect and uc_mem_unmap.
+   this may result in the create of up to 3 spanning sections. This functions
+   exists to support uc_mem_protect and uc_mem_unmap.
 
    This is a static function and callers have already done some preliminary
    parameter validation.
 
-   The do_delete argument indicates that we are being called to support
-   uc_mem_unmap. In this case we save some time by choosing NOT to remap
-   the areas that are intended to get unmapped
+   The sections share the host memory of the region, only the region is split,
+   never its content, so the cost does not depend on the size of the region.
  */
-// TODO: investigate whether qemu region manipulation functions already offered
-// this capability
 static bool split_region(struct uc_struct *uc, MemoryRegion *mr,
-                         uint64_t address, size_t size, bool do_delete)
+                         uint64_t address, size_t size)
 {
-    uint8_t *backup;
-    uint32_t perms;
-    uint64_t begin, end, chunk_end;
-    size_t l_size, m_size, r_size;
-    RAMBlock *block = NULL;
-    bool prealloc = false;
+    uint64_t chunk_end;
 
     chunk_end = address + size;
 
@@ -1252,46 +1779,6 @@ static bool split_region(struct uc_struct *uc, MemoryRegion *mr,
         return false;
     }
 
-    // Find the correct and large enough (which contains our target mr)
-    // to create the content backup.
-    QLIST_FOREACH(block, &uc->ram_list.blocks, next)
-    {
-        // block->offset is the offset within ram_addr_t, not GPA
-        if (block->mr->addr <= mr->addr &&
-            block->used_length + block->mr->addr >= mr->end) {
-            break;
-        }
-    }
-
-    if (block == NULL) {
-        return false;
-    }
-
-    // RAM_PREALLOC is not defined outside exec.c and I didn't feel like
-    // moving it
-    prealloc = !!(block->flags & 1);
-
-    if (block->flags & 1) {
-        backup = block->host;
-    } else {
-        backup = copy_region(uc, mr);
-        if (backup == NULL) {
-            return false;
-        }
-    }
-
-    // save the essential information required for the split before mr gets
-    // deleted
-    perms = mr->perms;
-    begin = mr->addr;
-    end = mr->end;
-
-    // unmap this region first, then do split it later
-    if (uc_mem_unmap(uc, mr->addr, (size_t)int128_get64(mr->size)) !=
-        UC_ERR_OK) {
-        goto error;
-    }
-
     /* overlapping cases
      *               |------mr------|
      * case 1    |---size--|
@@ -1299,82 +1786,14 @@ static bool split_region(struct uc_struct *uc, MemoryRegion *mr,
      * case 3                  |---size--|
      */
 
-    // adjust some things
-    if (address < begin) {
-        address = begin;
-    }
-    if (chunk_end > end) {
-        chunk_end = end;
-    }
-
-    // compute sub region sizes
-    l_size = (size_t)(address - begin);
-    r_size = (size_t)(end - chunk_end);
-    m_size = (size_t)(chunk_end - address);
-
-    // If there are error in any of the below operations, things are too far
-    // gone at that point to recover. Could try to remap orignal region, but
-    // these smaller allocation just failed so no guarantee that we can recover
-    // the original allocation at this point
-    if (l_size > 0) {
-        if (!prealloc) {
-            if (uc_mem_map(uc, begin, l_size, perms) != UC_ERR_OK) {
-                goto error;
-            }
-            if (uc_mem_write(uc, begin, backup, l_size) != UC_ERR_OK) {
-                goto error;
-            }
-        } else {
-            if (uc_mem_map_ptr(uc, begin, l_size, perms, backup) != UC_ERR_OK) {
-                goto error;
-            }
-        }
-    }
-
-    if (m_size > 0 && !do_delete) {
-        if (!prealloc) {
-            if (uc_mem_map(uc, address, m_size, perms) != UC_ERR_OK) {
-                goto error;
-            }
-            if (uc_mem_write(uc, address, backup + l_size, m_size) !=
-                UC_ERR_OK) {
-                goto error;
-            }
-        } else {
-            if (uc_mem_map_ptr(uc, address, m_size, perms, backup + l_size) !=
-                UC_ERR_OK) {
-                goto error;
-            }
-        }
+    if (address > mr->addr && !split_region_at(uc, mr, address, &mr)) {
+        return false;
     }
-
-    if (r_size > 0) {
-        if (!prealloc) {
-            if (uc_mem_map(uc, chunk_end, r_size, perms) != UC_ERR_OK) {
-                goto error;
-            }
-            if (uc_mem_write(uc, chunk_end, backup + l_size + m_size, r_size) !=
-                UC_ERR_OK) {
-                goto error;
-            }
-        } else {
-            if (uc_mem_map_ptr(uc, chunk_end, r_size, perms,
-                               backup + l_size + m_size) != UC_ERR_OK) {
-                goto error;
-            }
-        }
+    if (chunk_end < mr->end && !split_region_at(uc, mr, chunk_end, &mr)) {
+        return false;
     }
 
-    if (!prealloc) {
-        free(backup);
-    }
     return true;
-
-error:
-    if (!prealloc) {
-        free(backup);
-    }
-    return false;
 }
 
 UNICORN_EXPORT
@@ -1426,11 +1845,14 @@ uc_err uc_mem_protect(struct uc_struct *uc, uint64_t address, size_t size,
         mr = memory_mapping(uc, addr);
         len = (size_t)MIN(size - count, mr->end - addr);
         if (mr->ram) {
-            if (!split_region(uc, mr, addr, len, false)) {
+            if (!split_region(uc, mr, addr, len)) {
                 return UC_ERR_NOMEM;
             }
 
             mr = memory_mapping(uc, addr);
+            if (mr->perms != perms) {
+                uc->mem_epoch = 0;
+            }
             // will this remove EXEC permission?
             if (((mr->perms & UC_PROT_EXEC) != 0) &&
                 ((perms & UC_PROT_EXEC) == 0)) {
@@ -1510,7 +1932,7 @@ uc_err uc_mem_unmap(struct uc_struct *uc, uint64_t address, size_t size)
                 return UC_ERR_NOMEM;
             }
         } else {
-            if (!split_region(uc, mr, addr, len, true)) {
+            if (!split_region(uc, mr, addr, len)) {
                 return UC_ERR_NOMEM;
             }
         }
@@ -1521,6 +1943,7 @@ uc_err uc_mem_unmap(struct uc_struct *uc, uint64_t address, size_t size)
         if (mr != NULL) {
             uc->memory_unmap(uc, mr);
         }
+        uc->mem_epoch = 0;
         count += len;
         addr += len;
     }
@@ -1528,12 +1951,135 @@ uc_err uc_mem_unmap(struct uc_struct *uc, uint64_t address, size_t size)
     return UC_ERR_OK;
 }
 
+/*
+ * memory_mapping() finds the blocks in a radix tree indexed by page number,
+ * with MAPPED_TABLE_BITS bits per level, so that the lookup doesn't depend on
+ * the number of blocks. An entry is either NULL, a child node, or a block
+ * tagged with MAPPED_TABLE_LEAF which covers all the pages of the entry. The
+ * tree only has the levels needed by the highest page mapped, which keeps it
+ * short for 32-bit guests.
+ */
+#define MAPPED_TABLE_BITS 9
+#define MAPPED_TABLE_SIZE (1 << MAPPED_TABLE_BITS)
+#define MAPPED_TABLE_LEAF 1
+
+static void mapped_table_free(void **node, int level)
+{
+    void *entry;
+    int i;
+
+    for (i = 0; level > 0 && i < MAPPED_TABLE_SIZE; i++) {
+        entry = node[i];
+        if (entry && !((uintptr_t)entry & MAPPED_TABLE_LEAF)) {
+            mapped_table_free((void **)entry, level - 1);
+        }
+    }
+    g_free(node);
+}
+
+// Point the pages [first, last] of node, relative to the node, to entry.
+// Each entry of the node covers 1 << (level * MAPPED_TABLE_BITS) pages.
+static void mapped_table_update(void **node, int level, uint64_t first,
+                                uint64_t last, void *entry)
+{
+    int shift = level * MAPPED_TABLE_BITS;
+    uint64_t span = (uint64_t)1 << shift;
+    uint64_t i, child_first, child_last;
+    void **child;
+    int j;
+
+    for (i = first >> shift; i <= last >> shift; i++) {
+        child_first = MAX(first, i << shift) - (i << shift);
+        child_last = MIN(last, (i << shift) + span - 1) - (i << shift);
+
+        if (child_first == 0 && child_last == span - 1) {
+            // the entry is covered, drop what was below
+            if (node[i] && !((uintptr_t)node[i] & MAPPED_TABLE_LEAF)) {
+                mapped_table_free((void **)node[i], level - 1);
+            }
+            node[i] = entry;
+            continue;
+        }
+
+        if (node[i] == NULL && entry == NULL) {
+            continue;
+        }
+        if (node[i] == NULL || ((uintptr_t)node[i] & MAPPED_TABLE_LEAF)) {
+            child = g_new(void *, MAPPED_TABLE_SIZE);
+            for (j = 0; j < MAPPED_TABLE_SIZE; j++) {
+                child[j] = node[i];
+            }
+            node[i] = child;
+        }
+        mapped_table_update((void **)node[i], level - 1, child_first,
+                            child_last, entry);
+    }
+}
+
+void memory_mapping_set(struct uc_struct *uc, uint64_t begin, uint64_t end,
+                        MemoryRegion *mr)
+{
+    uint64_t first, last;
+    void **root;
+
+    if (uc->mapped_table == NULL) {
+        if (mr == NULL) {
+            return;
+        }
+        uc->mapped_table_shift = 0;
+        while (((uint64_t)1 << uc->mapped_table_shift) <
+               uc->target_page_size) {
+            uc->mapped_table_shift++;
+        }
+        uc->mapped_table_levels = 1;
+        uc->mapped_table = g_new0(void *, MAPPED_TABLE_SIZE);
+    }
+
+    // end is 0 for a block at the end of the address space
+    first = begin >> uc->mapped_table_shift;
+    last = (end - 1) >> uc->mapped_table_shift;
+
+    if (last >> (uc->mapped_table_levels * MAPPED_TABLE_BITS)) {
+        if (mr == NULL) {
+            // nothing is mapped that high
+            last = ((uint64_t)1
+                    << (uc->mapped_table_levels * MAPPED_TABLE_BITS)) -
+                   1;
+            if (first > last) {
+                return;
+            }
+        }
+        // grow the tree, the old root covers the lowest pages
+        while (last >> (uc->mapped_table_levels * MAPPED_TABLE_BITS)) {
+            root = g_new0(void *, MAPPED_TABLE_SIZE);
+            root[0] = uc->mapped_table;
+            uc->mapped_table = root;
+            uc->mapped_table_levels++;
+        }
+    }
+
+    mapped_table_update(uc->mapped_table, uc->mapped_table_levels - 1, first,
+                        last, mr ? (void *)((uintptr_t)mr | MAPPED_TABLE_LEAF)
+                                 : NULL);
+}
+
+void memory_mapping_clear(struct uc_struct *uc)
+{
+    if (uc->mapped_table) {
+        mapped_table_free(uc->mapped_table, uc->mapped_table_levels - 1);
+        uc->mapped_table = NULL;
+    }
+}
+
 // find the memory region of this address
 MemoryRegion *memory_mapping(struct uc_struct *uc, uint64_t address)
 {
-    unsigned int i;
+    void **node = uc->mapped_table;
+    void *entry = NULL;
+    uint64_t page;
+    int level;
 
-    if (uc->mapped_block_count == 0) {
+    if (node == NULL) {
         return NULL;
     }
 
@@ -1541,22 +2087,182 @@ MemoryRegion *memory_mapping(struct uc_struct *uc, uint64_t address)
         address = uc->mem_redirect(address);
     }
 
-    // try with the cache index first
-    i = uc->mapped_block_cache_index;
+    page = address >> uc->mapped_table_shift;
+    if (page >> (uc->mapped_table_levels * MAPPED_TABLE_BITS)) {
+        return NULL;
+    }
+    for (level = uc->mapped_table_levels - 1; level >= 0; level--) {
+        entry = node[(page >> (level * MAPPED_TABLE_BITS)) &
+                     (MAPPED_TABLE_SIZE - 1)];
+        if (entry == NULL || ((uintptr_t)entry & MAPPED_TABLE_LEAF)) {
+            break;
+        }
+        node = (void **)entry;
+    }
+
+    return (MemoryRegion *)((uintptr_t)entry & ~(uintptr_t)MAPPED_TABLE_LEAF);
+}
+
+static int hook_index_cmp_begin(const void *a, const void *b)
+{
+    const struct hook *l = *(const struct hook **)a;
+    const struct hook *r = *(const struct hook **)b;
 
-    if (i < uc->mapped_block_count && address >= uc->mapped_blocks[i]->addr &&
-        address < uc->mapped_blocks[i]->end) {
-        return uc->mapped_blocks[i];
+    if (l->begin != r->begin) {
+        return l->begin < r->begin ? -1 : 1;
     }
+    return (l->seq > r->seq) - (l->seq < r->seq);
+}
 
-    i = bsearch_mapped_blocks(uc, address);
+static int hook_index_cmp_seq(const void *a, const void *b)
+{
+    const struct hook *l = *(const struct hook **)a;
+    const struct hook *r = *(const struct hook **)b;
 
-    if (i < uc->mapped_block_count && address >= uc->mapped_blocks[i]->addr &&
-        address <= uc->mapped_blocks[i]->end - 1)
-        return uc->mapped_blocks[i];
+    return (l->seq > r->seq) - (l->seq < r->seq);
+}
 
-    // not found
-    return NULL;
+static void hook_index_build(uc_engine *uc, int idx)
+{
+    struct hook_index *index = &uc->hook_index[idx];
+    struct list_item *cur;
+    struct hook *hook;
+    size_t bounded = 0, unbounded = 0, i;
+
+    for (cur = uc->hook[idx].head; cur != NULL; cur = cur->next) {
+        hook = (struct hook *)cur->data;
+        if (hook->to_delete) {
+            continue;
+        }
+        if (hook->begin > hook->end) {
+            unbounded++;
+        } else {
+            bounded++;
+        }
+    }
+
+    index->bounded = g_renew(struct hook *, index->bounded, bounded);
+    index->unbounded = g_renew(struct hook *, index->unbounded, unbounded);
+    index->found = g_renew(struct hook *, index->found, bounded + unbounded);
+    index->bounded_len = 0;
+    index->unbounded_len = 0;
+
+    for (cur = uc->hook[idx].head; cur != NULL; cur = cur->next) {
+        hook = (struct hook *)cur->data;
+        if (hook->to_delete) {
+            continue;
+        }
+        if (hook->begin > hook->end) {
+            index->unbounded[index->unbounded_len++] = hook;
+        } else {
+            index->bounded[index->bounded_len++] = hook;
+        }
+    }
+
+    // The list is in seq order already, except with uc->hook_insert set.
+    qsort(index->unbounded, unbounded, sizeof(struct hook *),
+          hook_index_cmp_seq);
+    qsort(index->bounded, bounded, sizeof(struct hook *),
+          hook_index_cmp_begin);
+
+    index->tree_size = 1;
+    while (index->tree_size < bounded) {
+        index->tree_size <<= 1;
+    }
+    index->max_end = g_renew(uint64_t, index->max_end, 2 * index->tree_size);
+    memset(index->max_end, 0, 2 * index->tree_size * sizeof(uint64_t));
+    for (i = 0; i < bounded; i++) {
+        index->max_end[index->tree_size + i] = index->bounded[i]->end;
+    }
+    for (i = index->tree_size - 1; i > 0; i--) {
+        index->max_end[i] =
+            MAX(index->max_end[2 * i], index->max_end[2 * i + 1]);
+    }
+
+    index->dirty = false;
+}
+
+// The number of bounded hooks which begin at or before addr.
+static size_t hook_index_limit(struct hook_index *index, uint64_t addr)
+{
+    size_t lo = 0, hi = index->bounded_len, mid;
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (index->bounded[mid]->begin <= addr) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Visit the bounded hooks below limit in the subtree node, which covers
+// [lo, lo + width), whose end is at least begin. Without found, stop at the
+// first one.
+static bool hook_index_walk(struct hook_index *index, size_t node, size_t lo,
+                            size_t width, size_t limit, uint64_t begin,
+                            size_t *found)
+{
+    if (lo >= limit || index->max_end[node] < begin) {
+        return false;
+    }
+
+    if (width == 1) {
+        if (found == NULL) {
+            return true;
+        }
+        index->found[(*found)++] = index->bounded[lo];
+        return false;
+    }
+
+    width /= 2;
+    return hook_index_walk(index, 2 * node, lo, width, limit, begin, found) ||
+           hook_index_walk(index, 2 * node + 1, lo + width, width, limit,
+                           begin, found);
+}
+
+bool hook_index_exists(uc_engine *uc, int idx, uint64_t begin, uint64_t end)
+{
+    struct hook_index *index = &uc->hook_index[idx];
+
+    if (index->dirty) {
+        hook_index_build(uc, idx);
+    }
+
+    if (index->unbounded_len != 0) {
+        return true;
+    }
+
+    return index->bounded_len != 0 &&
+           hook_index_walk(index, 1, 0, index->tree_size,
+                           hook_index_limit(index, end), begin, NULL);
+}
+
+size_t hook_index_find(uc_engine *uc, int idx, uint64_t begin, uint64_t end,
+                       struct hook ***found)
+{
+    struct hook_index *index = &uc->hook_index[idx];
+    size_t len;
+
+    if (index->dirty) {
+        hook_index_build(uc, idx);
+    }
+
+    len = index->unbounded_len;
+    memcpy(index->found, index->unbounded, len * sizeof(struct hook *));
+    if (index->bounded_len != 0) {
+        hook_index_walk(index, 1, 0, index->tree_size,
+                        hook_index_limit(index, end), begin, &len);
+    }
+
+    if (len > 1 && len > index->unbounded_len) {
+        qsort(index->found, len, sizeof(struct hook *), hook_index_cmp_seq);
+    }
+
+    *found = index->found;
+    return len;
 }
 
 UNICORN_EXPORT
@@ -1568,6 +2274,10 @@ uc_err uc_hook_add(uc_engine *uc, uc_hook *hh, int type, void *callback,
 
     UC_INIT(uc);
 
+    // The last run used to retranslate the code at its exits, which then got
+    // the hooks added in between.
+    uc_drop_exit_tbs(uc);
+
     struct hook *hook = calloc(1, sizeof(struct hook));
     if (hook == NULL) {
         return UC_ERR_NOMEM;
@@ -1580,6 +2290,7 @@ uc_err uc_hook_add(uc_engine *uc, uc_hook *hh, int type, void *callback,
     hook->user_data = user_data;
     hook->refs = 0;
     hook->to_delete = false;
+    hook->seq = uc->hook_insert ? -(++uc->hook_seq) : ++uc->hook_seq;
     hook->hooked_regions = g_hash_table_new_full(
         hooked_regions_hash, hooked_regions_equal, g_free, NULL);
     *hh = (uc_hook)hook;
@@ -1612,6 +2323,7 @@ uc_err uc_hook_add(uc_engine *uc, uc_hook *hh, int type, void *callback,
         }
 
         uc->hooks_count[UC_HOOK_INSN_IDX]++;
+        uc->hook_index[UC_HOOK_INSN_IDX].dirty = true;
         return UC_ERR_OK;
     }
 
@@ -1643,6 +2355,7 @@ uc_err uc_hook_add(uc_engine *uc, uc_hook *hh, int type, void *callback,
         }
 
         uc->hooks_count[UC_HOOK_TCG_OPCODE_IDX]++;
+        uc->hook_index[UC_HOOK_TCG_OPCODE_IDX].dirty = true;
         return UC_ERR_OK;
     }
 
@@ -1662,6 +2375,7 @@ uc_err uc_hook_add(uc_engine *uc, uc_hook *hh, int type, void *callback,
                     }
                 }
                 uc->hooks_count[i]++;
+                uc->hook_index[i].dirty = true;
             }
         }
         i++;
@@ -1671,6 +2385,11 @@ uc_err uc_hook_add(uc_engine *uc, uc_hook *hh, int type, void *callback,
     // TODO: return an error?
     if (hook->refs == 0) {
         free(hook);
+    } else if (type & (UC_HOOK_MEM_READ | UC_HOOK_MEM_READ_AFTER |
+                       UC_HOOK_MEM_WRITE)) {
+        // Refill the TLB so that the pages covered by the new hook take the
+        // slow path, see tlb_set_page_with_attrs.
+        uc->tcg_flush_tlb(uc);
     }
 
     return ret;
@@ -1696,7 +2415,14 @@ uc_err uc_hook_del(uc_engine *uc, uc_hook hh)
             g_hash_table_remove_all(hook->hooked_regions);
             hook->to_delete = true;
             uc->hooks_count[i]--;
+            uc->hook_index[i].dirty = true;
             hook_append(&uc->hooks_to_del, hook);
+
+            // Give the pages that were hooked their fast path back.
+            if (i == UC_HOOK_MEM_READ_IDX || i == UC_HOOK_MEM_READ_AFTER_IDX ||
+                i == UC_HOOK_MEM_WRITE_IDX) {
+                uc->tcg_flush_tlb(uc);
+            }
         }
     }
 
@@ -1769,15 +2495,8 @@ void helper_uc_tracecode(int32_t size, uc_hook_idx index, void *handle,
             continue;
         }
 
-        // on invalid block/instruction, call instruction counter (if enable),
-        // then quit
+        // on invalid block/instruction, quit
         if (size == 0) {
-            if (index == UC_HOOK_CODE_IDX && uc->count_hook) {
-                // this is the instruction counter (first hook in the list)
-                ((uc_cb_hookcode_t)hook->callback)(uc, address, size,
-                                                   hook->user_data);
-            }
-
             return;
         }
 
@@ -1827,35 +2546,526 @@ uc_err uc_mem_regions(uc_engine *uc, uc_mem_region **regions, uint32_t *count)
     return UC_ERR_OK;
 }
 
-UNICORN_EXPORT
-uc_err uc_query(uc_engine *uc, uc_query_type type, size_t *result)
+// Only the pages ever written hold data, the others are still zero.
+static void clone_ram(uc_engine *uc, RAMBlock *from, RAMBlock *to,
+                      size_t size)
 {
-    UC_INIT(uc);
+    uint64_t ps = uc->target_page_size;
+    unsigned long pages = size / ps;
+    unsigned long page, last;
+
+    page = find_next_bit(from->written, pages, 0);
+    while (page < pages) {
+        last = find_next_zero_bit(from->written, pages, page);
+        memcpy(to->host + page * ps, from->host + page * ps,
+               (last - page) * ps);
+        qemu_bitmap_set(to->written, page, last - page);
+        page = find_next_bit(from->written, pages, last);
+    }
+}
 
-    switch (type) {
-    default:
-        return UC_ERR_ARG;
+#if defined(__linux__) && defined(SYS_memfd_create) && defined(MREMAP_FIXED)
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 1U
+#endif
 
-    case UC_QUERY_PAGE_SIZE:
-        *result = uc->target_page_size;
-        break;
+// Move the RAM of block to a memfd mapped privately, which the clones map
+// privately as well. The memfd is never written afterwards, each engine gets
+// its own copy of a page when it first writes it.
+static bool share_ram(uc_engine *uc, RAMBlock *block, size_t size)
+{
+    uint64_t ps = uc->target_page_size;
+    unsigned long pages = size / ps;
+    unsigned long page, last;
+    void *host;
+    int fd;
 
-    case UC_QUERY_ARCH:
-        *result = uc->arch;
-        break;
+    if (block->cow_written) {
+        return true;
+    }
+    if ((uintptr_t)block->host % uc->qemu_real_host_page_size != 0 ||
+        size % uc->qemu_real_host_page_size != 0) {
+        return false;
+    }
 
-    case UC_QUERY_MODE:
-#ifdef UNICORN_HAS_ARM
-        if (uc->arch == UC_ARCH_ARM) {
-            return uc->query(uc, type, result);
-        }
-#endif
-        *result = uc->mode;
-        break;
+    fd = (int)syscall(SYS_memfd_create, "unicorn", MFD_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    if (ftruncate(fd, (off_t)size) != 0) {
+        goto fail;
+    }
+
+    // Only the pages ever written hold data, the others are still zero.
+    page = find_next_bit(block->written, pages, 0);
+    while (page < pages) {
+        uint8_t *p = block->host + page * ps;
+        size_t len;
+
+        last = find_next_zero_bit(block->written, pages, page);
+        len = (last - page) * ps;
+        while (len) {
+            ssize_t n = pwrite(fd, p, len, (off_t)(p - block->host));
+            if (n <= 0) {
+                goto fail;
+            }
+            p += n;
+            len -= n;
+        }
+        page = find_next_bit(block->written, pages, last);
+    }
+
+    // Swap the mappings in one go, the RAM is left as is on failure.
+    host = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (host == MAP_FAILED) {
+        goto fail;
+    }
+    if (mremap(host, size, size, MREMAP_MAYMOVE | MREMAP_FIXED, block->host) ==
+        MAP_FAILED) {
+        munmap(host, size);
+        goto fail;
+    }
+
+    block->fd = fd;
+    block->fd_offset = 0;
+    block->fd_shared = false;
+    block->cow_written = bitmap_new(pages);
+
+    return true;
+
+fail:
+    close(fd);
+    return false;
+}
+
+// Map the memfd of from in the clone, with the pages from wrote since.
+static bool clone_ram_shared(uc_engine *uc, RAMBlock *from, RAMBlock *to,
+                             size_t size)
+{
+    uint64_t ps = uc->target_page_size;
+    unsigned long pages = size / ps;
+    unsigned long page, last;
+
+    if (!share_ram(uc, from, size) ||
+        from->fd_offset % uc->qemu_real_host_page_size != 0) {
+        return false;
+    }
+
+    to->fd = fcntl(from->fd, F_DUPFD_CLOEXEC, 0);
+    if (to->fd < 0) {
+        return false;
+    }
+    if (mmap(to->host, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+             to->fd, (off_t)from->fd_offset) == MAP_FAILED) {
+        close(to->fd);
+        to->fd = -1;
+        return false;
+    }
+    to->fd_offset = from->fd_offset;
+    to->fd_shared = false;
+    to->cow_written = bitmap_new(pages);
+    bitmap_copy(to->written, from->written, pages);
+
+    page = find_next_bit(from->cow_written, pages, 0);
+    while (page < pages) {
+        last = find_next_zero_bit(from->cow_written, pages, page);
+        memcpy(to->host + page * ps, from->host + page * ps,
+               (last - page) * ps);
+        qemu_bitmap_set(to->cow_written, page, last - page);
+        page = find_next_bit(from->cow_written, pages, last);
+    }
+
+    return true;
+}
+#else
+static bool clone_ram_shared(uc_engine *uc, RAMBlock *from, RAMBlock *to,
+                             size_t size)
+{
+    return false;
+}
+#endif
+
+static uc_err clone_memory(uc_engine *uc, uc_engine *clone)
+{
+    uc_err err;
+    uint32_t i;
+
+    for (i = 0; i < uc->mapped_block_count; i++) {
+        MemoryRegion *mr = uc->mapped_blocks[i];
+        size_t size = (size_t)(mr->end - mr->addr);
+
+        if (!mr->ram) {
+            mmio_cbs *cbs = (mmio_cbs *)mr->opaque;
+            err = uc_mmio_map(clone, mr->addr, size, cbs->read,
+                              cbs->user_data_read, cbs->write,
+                              cbs->user_data_write);
+        } else if (uc_ram_block_is_prealloc(mr->ram_block)) {
+            // The user memory of uc_mem_map_ptr() is shared
+            err = uc_mem_map_ptr(clone, mr->addr, size, mr->perms,
+                                 mr->ram_block->host);
+        } else if (mr->ram_block->fd >= 0 && !mr->ram_block->cow_written) {
+            // Map the file again, a private mapping also needs the pages
+            // written since.
+            RAMBlock *block = mr->ram_block;
+
+            err = uc_mem_map_file(clone, mr->addr, size, mr->perms, block->fd,
+                                  block->fd_offset, block->fd_shared);
+            if (err == UC_ERR_OK && !block->fd_shared) {
+                clone_ram(uc, block, clone->mapped_blocks[i]->ram_block, size);
+            }
+        } else {
+            RAMBlock *to;
+
+            // Share the pages until written where the host allows it, copy
+            // them otherwise.
+            err = uc_mem_map(clone, mr->addr, size, mr->perms);
+            if (err == UC_ERR_OK) {
+                to = clone->mapped_blocks[i]->ram_block;
+                if (!clone_ram_shared(uc, mr->ram_block, to, size)) {
+                    clone_ram(uc, mr->ram_block, to, size);
+                }
+            }
+        }
+        if (err != UC_ERR_OK) {
+            return err;
+        }
+    }
+
+    return UC_ERR_OK;
+}
+
+// A context for the whole CPU state, without memory.
+static uc_context *context_new_cpu(uc_engine *uc)
+{
+    size_t size = uc_context_size(uc);
+    uc_context *context;
+
+    context = g_malloc0(size);
+    context->context_size = size - sizeof(uc_context);
+    context->arch = uc->arch;
+    context->mode = uc->mode;
+    context->regs = UC_CTL_CONTEXT_REGS_ALL;
+
+    return context;
+}
+
+// The CPU state holds pointers to arrays of the engine, e.g. the ARM MPU
+// regions, so it is copied through a context: the context hooks of the arch
+// then give the clone its own arrays.
+static uc_err clone_cpu(uc_engine *uc, uc_engine *clone)
+{
+    uc_context *context = context_new_cpu(uc);
+    uc_err err;
+
+    err = context_save_cpu(uc, context);
+    if (err == UC_ERR_OK) {
+        err = context_restore_cpu(clone, context);
+    }
+
+    g_free(context);
+
+    return err;
+}
+
+static uc_err clone_hooks(uc_engine *uc, uc_engine *clone)
+{
+    struct list_item *cur;
+    struct hook **hooks;
+    size_t count = 0, n;
+    uc_err err = UC_ERR_OK;
+    int i;
+
+    for (i = 0; i < UC_HOOK_MAX; i++) {
+        for (cur = uc->hook[i].head; cur != NULL; cur = cur->next) {
+            count++;
+        }
+    }
+
+    // Add them back in the order they run, a hook in several lists once.
+    hooks = g_new(struct hook *, count + 1);
+    n = 0;
+    for (i = 0; i < UC_HOOK_MAX; i++) {
+        for (cur = uc->hook[i].head; cur != NULL; cur = cur->next) {
+            struct hook *hook = (struct hook *)cur->data;
+            if (!hook->to_delete) {
+                hooks[n++] = hook;
+            }
+        }
+    }
+    qsort(hooks, n, sizeof(struct hook *), hook_index_cmp_seq);
+
+    for (count = 0; count < n && err == UC_ERR_OK; count++) {
+        struct hook *hook = hooks[count];
+        uc_hook hh;
+
+        if (count > 0 && hooks[count - 1] == hook) {
+            continue;
+        }
+        if (hook->type & UC_HOOK_INSN) {
+            err = uc_hook_add(clone, &hh, hook->type, hook->callback,
+                              hook->user_data, hook->begin, hook->end,
+                              hook->insn);
+        } else {
+            err = uc_hook_add(clone, &hh, hook->type, hook->callback,
+                              hook->user_data, hook->begin, hook->end,
+                              hook->op, hook->op_flags);
+        }
+    }
+    clone->hook_insert = uc->hook_insert;
+
+    g_free(hooks);
+
+    return err;
+}
+
+static gboolean clone_exit_iter(gpointer key, gpointer val, gpointer data)
+{
+    uc_add_exit((uc_engine *)data, *(uint64_t *)key);
+
+    return false;
+}
+
+static void clone_breakpoint_iter(gpointer key, gpointer val, gpointer data)
+{
+    uc_engine *clone = (uc_engine *)data;
+
+    g_hash_table_insert(clone->breakpoints, g_memdup(key, sizeof(uint64_t)),
+                        (gpointer)1);
+}
+
+UNICORN_EXPORT
+uc_err uc_clone(uc_engine *uc, uc_engine **result)
+{
+    uc_engine *clone;
+    uc_err err;
+
+    UC_INIT(uc);
+
+    // Not from within a hook.
+    if (uc->nested_level) {
+        return UC_ERR_ARG;
+    }
+
+    err = uc_open(uc->arch, uc->mode, &clone);
+    if (err != UC_ERR_OK) {
+        return err;
+    }
+    clone->cpu_model = uc->cpu_model_ctl;
+    clone->target_bits = uc->target_bits;
+
+    err = uc_init(clone);
+    if (err == UC_ERR_OK) {
+        err = clone_memory(uc, clone);
+    }
+    if (err == UC_ERR_OK) {
+        err = clone_hooks(uc, clone);
+    }
+    if (err == UC_ERR_OK) {
+        err = clone_cpu(uc, clone);
+    }
+    if (err != UC_ERR_OK) {
+        uc_close(clone);
+        return err;
+    }
+
+    clone->use_exits = uc->use_exits;
+    g_tree_foreach(uc->ctl_exits, clone_exit_iter, clone);
+    g_hash_table_foreach(uc->breakpoints, clone_breakpoint_iter, clone);
+    clone->timeout_clock = uc->timeout_clock;
+    clone->context_content = uc->context_content;
+    clone->context_regs = uc->context_regs;
+
+    *result = clone;
+
+    return UC_ERR_OK;
+}
+
+UNICORN_EXPORT
+uc_err uc_mem_dirty_pages(uc_engine *uc, uint64_t address, size_t size,
+                          uint8_t *bitmap, bool clear)
+{
+    MemoryRegion *mr;
+    uint64_t ps;
+    uint64_t page;
+    size_t i, count;
+
+    UC_INIT(uc);
+
+    if (bitmap == NULL) {
+        return UC_ERR_ARG;
+    }
+
+    // address and size must be aligned to uc->target_page_size
+    if ((address & uc->target_page_align) != 0 ||
+        (size & uc->target_page_align) != 0) {
+        return UC_ERR_ARG;
+    }
+
+    if (uc->mem_redirect) {
+        address = uc->mem_redirect(address);
+    }
+
+    if (!check_mem_area(uc, address, size)) {
+        return UC_ERR_NOMEM;
+    }
+
+    ps = uc->target_page_size;
+    count = size / ps;
+    memset(bitmap, 0, (count + 7) / 8);
+
+    mr = NULL;
+    for (i = 0; i < count; i++) {
+        uint64_t addr = address + i * ps;
+
+        if (mr == NULL || addr >= mr->end) {
+            mr = memory_mapping(uc, addr);
+            if (!mr->ram) {
+                return UC_ERR_ARG;
+            }
+        }
+
+        page = (addr - mr->addr) / ps;
+        if (test_bit(page, mr->ram_block->dirty_log)) {
+            bitmap[i / 8] |= 1 << (i % 8);
+            if (clear) {
+                clear_bit(page, mr->ram_block->dirty_log);
+            }
+        }
+    }
+
+    return UC_ERR_OK;
+}
+
+UNICORN_EXPORT
+uc_err uc_mem_get_ptr(uc_engine *uc, uint64_t address, size_t size,
+                      uc_mem_span *spans, uint32_t *count)
+{
+    MemoryRegion *mr;
+    uint8_t *host, *end = NULL;
+    uint32_t n = 0;
+    size_t len;
+
+    UC_INIT(uc);
+
+    if (count == NULL || (spans == NULL && *count != 0)) {
+        return UC_ERR_ARG;
+    }
+
+    uc_mem_sync(uc);
+
+    if (uc->mem_redirect) {
+        address = uc->mem_redirect(address);
+    }
+
+    while (size > 0) {
+        mr = memory_mapping(uc, address);
+        if (mr == NULL) {
+            return UC_ERR_NOMEM;
+        }
+        if (!mr->ram) {
+            return UC_ERR_ARG;
+        }
+
+        len = (size_t)MIN(size, mr->end - address);
+        host = mr->ram_block->host + (address - mr->addr);
+
+        // Regions backed by adjacent host memory make a single span.
+        if (n == 0 || host != end) {
+            n++;
+            if (n <= *count) {
+                spans[n - 1].address = address;
+                spans[n - 1].ptr = host;
+                spans[n - 1].size = 0;
+            }
+        }
+        if (n <= *count) {
+            spans[n - 1].size += len;
+        }
+
+        end = host + len;
+        address += len;
+        size -= len;
+    }
+
+    if (n > *count) {
+        *count = n;
+        return UC_ERR_ARG;
+    }
+    *count = n;
+
+    return UC_ERR_OK;
+}
+
+UNICORN_EXPORT
+uc_err uc_mem_ptr_written(uc_engine *uc, uint64_t address, size_t size)
+{
+    MemoryRegion *mr;
+    ram_addr_t offset;
+    size_t len;
+
+    UC_INIT(uc);
+
+    uc_mem_sync(uc);
+
+    if (uc->mem_redirect) {
+        address = uc->mem_redirect(address);
+    }
+
+    if (!check_mem_area(uc, address, size)) {
+        return UC_ERR_NOMEM;
+    }
+
+    while (size > 0) {
+        mr = memory_mapping(uc, address);
+        len = (size_t)MIN(size, mr->end - address);
+
+        if (mr->ram) {
+            offset = address - mr->addr;
+            uc_ram_block_set_dirty(uc, mr->ram_block, offset, len);
+            uc->uc_invalidate_tb_ram(uc, mr->ram_block->offset + offset,
+                                     mr->ram_block->offset + offset + len);
+        }
+
+        address += len;
+        size -= len;
+    }
+
+    return UC_ERR_OK;
+}
+
+UNICORN_EXPORT
+uc_err uc_query(uc_engine *uc, uc_query_type type, size_t *result)
+{
+    UC_INIT(uc);
+
+    switch (type) {
+    default:
+        return UC_ERR_ARG;
+
+    case UC_QUERY_PAGE_SIZE:
+        *result = uc->target_page_size;
+        break;
+
+    case UC_QUERY_ARCH:
+        *result = uc->arch;
+        break;
+
+    case UC_QUERY_MODE:
+#ifdef UNICORN_HAS_ARM
+        if (uc->arch == UC_ARCH_ARM) {
+            return uc->query(uc, type, result);
+        }
+#endif
+        *result = uc->mode;
+        break;
 
     case UC_QUERY_TIMEOUT:
         *result = uc->timed_out;
         break;
+
+    case UC_QUERY_INSN_COUNT:
+        *result = uc->emu_counter;
+        break;
     }
 
     return UC_ERR_OK;
@@ -1874,6 +3084,10 @@ uc_err uc_context_alloc(uc_engine *uc, uc_context **context)
         (*_context)->context_size = size - sizeof(uc_context);
         (*_context)->arch = uc->arch;
         (*_context)->mode = uc->mode;
+        (*_context)->regs = uc->context_regs;
+        (*_context)->regions = NULL;
+        (*_context)->region_count = 0;
+        (*_context)->mem_epoch = 0;
         return UC_ERR_OK;
     } else {
         return UC_ERR_NOMEM;
@@ -1900,12 +3114,224 @@ size_t uc_context_size(uc_engine *uc)
     }
 }
 
-UNICORN_EXPORT
-uc_err uc_context_save(uc_engine *uc, uc_context *context)
+static void context_free_regions(uc_context *context)
 {
-    UC_INIT(uc);
+    size_t i;
+
+    for (i = 0; i < context->region_count; i++) {
+        g_free(context->regions[i].data);
+    }
+    g_free(context->regions);
+    context->regions = NULL;
+    context->region_count = 0;
+}
+
+// Start tracking the writes to RAM from scratch.
+static void uc_ram_clear_dirty(uc_engine *uc)
+{
+    RAMBlock *block;
+
+    QLIST_FOREACH(block, &uc->ram_list.blocks, next)
+    {
+        bitmap_zero(block->dirty, block->max_length / uc->target_page_size);
+    }
+}
+
+// Memory epochs are unique to the process, so that a context saved by another
+// engine never looks current.
+static QemuMutex mem_epoch_lock = QEMU_MUTEX_INITIALIZER;
+static uint64_t mem_epoch_seq;
+
+static uint64_t next_mem_epoch(void)
+{
+    uint64_t epoch;
+
+    qemu_mutex_lock(&mem_epoch_lock);
+    epoch = ++mem_epoch_seq;
+    qemu_mutex_unlock(&mem_epoch_lock);
+
+    return epoch;
+}
 
-    if (!uc->context_save) {
+static uc_err context_save_memory(uc_engine *uc, uc_context *context)
+{
+    struct uc_context_region *regions;
+    size_t count = 0;
+    uint32_t i;
+
+    regions = g_new0(struct uc_context_region, uc->mapped_block_count);
+    for (i = 0; i < uc->mapped_block_count; i++) {
+        MemoryRegion *mr = uc->mapped_blocks[i];
+        struct uc_context_region *r;
+
+        if (!mr->ram) {
+            continue;
+        }
+
+        r = &regions[count++];
+        r->begin = mr->addr;
+        r->end = mr->end;
+        r->perms = mr->perms;
+        r->block = mr->ram_block;
+        r->host = uc_ram_block_is_prealloc(mr->ram_block) ? mr->ram_block->host
+                                                          : NULL;
+        r->data = g_malloc(r->end - r->begin);
+        memcpy(r->data, mr->ram_block->host, r->end - r->begin);
+    }
+
+    context_free_regions(context);
+    context->regions = regions;
+    context->region_count = count;
+    context->mem_epoch = uc->mem_epoch = next_mem_epoch();
+    uc_ram_clear_dirty(uc);
+
+    return UC_ERR_OK;
+}
+
+// Is mr one of the RAM regions saved in the context?
+static struct uc_context_region *context_find_region(uc_context *context,
+                                                     MemoryRegion *mr)
+{
+    void *host =
+        uc_ram_block_is_prealloc(mr->ram_block) ? mr->ram_block->host : NULL;
+    size_t i;
+
+    for (i = 0; i < context->region_count; i++) {
+        struct uc_context_region *r = &context->regions[i];
+        if (r->begin == mr->addr && r->end == mr->end && r->host == host) {
+            return r;
+        }
+    }
+
+    return NULL;
+}
+
+static uc_err context_restore_memory(uc_engine *uc, uc_context *context)
+{
+    struct uc_context_region *r;
+    MemoryRegion *mr;
+    uint64_t ps = uc->target_page_size;
+    uc_err err;
+    size_t i;
+    uint32_t j;
+
+    if (context->regions == NULL) {
+        return UC_ERR_OK;
+    }
+
+    // The TBs on the pages copied back are invalidated, the others and the
+    // TLB stay warm.
+    if (context->mem_epoch == uc->mem_epoch) {
+        // Same memory map and the dirty bitmaps are relative to this context,
+        // only copy back what was written since.
+        for (i = 0; i < context->region_count; i++) {
+            uint64_t pages, page, last;
+            RAMBlock *block;
+
+            r = &context->regions[i];
+            block = r->block;
+            pages = (r->end - r->begin) / ps;
+            for (page = find_next_bit(block->dirty, pages, 0); page < pages;
+                 page = find_next_bit(block->dirty, pages, last)) {
+                last = find_next_zero_bit(block->dirty, pages, page);
+                memcpy(block->host + page * ps, r->data + page * ps,
+                       (last - page) * ps);
+                if (block->cow_written) {
+                    qemu_bitmap_set(block->cow_written, page, last - page);
+                }
+                uc->uc_invalidate_tb_ram(uc, block->offset + page * ps,
+                                         block->offset + last * ps);
+            }
+        }
+    } else {
+        // Bring the memory map back first, keeping the RAM regions which are
+        // still there.
+        for (j = uc->mapped_block_count; j-- > 0;) {
+            mr = uc->mapped_blocks[j];
+            if (!mr->ram) {
+                continue;
+            }
+
+            r = context_find_region(context, mr);
+            if (r == NULL) {
+                // Its RAM offsets may be given to a region mapped below.
+                uc->uc_invalidate_tb_ram(uc, mr->ram_block->offset,
+                                         mr->ram_block->offset +
+                                             (mr->end - mr->addr));
+                err = uc_mem_unmap(uc, mr->addr, mr->end - mr->addr);
+            } else if (mr->perms != r->perms) {
+                err = uc_mem_protect(uc, r->begin, r->end - r->begin, r->perms);
+            } else {
+                err = UC_ERR_OK;
+            }
+            if (err != UC_ERR_OK) {
+                return err;
+            }
+        }
+
+        for (i = 0; i < context->region_count; i++) {
+            r = &context->regions[i];
+            mr = memory_mapping(uc, r->begin);
+            if (mr == NULL) {
+                if (r->host) {
+                    err = uc_mem_map_ptr(uc, r->begin, r->end - r->begin,
+                                         r->perms, r->host);
+                } else {
+                    err = uc_mem_map(uc, r->begin, r->end - r->begin,
+                                     r->perms);
+                }
+                if (err != UC_ERR_OK) {
+                    return err;
+                }
+                mr = memory_mapping(uc, r->begin);
+            } else if (!mr->ram) {
+                return UC_ERR_MAP;
+            }
+
+            memcpy(mr->ram_block->host, r->data, r->end - r->begin);
+            bitmap_fill(mr->ram_block->written,
+                        (r->end - r->begin) / uc->target_page_size);
+            if (mr->ram_block->cow_written) {
+                bitmap_fill(mr->ram_block->cow_written,
+                            (r->end - r->begin) / uc->target_page_size);
+            }
+            uc->uc_invalidate_tb_ram(uc, mr->ram_block->offset,
+                                     mr->ram_block->offset +
+                                         (r->end - r->begin));
+            r->block = mr->ram_block;
+        }
+
+        context->mem_epoch = uc->mem_epoch = next_mem_epoch();
+    }
+
+    uc_ram_clear_dirty(uc);
+
+    return UC_ERR_OK;
+}
+
+// Copy the parts of the CPU state in the register classes @regs.
+static void context_copy_regs(uc_engine *uc, void *dst, const void *src,
+                              int regs)
+{
+    const struct uc_context_range *range = uc->context_ranges;
+    int i;
+
+    for (i = 0; i < uc->context_range_count; i++, range++) {
+        if (range->regs & regs) {
+            memcpy((char *)dst + range->offset,
+                   (const char *)src + range->offset, range->size);
+        }
+    }
+}
+
+// The arch hooks also save the data kept out of the CPU state, e.g. the ARM
+// MPU regions, and restore it into the arrays of the engine.
+static uc_err context_save_cpu(uc_engine *uc, uc_context *context)
+{
+    if (context->regs != UC_CTL_CONTEXT_REGS_ALL) {
+        context_copy_regs(uc, context->data, uc->cpu->env_ptr, context->regs);
+        return UC_ERR_OK;
+    } else if (!uc->context_save) {
         memcpy(context->data, uc->cpu->env_ptr, context->context_size);
         return UC_ERR_OK;
     } else {
@@ -1913,6 +3339,40 @@ uc_err uc_context_save(uc_engine *uc, uc_context *context)
     }
 }
 
+static uc_err context_restore_cpu(uc_engine *uc, uc_context *context)
+{
+    if (context->regs != UC_CTL_CONTEXT_REGS_ALL) {
+        context_copy_regs(uc, uc->cpu->env_ptr, context->data, context->regs);
+        return UC_ERR_OK;
+    } else if (!uc->context_restore) {
+        memcpy(uc->cpu->env_ptr, context->data, context->context_size);
+        return UC_ERR_OK;
+    } else {
+        return uc->context_restore(uc, context);
+    }
+}
+
+UNICORN_EXPORT
+uc_err uc_context_save(uc_engine *uc, uc_context *context)
+{
+    uc_err err;
+
+    UC_INIT(uc);
+
+    if (uc->context_content & UC_CTL_CONTEXT_MEMORY) {
+        err = context_save_memory(uc, context);
+        if (err != UC_ERR_OK) {
+            return err;
+        }
+    }
+
+    if (!(uc->context_content & UC_CTL_CONTEXT_CPU)) {
+        return UC_ERR_OK;
+    }
+
+    return context_save_cpu(uc, context);
+}
+
 UNICORN_EXPORT
 uc_err uc_context_reg_write(uc_context *ctx, int regid, const void *value)
 {
@@ -2080,23 +3540,431 @@ uc_err uc_context_reg_read_batch(uc_context *ctx, int *ids, void **vals,
 UNICORN_EXPORT
 uc_err uc_context_restore(uc_engine *uc, uc_context *context)
 {
+    uc_err err;
+
     UC_INIT(uc);
 
-    if (!uc->context_restore) {
-        memcpy(uc->cpu->env_ptr, context->data, context->context_size);
+    if (uc->context_content & UC_CTL_CONTEXT_MEMORY) {
+        err = context_restore_memory(uc, context);
+        if (err != UC_ERR_OK) {
+            return err;
+        }
+    }
+
+    if (!(uc->context_content & UC_CTL_CONTEXT_CPU)) {
         return UC_ERR_OK;
-    } else {
-        return uc->context_restore(uc, context);
     }
+
+    return context_restore_cpu(uc, context);
 }
 
 UNICORN_EXPORT
 uc_err uc_context_free(uc_context *context)
 {
+    context_free_regions(context);
 
     return uc_free(context);
 }
 
+static bool snapshot_seek(FILE *f, uint64_t offset)
+{
+#ifdef _WIN32
+    return _fseeki64(f, (__int64)offset, SEEK_SET) == 0;
+#else
+    return fseeko(f, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+// Is this page worth storing? The memory of uc_mem_map_ptr() is written
+// behind our back and the one of uc_mem_map_file() is not zero, so all of
+// it is. The memfd shared with clones only holds the pages written.
+static bool snapshot_page_stored(MemoryRegion *mr, unsigned long page)
+{
+    return uc_ram_block_is_prealloc(mr->ram_block) ||
+           (mr->ram_block->fd >= 0 && !mr->ram_block->cow_written) ||
+           test_bit(page, mr->ram_block->written);
+}
+
+static uc_err snapshot_write(uc_engine *uc, FILE *f, MemoryRegion **rams,
+                             uint32_t count)
+{
+    struct uc_snapshot_header header;
+    struct uc_snapshot_region *regions;
+    uc_context *cpu;
+    uint64_t ps = uc->target_page_size;
+    uint64_t offset, end = 0;
+    unsigned long pages, page, last;
+    uint8_t *bitmap;
+    uc_err err = UC_ERR_RESOURCE;
+    uint32_t i;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, UC_SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = UC_SNAPSHOT_VERSION;
+    header.header_size = sizeof(header);
+    header.arch = uc->arch;
+    header.mode = uc->mode;
+    header.cpu_model = uc->cpu_model;
+    header.page_size = uc->target_page_size;
+    header.region_count = count;
+    header.byte_order = UC_SNAPSHOT_BYTE_ORDER;
+    header.pointer_size = sizeof(void *);
+    header.uc_version = uc_version(NULL, NULL);
+
+    // The CPU goes through the arch hooks, which also save the state kept
+    // out of env.
+    cpu = context_new_cpu(uc);
+    header.cpu_size = cpu->context_size;
+    err = context_save_cpu(uc, cpu);
+    if (err != UC_ERR_OK) {
+        g_free(cpu);
+        return err;
+    }
+    err = UC_ERR_RESOURCE;
+
+    // Lay the file out first.
+    regions = g_new0(struct uc_snapshot_region, count);
+    offset = sizeof(header) + count * sizeof(struct uc_snapshot_region);
+    header.cpu_offset = offset;
+    offset += header.cpu_size;
+    for (i = 0; i < count; i++) {
+        regions[i].begin = rams[i]->addr;
+        regions[i].end = rams[i]->end;
+        regions[i].perms = rams[i]->perms;
+        regions[i].bitmap_offset = offset;
+        offset += ((regions[i].end - regions[i].begin) / ps + 7) / 8;
+    }
+    offset = ROUND_UP(offset, UC_SNAPSHOT_ALIGN);
+    for (i = 0; i < count; i++) {
+        regions[i].data_offset = offset;
+        offset += ROUND_UP(regions[i].end - regions[i].begin,
+                           UC_SNAPSHOT_ALIGN);
+    }
+
+    if (fwrite(&header, sizeof(header), 1, f) != 1 ||
+        (count && fwrite(regions, sizeof(struct uc_snapshot_region), count,
+                         f) != count) ||
+        (header.cpu_size && fwrite(cpu->data, header.cpu_size, 1, f) != 1)) {
+        goto out;
+    }
+
+    for (i = 0; i < count; i++) {
+        pages = (regions[i].end - regions[i].begin) / ps;
+        bitmap = g_malloc0((pages + 7) / 8);
+        for (page = 0; page < pages; page++) {
+            if (snapshot_page_stored(rams[i], page)) {
+                bitmap[page / 8] |= 1 << (page % 8);
+            }
+        }
+        if (fwrite(bitmap, (pages + 7) / 8, 1, f) != 1) {
+            g_free(bitmap);
+            goto out;
+        }
+        g_free(bitmap);
+    }
+
+    // Only the pages stored are written, the others stay holes.
+    for (i = 0; i < count; i++) {
+        uint8_t *host = rams[i]->ram_block->host;
+
+        pages = (regions[i].end - regions[i].begin) / ps;
+        page = 0;
+        while (page < pages) {
+            if (!snapshot_page_stored(rams[i], page)) {
+                page++;
+                continue;
+            }
+            for (last = page + 1;
+                 last < pages && snapshot_page_stored(rams[i], last); last++) {
+            }
+            if (!snapshot_seek(f, regions[i].data_offset + page * ps) ||
+                fwrite(host + page * ps, (last - page) * ps, 1, f) != 1) {
+                goto out;
+            }
+            end = regions[i].data_offset + last * ps;
+            page = last;
+        }
+    }
+
+    // Pad the file so that the regions can be mapped whole.
+    if (end < offset &&
+        (!snapshot_seek(f, offset - 1) || fputc(0, f) == EOF)) {
+        goto out;
+    }
+
+    err = UC_ERR_OK;
+
+out:
+    g_free(regions);
+    g_free(cpu);
+
+    return err;
+}
+
+UNICORN_EXPORT
+uc_err uc_snapshot_save(uc_engine *uc, const char *path)
+{
+    MemoryRegion **rams;
+    uint32_t count = 0, i;
+    uc_err err;
+    FILE *f;
+
+    UC_INIT(uc);
+
+    f = fopen(path, "wb");
+    if (f == NULL) {
+        return UC_ERR_ARG;
+    }
+
+    rams = g_new(MemoryRegion *, uc->mapped_block_count + 1);
+    for (i = 0; i < uc->mapped_block_count; i++) {
+        if (uc->mapped_blocks[i]->ram) {
+            rams[count++] = uc->mapped_blocks[i];
+        }
+    }
+
+    err = snapshot_write(uc, f, rams, count);
+    if (fclose(f) != 0 && err == UC_ERR_OK) {
+        err = UC_ERR_RESOURCE;
+    }
+    g_free(rams);
+
+    return err;
+}
+
+static bool snapshot_file_size(FILE *f, uint64_t *size)
+{
+#ifdef _WIN32
+    __int64 end;
+
+    if (_fseeki64(f, 0, SEEK_END) != 0 || (end = _ftelli64(f)) < 0) {
+        return false;
+    }
+#else
+    off_t end;
+
+    if (fseeko(f, 0, SEEK_END) != 0 || (end = ftello(f)) < 0) {
+        return false;
+    }
+#endif
+    *size = (uint64_t)end;
+
+    return true;
+}
+
+// Check a region of the file and read its bitmap, before anything in the
+// engine is replaced.
+static uc_err snapshot_check_region(uc_engine *uc, FILE *f, uint64_t file_size,
+                                    struct uc_snapshot_region *r,
+                                    struct uc_snapshot_region *prev,
+                                    uint8_t **bitmap)
+{
+    uint64_t size = r->end - r->begin;
+    uint64_t bitmap_size = (size / uc->target_page_size + 7) / 8;
+    uint32_t i;
+
+    // In order, not overlapping and within the file.
+    if (r->end <= r->begin || ((r->begin | r->end) & uc->target_page_align) ||
+        size != (size_t)size || (r->perms & ~UC_PROT_ALL) != 0 ||
+        (prev != NULL && r->begin < prev->end) ||
+        r->bitmap_offset > file_size ||
+        bitmap_size > file_size - r->bitmap_offset ||
+        r->data_offset > file_size || size > file_size - r->data_offset) {
+        return UC_ERR_ARG;
+    }
+
+    // The MMIO regions stay.
+    for (i = 0; i < uc->mapped_block_count; i++) {
+        MemoryRegion *mr = uc->mapped_blocks[i];
+        if (!mr->ram && mr->addr < r->end && r->begin < mr->end) {
+            return UC_ERR_MAP;
+        }
+    }
+
+    *bitmap = g_malloc((size_t)bitmap_size);
+    if (!snapshot_seek(f, r->bitmap_offset) ||
+        fread(*bitmap, (size_t)bitmap_size, 1, f) != 1) {
+        return UC_ERR_ARG;
+    }
+
+    return UC_ERR_OK;
+}
+
+static uc_err snapshot_read_region(uc_engine *uc, FILE *f,
+                                   struct uc_snapshot_region *r,
+                                   const uint8_t *bitmap)
+{
+    MemoryRegion *mr;
+    RAMBlock *block;
+    uint64_t ps = uc->target_page_size;
+    size_t size = (size_t)(r->end - r->begin);
+    unsigned long pages = size / ps, page, last;
+    uc_err err;
+
+    err = uc_mem_map(uc, r->begin, size, r->perms);
+    if (err != UC_ERR_OK) {
+        return err;
+    }
+    mr = memory_mapping(uc, r->begin);
+    block = mr->ram_block;
+
+    for (page = 0; page < pages; page++) {
+        if (bitmap[page / 8] & (1 << (page % 8))) {
+            set_bit(page, block->written);
+        }
+    }
+
+#ifndef _WIN32
+    // Map the content privately over the fresh RAM, the pages are read
+    // from the file when first touched and copied when first written.
+    if (block->max_length <= ROUND_UP(size, UC_SNAPSHOT_ALIGN) &&
+        (r->data_offset % uc->qemu_real_host_page_size) == 0 &&
+        mmap(block->host, block->max_length, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_FIXED, fileno(f),
+             (off_t)r->data_offset) != MAP_FAILED) {
+        return UC_ERR_OK;
+    }
+#endif
+
+    // No mmap, read the pages stored.
+    page = 0;
+    while (page < pages) {
+        if (!(bitmap[page / 8] & (1 << (page % 8)))) {
+            page++;
+            continue;
+        }
+        for (last = page + 1;
+             last < pages && (bitmap[last / 8] & (1 << (last % 8))); last++) {
+        }
+        if (!snapshot_seek(f, r->data_offset + page * ps) ||
+            fread(block->host + page * ps, (last - page) * ps, 1, f) != 1) {
+            return UC_ERR_ARG;
+        }
+        page = last;
+    }
+
+    return UC_ERR_OK;
+}
+
+static uc_err snapshot_read(uc_engine *uc, FILE *f)
+{
+    struct uc_snapshot_header header;
+    struct uc_snapshot_region *regions = NULL;
+    uint8_t **bitmaps = NULL;
+    uint64_t file_size;
+    uc_context *cpu = NULL;
+    uc_err err = UC_ERR_ARG;
+    uint32_t i;
+
+    // The CPU state is raw host data, only the same build on the same kind of
+    // host can read it.
+    if (fread(&header, sizeof(header), 1, f) != 1 ||
+        memcmp(header.magic, UC_SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ||
+        header.byte_order != UC_SNAPSHOT_BYTE_ORDER ||
+        header.version != UC_SNAPSHOT_VERSION ||
+        header.header_size != sizeof(header) ||
+        header.pointer_size != sizeof(void *) ||
+        header.uc_version != uc_version(NULL, NULL)) {
+        return UC_ERR_ARG;
+    }
+    if (header.arch != uc->arch) {
+        return UC_ERR_ARCH;
+    }
+    if (header.mode != uc->mode) {
+        return UC_ERR_MODE;
+    }
+    if (header.cpu_model != uc->cpu_model ||
+        header.page_size != uc->target_page_size ||
+        header.cpu_size != uc_context_size(uc) - sizeof(uc_context)) {
+        return UC_ERR_ARG;
+    }
+
+    // Nothing is allocated from the header before it is checked against the
+    // file.
+    if (!snapshot_file_size(f, &file_size) ||
+        (file_size - sizeof(header)) / sizeof(struct uc_snapshot_region) <
+            header.region_count ||
+        header.cpu_offset > file_size ||
+        header.cpu_size > file_size - header.cpu_offset) {
+        return UC_ERR_ARG;
+    }
+
+    regions = g_new(struct uc_snapshot_region, (size_t)header.region_count + 1);
+    bitmaps = g_new0(uint8_t *, (size_t)header.region_count + 1);
+    cpu = context_new_cpu(uc);
+    if (!snapshot_seek(f, sizeof(header)) ||
+        (header.region_count &&
+         fread(regions, sizeof(struct uc_snapshot_region), header.region_count,
+               f) != header.region_count) ||
+        !snapshot_seek(f, header.cpu_offset) ||
+        (header.cpu_size && fread(cpu->data, header.cpu_size, 1, f) != 1)) {
+        goto out;
+    }
+
+    for (i = 0; i < header.region_count; i++) {
+        err = snapshot_check_region(uc, f, file_size, &regions[i],
+                                    i ? &regions[i - 1] : NULL, &bitmaps[i]);
+        if (err != UC_ERR_OK) {
+            goto out;
+        }
+    }
+
+    // Replace the RAM, the MMIO regions stay.
+    for (i = uc->mapped_block_count; i > 0; i--) {
+        if (uc->mapped_blocks[i - 1]->ram) {
+            uc->memory_unmap(uc, uc->mapped_blocks[i - 1]);
+        }
+    }
+    uc->mem_epoch = 0;
+
+    for (i = 0; i < header.region_count; i++) {
+        err = snapshot_read_region(uc, f, &regions[i], bitmaps[i]);
+        if (err != UC_ERR_OK) {
+            goto out;
+        }
+    }
+
+    err = context_restore_cpu(uc, cpu);
+    uc->tb_flush(uc);
+    uc->tcg_flush_tlb(uc);
+
+out:
+    if (bitmaps != NULL) {
+        for (i = 0; i < header.region_count; i++) {
+            g_free(bitmaps[i]);
+        }
+    }
+    g_free(bitmaps);
+    g_free(regions);
+    g_free(cpu);
+
+    return err;
+}
+
+UNICORN_EXPORT
+uc_err uc_snapshot_load(uc_engine *uc, const char *path)
+{
+    uc_err err;
+    FILE *f;
+
+    UC_INIT(uc);
+
+    // Not from within a hook.
+    if (uc->nested_level) {
+        return UC_ERR_ARG;
+    }
+
+    f = fopen(path, "rb");
+    if (f == NULL) {
+        return UC_ERR_ARG;
+    }
+
+    err = snapshot_read(uc, f);
+    fclose(f);
+
+    return err;
+}
+
 typedef struct _uc_ctl_exit_request {
     uint64_t *array;
     size_t len;
@@ -2155,6 +4023,23 @@ uc_err uc_ctl(uc_engine *uc, uc_control_type control, ...)
         break;
     }
 
+    case UC_CTL_UC_TIMEOUT_CLOCK: {
+        if (rw == UC_CTL_IO_READ) {
+            int *clock = va_arg(args, int *);
+            *clock = uc->timeout_clock;
+        } else {
+            int clock = va_arg(args, int);
+
+            if (clock != UC_TIMEOUT_CLOCK_HOST &&
+                clock != UC_TIMEOUT_CLOCK_VIRTUAL) {
+                err = UC_ERR_ARG;
+                break;
+            }
+            uc->timeout_clock = clock;
+        }
+        break;
+    }
+
     case UC_CTL_UC_PAGE_SIZE: {
         if (rw == UC_CTL_IO_READ) {
 
@@ -2196,6 +4081,7 @@ uc_err uc_ctl(uc_engine *uc, uc_control_type control, ...)
     case UC_CTL_UC_USE_EXITS: {
         if (rw == UC_CTL_IO_WRITE) {
             int use_exits = va_arg(args, int);
+            uc_drop_exit_tbs(uc);
             uc->use_exits = use_exits;
         } else {
             err = UC_ERR_ARG;
@@ -2240,6 +4126,7 @@ uc_err uc_ctl(uc_engine *uc, uc_control_type control, ...)
             uint64_t *exits = va_arg(args, uint64_t *);
             size_t cnt = va_arg(args, size_t);
 
+            uc_drop_exit_tbs(uc);
             g_tree_remove_all(uc->ctl_exits);
 
             for (size_t i = 0; i < cnt; i++) {
@@ -2395,6 +4282,153 @@ uc_err uc_ctl(uc_engine *uc, uc_control_type control, ...)
         }
         break;
 
+    case UC_CTL_UC_BREAKPOINT_ADD: {
+
+        UC_INIT(uc);
+
+        if (rw == UC_CTL_IO_WRITE) {
+            uint64_t *addrs = va_arg(args, uint64_t *);
+            size_t cnt = va_arg(args, size_t);
+
+            for (size_t i = 0; i < cnt; i++) {
+                if (!uc_addr_is_breakpoint(uc, addrs[i])) {
+                    g_hash_table_insert(uc->breakpoints,
+                                        g_memdup(&addrs[i], sizeof(uint64_t)),
+                                        (gpointer)1);
+                    uc_breakpoint_invalidate(uc, addrs[i]);
+                }
+            }
+        } else {
+            err = UC_ERR_ARG;
+        }
+        break;
+    }
+
+    case UC_CTL_UC_BREAKPOINT_DEL: {
+
+        UC_INIT(uc);
+
+        if (rw == UC_CTL_IO_WRITE) {
+            uint64_t *addrs = va_arg(args, uint64_t *);
+            size_t cnt = va_arg(args, size_t);
+
+            for (size_t i = 0; i < cnt; i++) {
+                if (g_hash_table_remove(uc->breakpoints, &addrs[i])) {
+                    uc_breakpoint_invalidate(uc, addrs[i]);
+                }
+            }
+        } else {
+            err = UC_ERR_ARG;
+        }
+        break;
+    }
+
+    case UC_CTL_UC_BREAKPOINT_HIT: {
+        if (rw == UC_CTL_IO_READ && uc->breakpoint_hit) {
+            uint64_t *addr = va_arg(args, uint64_t *);
+            *addr = uc->breakpoint_hit_pc;
+        } else {
+            err = UC_ERR_ARG;
+        }
+        break;
+    }
+
+    case UC_CTL_UC_CMPLOG: {
+
+        UC_INIT(uc);
+
+        if (rw == UC_CTL_IO_WRITE) {
+            uc_cmplog_entry *buffer = va_arg(args, uc_cmplog_entry *);
+            size_t count = va_arg(args, size_t);
+            uc_cb_cmplog_t callback = va_arg(args, uc_cb_cmplog_t);
+            void *user_data = va_arg(args, void *);
+
+            if (buffer != NULL &&
+                (count == 0 || count > UINT32_MAX || callback == NULL)) {
+                err = UC_ERR_ARG;
+                break;
+            }
+
+            if (uc->cmplog_buf != NULL) {
+                helper_uc_cmplog_drain(uc);
+            }
+            // The buffer and its size are baked into the translated code.
+            if (buffer != uc->cmplog_buf ||
+                (buffer != NULL && count != uc->cmplog_size)) {
+                uc->tb_flush(uc);
+            }
+            uc->cmplog_buf = buffer;
+            uc->cmplog_size = buffer ? (uint32_t)count : 0;
+            uc->cmplog_cb = callback;
+            uc->cmplog_data = user_data;
+        } else {
+            err = UC_ERR_ARG;
+        }
+        break;
+    }
+
+    case UC_CTL_CONTEXT_MODE:
+        if (rw == UC_CTL_IO_READ) {
+            int *mode = va_arg(args, int *);
+            *mode = uc->context_content;
+        } else {
+            int mode = va_arg(args, int);
+            if (mode == 0 ||
+                (mode & ~(UC_CTL_CONTEXT_CPU | UC_CTL_CONTEXT_MEMORY)) != 0) {
+                err = UC_ERR_ARG;
+            } else {
+                uc->context_content = mode;
+            }
+        }
+        break;
+
+    case UC_CTL_CONTEXT_REGS:
+
+        UC_INIT(uc);
+
+        if (rw == UC_CTL_IO_READ) {
+            int *regs = va_arg(args, int *);
+            *regs = uc->context_regs;
+        } else {
+            int regs = va_arg(args, int);
+            if (regs == 0 || (regs & ~UC_CTL_CONTEXT_REGS_ALL) != 0 ||
+                (regs != UC_CTL_CONTEXT_REGS_ALL && !uc->context_ranges)) {
+                err = UC_ERR_ARG;
+            } else {
+                uc->context_regs = regs;
+            }
+        }
+        break;
+
+    case UC_CTL_UC_COVERAGE_MAP: {
+
+        UC_INIT(uc);
+
+        if (rw == UC_CTL_IO_READ) {
+            uint8_t **map = va_arg(args, uint8_t **);
+            size_t *size = va_arg(args, size_t *);
+            *map = uc->coverage_map;
+            *size = uc->coverage_map ? (size_t)uc->coverage_mask + 1 : 0;
+        } else {
+            uint8_t *map = va_arg(args, uint8_t *);
+            size_t size = va_arg(args, size_t);
+
+            if (map != NULL &&
+                (size == 0 || (size & (size - 1)) != 0 || size > UINT32_MAX)) {
+                err = UC_ERR_ARG;
+                break;
+            }
+            // The map and mask are baked into the translated code.
+            if (map != uc->coverage_map ||
+                (map != NULL && size - 1 != uc->coverage_mask)) {
+                uc->coverage_map = map;
+                uc->coverage_mask = map ? (uint32_t)(size - 1) : 0;
+                uc->tb_flush(uc);
+            }
+        }
+        break;
+    }
+
     default:
         err = UC_ERR_ARG;
         break;